@@ -4,13 +4,26 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include "Shader.h"
+#include "InstanceBuffer.h"
 #include "stb_image.h"
 
 #include <iostream>
+#include <iomanip>
+#include <random>
+#include <vector>
 
 unsigned int SCR_WIDTH = 800;
 unsigned int SCR_HEIGHT = 600;
 
+// STRESS MODE, toggled with I: a STRESS_CUBE_SIDE^3 lattice of spinning boxes instead of the ten boxes
+const int STRESS_CUBE_SIDE = 48;
+const float STRESS_CUBE_SPACING = 1.5f;
+bool stressMode = false;
+bool stressKeyDownLastFrame = false;
+bool instancesDirty = true;
+// frame time is averaged over FRAME_TIME_SAMPLES frames
+const int FRAME_TIME_SAMPLES = 240;
+
 void processInput(GLFWwindow* window);
 void FrameBufferSizeCallback(GLFWwindow* window, int width, int height);
 
@@ -169,14 +182,65 @@ int main()
 	projection = glm::perspective(glm::radians(45.0f), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
 	shaderProgram.setMat4("projection", projection);
 
+	// every box is one instance in a shader storage buffer, drawn with a single instanced call.
+	// Every third box spins; the rotation is applied in the vertex shader, so nothing is re-uploaded per frame.
+	std::vector<CubeInstance> boxes;
+	for (unsigned int i = 0; i < 10; i++)
+	{
+		glm::mat4 model = glm::translate(glm::mat4(1.0f), cubePositions[i]);
+		float angle = 25.0f * i;
+		if (!(i % 3))
+			boxes.push_back({ model, glm::vec4(glm::normalize(glm::vec3(1.0f, 0.3f, 0.5f)), glm::radians(i == 0 ? 25.0f : angle)) });
+		else
+			boxes.push_back({ glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f)), glm::vec4(0.0f) });
+	}
+	std::vector<CubeInstance> stressBoxes; // built the first time stress mode is entered
+	InstanceBuffer<CubeInstance> boxInstances(CUBE_INSTANCE_BINDING);
+
 	// enable depth testing
 	glEnable(GL_DEPTH_TEST);
 
+	double lastFrameTime = glfwGetTime();
+	double frameTimeAccumulated = 0.0;
+	int frameTimeFrames = 0;
+
 	while (!glfwWindowShouldClose(window))
 	{
+		double currentFrameTime = glfwGetTime();
+		frameTimeAccumulated += (currentFrameTime - lastFrameTime) * 1000.0;
+		lastFrameTime = currentFrameTime;
+		if (++frameTimeFrames == FRAME_TIME_SAMPLES)
+		{
+			std::cout << boxInstances.Count() << " boxes, frame time: " << std::fixed << std::setprecision(3) << frameTimeAccumulated / frameTimeFrames << " ms" << std::endl;
+			frameTimeAccumulated = 0.0;
+			frameTimeFrames = 0;
+		}
+
 		// input
 		processInput(window);
 
+		if (instancesDirty)
+		{
+			if (stressMode && stressBoxes.empty())
+			{
+				std::mt19937 rng(1337);
+				std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+				float offset = (STRESS_CUBE_SIDE - 1) * STRESS_CUBE_SPACING * 0.5f;
+				stressBoxes.reserve(STRESS_CUBE_SIDE * STRESS_CUBE_SIDE * STRESS_CUBE_SIDE);
+				for (int z = 0; z < STRESS_CUBE_SIDE; z++)
+					for (int y = 0; y < STRESS_CUBE_SIDE; y++)
+						for (int x = 0; x < STRESS_CUBE_SIDE; x++)
+						{
+							// the lattice starts just in front of the camera and reaches back inside the far plane
+							glm::vec3 position = glm::vec3(x * STRESS_CUBE_SPACING - offset, y * STRESS_CUBE_SPACING - offset, -z * STRESS_CUBE_SPACING - 2.0f);
+							glm::vec3 axis = glm::normalize(glm::vec3(unit(rng), unit(rng), unit(rng)) + glm::vec3(0.0f, 0.001f, 0.0f));
+							stressBoxes.push_back({ glm::translate(glm::mat4(1.0f), position), glm::vec4(axis, unit(rng) * 2.0f) });
+						}
+			}
+			boxInstances.Upload(stressMode ? stressBoxes : boxes);
+			instancesDirty = false;
+		}
+
 		// Clear color buffer & depth buffer
 		glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -191,7 +255,6 @@ int main()
 		shaderProgram.use();
 
 		// create transformations
-		glm::mat4 model = glm::mat4(1.0f);
 		glm::mat4 view = glm::mat4(1.0f);
 		//model = glm::rotate(model, (float)glfwGetTime() * glm::radians(50.0f), glm::vec3(0.5f, 1.0f, 0.0f));
 		view = glm::translate(view, glm::vec3(0.0f, 0.0f, -3.0f));
@@ -199,22 +262,12 @@ int main()
 		unsigned int viewLoc = glGetUniformLocation(shaderProgram.ID, "view");
 		// pass transformations to shader program
 		glUniformMatrix4fv(viewLoc, 1, GL_FALSE, &view[0][0]);
+		shaderProgram.setFloat("time", (float)currentFrameTime);
 
-		// render box
+		// render boxes, model matrices and spin come from the instance buffer
+		boxInstances.Bind();
 		glBindVertexArray(VAO);
-		for (unsigned int i = 0; i < 10; i++)
-		{
-			// calculate the model matrix for each object and pass it to shader before drawing
-			glm::mat4 model = glm::mat4(1.0f);
-			model = glm::translate(model, cubePositions[i]);
-			float angle = 25.0f * i;
-			if (!(i % 3))
-				angle = (angle == 0) ? (float)glfwGetTime() * 25.0f : (float)glfwGetTime() * angle;
-			model = glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
-			shaderProgram.setMat4("model", model);
-
-			glDrawArrays(GL_TRIANGLES, 0, 36);
-		}
+		glDrawArraysInstanced(GL_TRIANGLES, 0, 36, boxInstances.Count());
 
 		// glfw: swap buffers and poll IO events
 		glfwSwapBuffers(window);
@@ -223,6 +276,7 @@ int main()
 
 	glDeleteVertexArrays(1, &VAO);
 	glDeleteBuffers(1, &VBO);
+	boxInstances.Release();
 
 	glfwTerminate();
 	return 0;
@@ -232,6 +286,15 @@ void processInput(GLFWwindow* window)
 {
 	if (glfwGetKey(window, GLFW_KEY_ESCAPE))
 		glfwSetWindowShouldClose(window, true);
+
+	bool stressKeyDown = glfwGetKey(window, GLFW_KEY_I) == GLFW_PRESS;
+	if (stressKeyDown && !stressKeyDownLastFrame)
+	{
+		stressMode = !stressMode;
+		instancesDirty = true;
+		std::cout << "Stress mode: " << (stressMode ? "ON" : "OFF") << std::endl;
+	}
+	stressKeyDownLastFrame = stressKeyDown;
 }
 
 void FrameBufferSizeCallback(GLFWwindow* window, int width, int height)
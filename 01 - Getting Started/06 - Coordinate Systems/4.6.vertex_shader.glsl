@@ -5,12 +5,40 @@ layout (location = 1) in vec2 aTexCoord;
 
 out vec2 TexCoord;
 
-uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
+// seconds since start, drives the per-instance spin
+uniform float time;
+
+// per-instance data, InstanceBuffer<CubeInstance> in InstanceBuffer.h
+struct CubeInstance
+{
+    mat4 model;
+    // xyz = rotation axis, w = angular speed (radians per second)
+    vec4 spin;
+};
+
+layout (std430, binding = 0) readonly buffer CubeInstances
+{
+    CubeInstance instances[];
+};
+
+// rotation matrix around a unit axis (Rodrigues)
+mat3 rotation(vec3 axis, float angle)
+{
+    float s = sin(angle);
+    float c = cos(angle);
+    float t = 1.0 - c;
+    return mat3(t * axis.x * axis.x + c,          t * axis.x * axis.y + s * axis.z, t * axis.x * axis.z - s * axis.y,
+                t * axis.x * axis.y - s * axis.z, t * axis.y * axis.y + c,          t * axis.y * axis.z + s * axis.x,
+                t * axis.x * axis.z + s * axis.y, t * axis.y * axis.z - s * axis.x, t * axis.z * axis.z + c);
+}
 
 void main()
 {
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    CubeInstance instance = instances[gl_InstanceID];
+    mat3 spin = instance.spin.w != 0.0 ? rotation(instance.spin.xyz, instance.spin.w * time) : mat3(1.0);
+
+    gl_Position = projection * view * instance.model * vec4(spin * aPos, 1.0);
     TexCoord = aTexCoord;
 }
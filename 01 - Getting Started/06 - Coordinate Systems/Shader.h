@@ -69,6 +69,11 @@ public:
 		glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
 	}
 
+	void setFloat(const std::string& name, float x) const
+	{
+		glUniform1f(glGetUniformLocation(ID, name.c_str()), x);
+	}
+
 private:
 	void checkCompileErrors(GLuint id, std::string type)
 	{
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "Shader.h"
+
+#include <iostream>
+#include <iomanip>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Fixed-function state a combination is drawn with; drivers may recompile a program when any of it changes
+struct WarmupState
+{
+	bool depthTest = true;
+	bool blend = false;
+	GLenum polygonMode = GL_FILL;
+};
+
+// Drivers finish compiling a program at its first draw with a given state, which shows up as a hitch the first
+// time the demo switches to it. Register every program/VAO/state combination the render loop can reach, then
+// Run() once during loading: each one is drawn into a tiny offscreen target and timed with glFinish.
+class ShaderWarmup
+{
+public:
+	ShaderWarmup(int size = 4) : size(size)
+	{
+	}
+
+	// setup sets the uniforms/textures the draw needs, the result is never looked at
+	void Add(const std::string& name, Shader& shader, unsigned int vao, GLsizei vertexCount,
+		std::function<void(Shader&)> setup = nullptr, WarmupState state = WarmupState())
+	{
+		combinations.push_back({ name, &shader, vao, vertexCount, setup, state });
+	}
+
+	void Run()
+	{
+		GLint previousFramebuffer = 0, previousProgram = 0, previousVAO = 0;
+		GLint previousViewport[4], previousPolygonMode[2];
+		glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+		glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+		glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previousVAO);
+		glGetIntegerv(GL_VIEWPORT, previousViewport);
+		glGetIntegerv(GL_POLYGON_MODE, previousPolygonMode);
+		GLboolean previousDepthTest = glIsEnabled(GL_DEPTH_TEST);
+		GLboolean previousBlend = glIsEnabled(GL_BLEND);
+
+		unsigned int framebuffer, colorBuffer, depthBuffer;
+		glGenFramebuffers(1, &framebuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		glGenRenderbuffers(1, &colorBuffer);
+		glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, size, size);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+		glGenRenderbuffers(1, &depthBuffer);
+		glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, size, size);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+			std::cout << "ERROR::WARMUP::FRAMEBUFFER_INCOMPLETE" << std::endl;
+		glViewport(0, 0, size, size);
+
+		// nothing queued yet, so each glFinish below only waits for its own draw
+		glFinish();
+		double total = 0.0;
+		for (const Combination& combination : combinations)
+		{
+			double start = glfwGetTime();
+
+			if (combination.state.depthTest)
+				glEnable(GL_DEPTH_TEST);
+			else
+				glDisable(GL_DEPTH_TEST);
+			if (combination.state.blend)
+				glEnable(GL_BLEND);
+			else
+				glDisable(GL_BLEND);
+			glPolygonMode(GL_FRONT_AND_BACK, combination.state.polygonMode);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+			combination.shader->use();
+			if (combination.setup)
+				combination.setup(*combination.shader);
+			glBindVertexArray(combination.vao);
+			glDrawArrays(GL_TRIANGLES, 0, combination.vertexCount);
+			glFinish();
+
+			double milliseconds = (glfwGetTime() - start) * 1000.0;
+			total += milliseconds;
+			std::cout << "SHADER::WARMUP " << std::left << std::setw(32) << combination.name << std::right
+				<< std::fixed << std::setprecision(2) << std::setw(8) << milliseconds << " ms" << std::endl;
+		}
+		std::cout << "SHADER::WARMUP " << combinations.size() << " combinations in "
+			<< std::fixed << std::setprecision(2) << total << " ms" << std::endl;
+
+		glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+		glDeleteFramebuffers(1, &framebuffer);
+		glDeleteRenderbuffers(1, &colorBuffer);
+		glDeleteRenderbuffers(1, &depthBuffer);
+		glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+		glPolygonMode(GL_FRONT_AND_BACK, previousPolygonMode[0]);
+		if (previousDepthTest)
+			glEnable(GL_DEPTH_TEST);
+		else
+			glDisable(GL_DEPTH_TEST);
+		if (previousBlend)
+			glEnable(GL_BLEND);
+		else
+			glDisable(GL_BLEND);
+		glUseProgram(previousProgram);
+		glBindVertexArray(previousVAO);
+	}
+
+private:
+	struct Combination
+	{
+		std::string name;
+		Shader* shader;
+		unsigned int vao;
+		GLsizei vertexCount;
+		std::function<void(Shader&)> setup;
+		WarmupState state;
+	};
+
+	int size;
+	std::vector<Combination> combinations;
+};
@@ -10,6 +10,7 @@
 
 #include "Shader.h"
 #include "Camera.h"
+#include "ShaderWarmup.h"
 
 #include <iostream>
 
@@ -167,6 +168,21 @@ int main()
 	glEnable(GL_DEPTH_TEST);
 	camera.LookAt(glm::vec3(0.0f));
 
+	// Warm up both shading methods in fill and wireframe (keys 1/2) so neither the combo box nor the
+	// polygon mode switch pays for a deferred driver compile on its first frame
+	ShaderWarmup warmup;
+	const GLenum polygonModes[2] = { GL_FILL, GL_LINE };
+	for (GLenum polygonMode : polygonModes)
+	{
+		WarmupState state;
+		state.polygonMode = polygonMode;
+		std::string suffix = polygonMode == GL_FILL ? " fill" : " line";
+		warmup.Add(std::string("cube ") + shadingMethods[0] + suffix, gouraudShader, cubeVAO, 36, nullptr, state);
+		warmup.Add(std::string("cube ") + shadingMethods[1] + suffix, phongShader, cubeVAO, 36, nullptr, state);
+		warmup.Add("lightCube" + suffix, lightCubeShader, lightVAO, 36, nullptr, state);
+	}
+	warmup.Run();
+
 	// ImGui
 	IMGUI_CHECKVERSION();
 	ImGui::CreateContext();
@@ -0,0 +1,232 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include "stb_image.h"
+
+#include "Shader.h"
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <future>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Resources are declared by name up front but only materialized the first time they are asked for.
+// Textures decode on a worker thread (stb_image) and are uploaded on the GL thread by Update(); until then
+// Texture() hands out a 1x1 black placeholder. Shaders compile synchronously on first Get, as GL requires.
+// Report() lists what was loaded, how long it took, and what was declared but never touched.
+class ResourceRegistry
+{
+public:
+	~ResourceRegistry()
+	{
+		for (auto& entry : textures)
+			if (entry.second.decode.valid())
+				stbi_image_free(entry.second.decode.get().data);
+		Release();
+	}
+
+	// Deletes every uploaded texture and the placeholder. Needs the context, so call it before glfwTerminate;
+	// the destructor only repeats it while a context is still current.
+	void Release()
+	{
+		if (!glfwGetCurrentContext())
+			return;
+		for (auto& entry : textures)
+		{
+			if (entry.second.id)
+				glDeleteTextures(1, &entry.second.id);
+			entry.second.id = 0;
+		}
+		if (placeholderID)
+			glDeleteTextures(1, &placeholderID);
+		placeholderID = 0;
+	}
+
+	void DeclareTexture(const std::string& name, const std::string& path)
+	{
+		textures[name].path = path;
+	}
+
+	void DeclareShader(const std::string& name, const std::string& vertexPath, const std::string& fragmentPath,
+		const std::vector<std::string>& defines = {})
+	{
+		ShaderEntry& entry = shaders[name];
+		entry.vertexPath = vertexPath;
+		entry.fragmentPath = fragmentPath;
+		entry.defines = defines;
+	}
+
+	// Starts decoding without counting as a use, for resources the first frame is known to need
+	void Prefetch(const std::string& name)
+	{
+		auto found = textures.find(name);
+		if (found != textures.end())
+			startDecode(found->second);
+	}
+
+	unsigned int Texture(const std::string& name)
+	{
+		auto found = textures.find(name);
+		if (found == textures.end())
+		{
+			std::cout << "ERROR::RESOURCE::UNDECLARED_TEXTURE " << name << std::endl;
+			return placeholder();
+		}
+		TextureEntry& entry = found->second;
+		entry.used = true;
+		startDecode(entry);
+		return entry.id ? entry.id : placeholder();
+	}
+
+	Shader& GetShader(const std::string& name)
+	{
+		ShaderEntry& entry = shaders[name];
+		entry.used = true;
+		if (!entry.shader)
+		{
+			auto start = std::chrono::steady_clock::now();
+			entry.shader.reset(new Shader(entry.vertexPath.c_str(), entry.fragmentPath.c_str(), entry.defines));
+			entry.loadMilliseconds = millisecondsSince(start);
+		}
+		return *entry.shader;
+	}
+
+	// Uploads every texture whose decode has finished, call once per frame on the GL thread
+	void Update()
+	{
+		for (auto& entry : textures)
+		{
+			TextureEntry& texture = entry.second;
+			if (!texture.decode.valid() || texture.decode.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+				continue;
+			auto start = std::chrono::steady_clock::now();
+			upload(entry.first, texture, texture.decode.get());
+			texture.loadMilliseconds += millisecondsSince(start);
+		}
+	}
+
+	void Report() const
+	{
+		std::cout << "RESOURCE::REPORT" << std::endl;
+		std::vector<std::string> untouched;
+		for (const auto& entry : textures)
+		{
+			if (entry.second.used)
+				std::cout << "  texture " << std::left << std::setw(16) << entry.first << std::right << std::fixed
+					<< std::setprecision(2) << std::setw(8) << entry.second.loadMilliseconds << " ms" << std::endl;
+			else
+				untouched.push_back("texture " + entry.first + (entry.second.id ? " (prefetched)" : ""));
+		}
+		for (const auto& entry : shaders)
+		{
+			if (entry.second.used)
+				std::cout << "  shader  " << std::left << std::setw(16) << entry.first << std::right << std::fixed
+					<< std::setprecision(2) << std::setw(8) << entry.second.loadMilliseconds << " ms" << std::endl;
+			else
+				untouched.push_back("shader " + entry.first);
+		}
+		for (const std::string& name : untouched)
+			std::cout << "  never used: " << name << std::endl;
+	}
+
+private:
+	struct Image
+	{
+		unsigned char* data = nullptr;
+		int width = 0, height = 0, components = 0;
+		double decodeMilliseconds = 0.0;
+	};
+
+	struct TextureEntry
+	{
+		std::string path;
+		unsigned int id = 0;
+		bool used = false;
+		bool requested = false;
+		double loadMilliseconds = 0.0;
+		std::future<Image> decode;
+	};
+
+	struct ShaderEntry
+	{
+		std::string vertexPath, fragmentPath;
+		std::vector<std::string> defines;
+		std::unique_ptr<Shader> shader;
+		bool used = false;
+		double loadMilliseconds = 0.0;
+	};
+
+	std::map<std::string, TextureEntry> textures;
+	std::map<std::string, ShaderEntry> shaders;
+	unsigned int placeholderID = 0;
+
+	static double millisecondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	void startDecode(TextureEntry& entry)
+	{
+		if (entry.requested)
+			return;
+		entry.requested = true;
+		std::string path = entry.path;
+		entry.decode = std::async(std::launch::async, [path]() {
+			auto start = std::chrono::steady_clock::now();
+			Image image;
+			image.data = stbi_load(path.c_str(), &image.width, &image.height, &image.components, 0);
+			image.decodeMilliseconds = millisecondsSince(start);
+			return image;
+		});
+	}
+
+	void upload(const std::string& name, TextureEntry& entry, const Image& image)
+	{
+		entry.loadMilliseconds = image.decodeMilliseconds;
+		if (!image.data)
+		{
+			std::cout << "Texture failed to load at path: " << entry.path << std::endl;
+			return;
+		}
+
+		GLenum format = GL_RGB;
+		if (image.components == 1)
+			format = GL_RED;
+		else if (image.components == 3)
+			format = GL_RGB;
+		else if (image.components == 4)
+			format = GL_RGBA;
+
+		glGenTextures(1, &entry.id);
+		glBindTexture(GL_TEXTURE_2D, entry.id);
+		glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, image.data);
+		glGenerateMipmap(GL_TEXTURE_2D);
+
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+		stbi_image_free(image.data);
+		std::cout << "RESOURCE::LOADED texture " << name << std::endl;
+	}
+
+	unsigned int placeholder()
+	{
+		if (!placeholderID)
+		{
+			unsigned char black[4] = { 0, 0, 0, 255 };
+			glGenTextures(1, &placeholderID);
+			glBindTexture(GL_TEXTURE_2D, placeholderID);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, black);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		}
+		return placeholderID;
+	}
+};
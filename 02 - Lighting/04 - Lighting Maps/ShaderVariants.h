@@ -0,0 +1,57 @@
+#pragma once
+
+#include "Shader.h"
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+
+// Shader permutations: one source pair, many programs. Bit i of a variant key switches keywords[i] on as a
+// #define, lightCount becomes NR_LIGHTS. A variant is compiled the first time it is requested and is then
+// shared by every material asking for the same key.
+class ShaderVariants
+{
+public:
+	ShaderVariants(const char* vertexPath, const char* fragmentPath, const std::vector<std::string>& keywords)
+		: vertexPath(vertexPath), fragmentPath(fragmentPath), keywords(keywords)
+	{
+	}
+
+	Shader& Get(uint32_t keywordMask, int lightCount = 1)
+	{
+		uint64_t key = (static_cast<uint64_t>(lightCount) << 32) | keywordMask;
+		auto found = variants.find(key);
+		if (found != variants.end())
+			return *found->second;
+
+		std::vector<std::string> defines;
+		std::string name;
+		for (size_t i = 0; i < keywords.size(); i++)
+		{
+			if (keywordMask & (1u << i))
+			{
+				defines.push_back(keywords[i]);
+				name += keywords[i] + " ";
+			}
+		}
+		defines.push_back("NR_LIGHTS " + std::to_string(lightCount));
+		std::cout << "SHADER::VARIANT::COMPILE " << fragmentPath << ": " << name << "NR_LIGHTS=" << lightCount << std::endl;
+
+		std::unique_ptr<Shader>& variant = variants[key];
+		variant = std::make_unique<Shader>(vertexPath.c_str(), fragmentPath.c_str(), defines);
+		return *variant;
+	}
+
+	size_t CompiledCount() const
+	{
+		return variants.size();
+	}
+
+private:
+	std::string vertexPath, fragmentPath;
+	std::vector<std::string> keywords;
+	std::unordered_map<uint64_t, std::unique_ptr<Shader>> variants;
+};
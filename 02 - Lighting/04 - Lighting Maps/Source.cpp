@@ -6,6 +6,8 @@
 #include "stb_image.h" 
 
 #include "Shader.h"
+#include "ShaderVariants.h"
+#include "ResourceRegistry.h"
 #include "Camera.h"
 
 #include <iostream>
@@ -13,7 +15,6 @@
 void processInput(GLFWwindow* window);
 void FramebufferSizeCallback(GLFWwindow* window, int width, int height);
 void MouseCallback(GLFWwindow* window, double xPos, double yPos);
-unsigned int loadTexture(char const* path);
 
 // Settings
 const unsigned int SCR_WIDTH = 1024;
@@ -43,7 +44,19 @@ float rotationSpeed = 1.0f;
 
 // ImGUI
 const char* shadingMethods[] = { "Gouraud", "Phong" };
-static int shadingMethods_current = 0;
+static int shadingMethods_current = 1;
+bool gKeyPressed = false;
+// the emission layer is on as in the original chapter, E turns it off; its textures and the Gouraud
+// variant are still only loaded the first time a frame needs them
+bool emissionEnabled = true;
+bool eKeyPressed = false;
+// cube.fs keywords, bit i of a variant key enables cubeKeywords[i]
+enum CUBE_KEYWORDS : uint32_t
+{
+	KEYWORD_SHADING_GOURAUD = 1 << 0,
+	KEYWORD_EMISSION_MAP = 1 << 1
+};
+const std::vector<std::string> cubeKeywords = { "SHADING_GOURAUD", "EMISSION_MAP" };
 // Material properties
 float materialShininess = 64.0f;
 // Light properties
@@ -80,17 +93,22 @@ int main()
 		return -1;
 	}
 
-	// Shaders
-	Shader phongShader = Shader("cubeFrag.vs", "cubeFrag.fs");
-	Shader gouraudShader = Shader("cubeVert.vs", "cubeVert.fs");
-	Shader lightCubeShader = Shader("lightCube.vs", "lightCube.fs");
+	// Resources, declared here but loaded the first time the render loop asks for them
+	ResourceRegistry resources;
+	resources.DeclareShader("lightCube", "lightCube.vs", "lightCube.fs");
+	resources.DeclareTexture("diffuse", "diffuse.png");
+	resources.DeclareTexture("specular", "specular.png");
+	resources.DeclareTexture("emission", "emission.png");
+	//resources.DeclareTexture("emission", "matrix.jpg");
+	resources.DeclareTexture("gradient", "gradient.jpg");
+	// the first frame needs these, decode them while the rest of the setup runs
+	resources.Prefetch("diffuse");
+	resources.Prefetch("specular");
+
+	// Shaders, Phong and Gouraud are variants of cube.vs/cube.fs compiled on first use
+	ShaderVariants cubeShaders("cube.vs", "cube.fs", cubeKeywords);
 
-	Shader* cubeShader = &phongShader;
-	cubeShader->use();
-	cubeShader->setInt("material.diffuse", 0);
-	cubeShader->setInt("material.specular", 1);
-	cubeShader->setInt("material.emission", 2);
-	cubeShader->setInt("material.gradient", 3);
+	Shader* cubeShader = nullptr;
 
 	// Vertex Data
 	float vertices[] = {
@@ -167,13 +185,6 @@ int main()
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(float) * 8, (void*)0);
 	glEnableVertexAttribArray(0);
 
-	// Texture
-	unsigned int diffuseMap = loadTexture("diffuse.png");
-	unsigned int specularMap = loadTexture("specular.png");
-	unsigned int emissionMap = loadTexture("emission.png");
-	//unsigned int emissionMap = loadTexture("matrix.jpg");
-	unsigned int gradientMap = loadTexture("gradient.jpg");
-
 	// Configure global OpenGL state
 	glEnable(GL_DEPTH_TEST);
 	camera.LookAt(glm::vec3(0.0f));
@@ -188,11 +199,13 @@ int main()
 
 		// Process input
 		processInput(window);
+		resources.Update();
 
 		glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 		// Draw light cube
+		Shader& lightCubeShader = resources.GetShader("lightCube");
 		lightCubeShader.use();
 		// view/projection transformations
 		glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
@@ -222,8 +235,16 @@ int main()
 		glDrawArrays(GL_TRIANGLES, 0, 36);
 
 		// Draw coral cube
+		uint32_t cubeVariant = emissionEnabled ? static_cast<uint32_t>(KEYWORD_EMISSION_MAP) : 0u;
+		if (shadingMethods_current == 0)
+			cubeVariant |= KEYWORD_SHADING_GOURAUD;
+		cubeShader = &cubeShaders.Get(cubeVariant);
 		cubeShader->use();
 		// set uniforms
+		cubeShader->setInt("material.diffuse", 0);
+		cubeShader->setInt("material.specular", 1);
+		cubeShader->setInt("material.emission", 2);
+		cubeShader->setInt("material.gradient", 3);
 		cubeShader->setFloat("material.shininess", materialShininess);
 		
 		cubeShader->setVec3("light.ambient", lightColor * lightAmbient);
@@ -240,13 +261,16 @@ int main()
 		// bind diffuse map
 		cubeShader->setFloat("time", glfwGetTime());
 		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, diffuseMap);
+		glBindTexture(GL_TEXTURE_2D, resources.Texture("diffuse"));
 		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, specularMap);
-		glActiveTexture(GL_TEXTURE2);
-		glBindTexture(GL_TEXTURE_2D, emissionMap);
-		glActiveTexture(GL_TEXTURE3);
-		glBindTexture(GL_TEXTURE_2D, gradientMap);
+		glBindTexture(GL_TEXTURE_2D, resources.Texture("specular"));
+		if (emissionEnabled)
+		{
+			glActiveTexture(GL_TEXTURE2);
+			glBindTexture(GL_TEXTURE_2D, resources.Texture("emission"));
+			glActiveTexture(GL_TEXTURE3);
+			glBindTexture(GL_TEXTURE_2D, resources.Texture("gradient"));
+		}
 
 		// render the cube
 		glBindVertexArray(cubeVAO);
@@ -256,6 +280,9 @@ int main()
 		glfwPollEvents();
 	}
 
+	resources.Report();
+	resources.Release();
+
 	glDeleteVertexArrays(1, &cubeVAO);
 	glDeleteVertexArrays(1, &lightVAO);
 	glDeleteBuffers(1, &VBO);
@@ -285,6 +312,30 @@ void processInput(GLFWwindow* window)
 		vKeyPressed = false;  
 	}
 
+	// toggle shading method
+	if (glfwGetKey(window, GLFW_KEY_G) == GLFW_PRESS && !gKeyPressed)
+	{
+		shadingMethods_current = 1 - shadingMethods_current;
+		std::cout << "Shading: " << shadingMethods[shadingMethods_current] << std::endl;
+		gKeyPressed = true;
+	}
+	if (glfwGetKey(window, GLFW_KEY_G) == GLFW_RELEASE)
+	{
+		gKeyPressed = false;
+	}
+
+	// toggle emission map
+	if (glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS && !eKeyPressed)
+	{
+		emissionEnabled = !emissionEnabled;
+		std::cout << "Emission: " << (emissionEnabled ? "on" : "off") << std::endl;
+		eKeyPressed = true;
+	}
+	if (glfwGetKey(window, GLFW_KEY_E) == GLFW_RELEASE)
+	{
+		eKeyPressed = false;
+	}
+
 	if (glfwGetKey(window, GLFW_KEY_1))
 		glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 	if (glfwGetKey(window, GLFW_KEY_2))
@@ -328,40 +379,3 @@ void MouseCallback(GLFWwindow* window, double xPosIn, double yPosIn)
 
 	camera.ProcessMouseMovement(xOffset, yOffset);
 }
-
-unsigned int loadTexture(char const* path)
-{
-	unsigned int textureID;
-	glGenTextures(1, &textureID);
-
-	int width, height, nrComponents;
-	unsigned char* data = stbi_load(path, &width, &height, &nrComponents, 0);
-	if (data)
-	{
-		GLenum format;
-		if (nrComponents == 1)
-			format = GL_RED;
-		else if (nrComponents == 3)
-			format = GL_RGB;
-		else if (nrComponents == 4)
-			format = GL_RGBA;
-
-		glBindTexture(GL_TEXTURE_2D, textureID);
-		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
-
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		stbi_image_free(data);
-	}
-	else
-	{
-		std::cout << "Texture failed to load at path: " << path << std::endl;
-		stbi_image_free(data);
-	}
-
-	return textureID;
-}
@@ -1,4 +1,7 @@
-// Per-Fragment Shading (Phong Shading)
+// Lighting maps cube
+// Keywords, injected by ShaderVariants:
+//   SHADING_GOURAUD uses the per-vertex lighting from cube.vs, otherwise lighting is per fragment (Phong shading)
+//   EMISSION_MAP adds the animated emission map tinted by the gradient map
 #version 460 core
 
 in vec3 FragPos;
@@ -30,32 +33,48 @@ uniform Material material;
 uniform Light light;
 uniform float time;
 
+#ifdef SHADING_GOURAUD
+in vec3 LightDiffuse;
+in vec3 LightSpecular;
+#endif
+
 void main()
 {
+    vec3 diffuseColor = texture(material.diffuse, TexCoords).rgb;
+    vec3 specularColor = texture(material.specular, TexCoords).rgb;
+
+#ifdef SHADING_GOURAUD
+    vec3 result = LightDiffuse * diffuseColor + LightSpecular * specularColor;
+#else
     // ambient
-    vec3 ambient = light.ambient * texture(material.diffuse, TexCoords).rgb;
+    vec3 ambient = light.ambient * diffuseColor;
     
     // diffuse
     vec3 norm = normalize(Normal);
     vec3 lightDir = normalize(light.position - FragPos);
     float diff = max(dot(norm, lightDir), 0.0);
-    vec3 diffuse = light.diffuse * diff * texture(material.diffuse, TexCoords).rgb;
+    vec3 diffuse = light.diffuse * diff * diffuseColor;
 
     // specular
     vec3 viewDir = normalize(viewPos - FragPos);
     vec3 reflectDir = reflect(-lightDir, norm);
     float spec = pow(max(dot(viewDir, reflectDir), 0.0f), float(material.shininess));
-    vec3 specular = light.specular * spec * texture(material.specular, TexCoords).rgb;
+    vec3 specular = light.specular * spec * specularColor;
+
+    vec3 result = ambient + diffuse + specular;
+#endif
 
+#ifdef EMISSION_MAP
     // emission
-    vec3 show = step(vec3(1.0), vec3(1.0) - texture(material.specular, TexCoords).rgb);
+    vec3 show = step(vec3(1.0), vec3(1.0) - specularColor);
     //vec3 emission = texture(material.emission, TexCoords + vec2(0.0, time)).rgb;
     vec3 emission = texture(material.emission, TexCoords).rgb;
     vec3 colorShift = texture(material.gradient, vec2(fract(time * 0.1), 0.5)).rgb;
     emission *= colorShift;
     emission *= show;
     emission *= (sin(time) * 0.5 + 0.5) * 2.0;
-    
-    vec3 result = ambient + diffuse + specular + emission;
+    result += emission;
+#endif
+
     FragColor = vec4(result, 1.0f);
 }
\ No newline at end of file
@@ -0,0 +1,65 @@
+// Lighting maps cube
+// Keywords, injected by ShaderVariants:
+//   SHADING_GOURAUD lights per vertex, otherwise lighting is per fragment (Phong shading)
+#version 460 core
+
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec2 TexCoords;
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+
+#ifdef SHADING_GOURAUD
+struct Material
+{
+    sampler2D diffuse;
+	sampler2D specular;
+    sampler2D emission;
+    sampler2D gradient;
+	float shininess;
+};
+
+struct Light
+{
+	vec3 position;
+	
+	vec3 ambient;
+	vec3 diffuse;
+	vec3 specular;
+};
+
+uniform vec3 viewPos;
+uniform Material material;
+uniform Light light;
+
+// light colors, the fragment shader multiplies them with the maps
+out vec3 LightDiffuse;
+out vec3 LightSpecular;
+#endif
+
+void main()
+{
+	gl_Position = projection * view * model * vec4(aPos, 1.0f); 
+	FragPos = vec3(model * vec4(aPos, 1.0f));
+	Normal = mat3(transpose(inverse(model))) * aNormal;
+	TexCoords = aTexCoords;
+
+#ifdef SHADING_GOURAUD
+	vec3 norm = normalize(Normal);
+	vec3 lightDir = normalize(light.position - FragPos);
+	float diff = max(dot(norm, lightDir), 0.0);
+
+	vec3 viewDir = normalize(viewPos - FragPos);
+	vec3 reflectDir = reflect(-lightDir, norm);
+	float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+
+	LightDiffuse = light.ambient + light.diffuse * diff;
+	LightSpecular = light.specular * spec;
+#endif
+}
\ No newline at end of file
@@ -6,13 +6,16 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <string>
+#include <vector>
 
 class Shader
 {
 public:
 	unsigned int ID;
 
-	Shader(const char* vertexPath, const char* fragmentPath)
+	// defines are injected after the #version line of both stages, e.g. { "LIGHT_SPOT", "NR_LIGHTS 2" }
+	Shader(const char* vertexPath, const char* fragmentPath, const std::vector<std::string>& defines = {})
 	{
 		std::string vertexCode, fragmentCode;
 		std::ifstream vShaderFile, fShaderFile;
@@ -35,6 +38,9 @@ public:
 			std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
 		}
 
+		vertexCode = injectDefines(vertexCode, defines);
+		fragmentCode = injectDefines(fragmentCode, defines);
+
 		const char* vShaderCode = vertexCode.c_str();
 		const char* fShaderCode = fragmentCode.c_str();
 		unsigned int vertexID, fragmentID;
@@ -90,6 +96,21 @@ public:
 	}
 
 private:
+	static std::string injectDefines(const std::string& code, const std::vector<std::string>& defines)
+	{
+		if (defines.empty())
+			return code;
+		std::string block;
+		for (const std::string& define : defines)
+			block += "#define " + define + "\n";
+		// #version has to stay the first statement
+		size_t version = code.find("#version");
+		size_t lineEnd = version == std::string::npos ? std::string::npos : code.find('\n', version);
+		if (lineEnd == std::string::npos)
+			return version == std::string::npos ? block + code : code + "\n" + block;
+		return code.substr(0, lineEnd + 1) + block + code.substr(lineEnd + 1);
+	}
+
 	void checkCompileErrors(GLuint id, std::string type)
 	{
 		GLint success;
@@ -6,9 +6,14 @@
 #include "stb_image.h" 
 
 #include "Shader.h"
+#include "ShaderVariants.h"
+#include "ShaderWarmup.h"
 #include "Camera.h"
+#include "InstanceBuffer.h"
 
 #include <iostream>
+#include <iomanip>
+#include <random>
 
 // WINDOW SETTINGS
 const unsigned int SCR_WIDTH = 1024;
@@ -41,6 +46,15 @@ float cutOff = glm::cos(glm::radians(14.5f));
 // MATERIAL
 float materialShininess = 32.0f;
 
+// STRESS MODE, toggled with I: a STRESS_CUBE_SIDE^3 lattice of spinning containers instead of the ten containers
+const int STRESS_CUBE_SIDE = 48;
+const float STRESS_CUBE_SPACING = 2.5f;
+bool stressMode = false;
+bool stressKeyDownLastFrame = false;
+bool instancesDirty = true;
+// frame time is averaged over FRAME_TIME_SAMPLES frames
+const int FRAME_TIME_SAMPLES = 240;
+
 // SHADERS
 enum SHADERS
 {
@@ -50,6 +64,21 @@ enum SHADERS
 };
 SHADERS selectedShader = SHADERS::DIRECTION;
 
+// lightCaster.fs keywords, bit i of a variant key enables lightCasterKeywords[i]
+enum LIGHT_CASTER_KEYWORDS : uint32_t
+{
+	KEYWORD_LIGHT_DIRECTIONAL = 1 << 0,
+	KEYWORD_LIGHT_POINT = 1 << 1,
+	KEYWORD_LIGHT_SPOT = 1 << 2,
+	KEYWORD_SPECULAR_MAP = 1 << 3
+};
+const std::vector<std::string> lightCasterKeywords = { "LIGHT_DIRECTIONAL", "LIGHT_POINT", "LIGHT_SPOT", "SPECULAR_MAP" };
+const uint32_t lightCasterVariants[3] = {
+	KEYWORD_LIGHT_DIRECTIONAL | KEYWORD_SPECULAR_MAP,
+	KEYWORD_LIGHT_POINT | KEYWORD_SPECULAR_MAP,
+	KEYWORD_LIGHT_SPOT | KEYWORD_SPECULAR_MAP
+};
+
 void FrameBufferSizeCallback(GLFWwindow *window, int width, int height);
 void processInput(GLFWwindow* window);
 void MouseCallback(GLFWwindow* window, double xPosIn, double yPosIn);
@@ -84,12 +113,8 @@ int main()
 
 	glEnable(GL_DEPTH_TEST);
 
-	// SHADER
-	Shader shaders[3] = {
-		Shader("directionLight.vs", "directionLight.fs"),
-		Shader("pointLight.vs", "pointLight.fs"),
-		Shader("flashLight.vs", "flashLight.fs")
-	};
+	// SHADER, one variant per caster type, all compiled by the warm-up below
+	ShaderVariants lightCasterShaders("lightCaster.vs", "lightCaster.fs", lightCasterKeywords);
 	
 	Shader* cubeShader;
 	Shader lightCubeShader("lightCube.vs", "lightCube.fs");
@@ -179,6 +204,50 @@ int main()
 	unsigned int diffuseMap = loadTexture("diffuse.png");
 	unsigned int specularMap = loadTexture("specular.png");
 
+	// INSTANCES, every container and the light cube are instances in shader storage buffers, drawn with one call per set
+	std::vector<CubeInstance> containerCubes;
+	for (unsigned int i = 0; i < 10; i++)
+	{
+		glm::mat4 model = glm::translate(glm::mat4(1.0f), cubePositions[i]);
+		float angle = 20.0f * i;
+		model = glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
+		containerCubes.push_back({ model, glm::vec4(0.0f) });
+	}
+	std::vector<CubeInstance> stressCubes; // built the first time stress mode is entered
+
+	glm::mat4 lightModel = glm::translate(glm::mat4(1.0f), lightPos);
+	lightModel = glm::scale(lightModel, glm::vec3(0.2f));
+	std::vector<CubeInstance> lightCubes = { { lightModel, glm::vec4(0.0f) } };
+
+	InstanceBuffer<CubeInstance> cubeInstances(CUBE_INSTANCE_BINDING);
+	InstanceBuffer<CubeInstance> lightCubeInstances(LIGHT_CUBE_INSTANCE_BINDING);
+	cubeInstances.Upload(containerCubes);
+	lightCubeInstances.Upload(lightCubes);
+	instancesDirty = false;
+	// the warm-up draws read instance 0
+	cubeInstances.Bind();
+	lightCubeInstances.Bind();
+
+	// WARM-UP, draw every variant once offscreen so switching casters at runtime does not hitch
+	const char* casterNames[3] = { "lightCaster DIRECTIONAL", "lightCaster POINT", "lightCaster SPOT" };
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, diffuseMap);
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, specularMap);
+	ShaderWarmup warmup;
+	for (int i = 0; i < 3; i++)
+	{
+		warmup.Add(casterNames[i], lightCasterShaders.Get(lightCasterVariants[i]), cubeVAO, 36, [](Shader& shader) {
+			shader.setInt("material.diffuse", 0);
+			shader.setInt("material.specular", 1);
+		});
+	}
+	warmup.Add("lightCube", lightCubeShader, lightCubeVAO, 36);
+	warmup.Run();
+
+	double frameTimeAccumulated = 0.0;
+	int frameTimeFrames = 0;
+
 	while (!glfwWindowShouldClose(window))
 	{
 		// PER-FRAME TIME LOGIC
@@ -186,9 +255,38 @@ int main()
 		deltaTime = currentFrameTime - lastFrameTime;
 		lastFrameTime = currentFrameTime;
 
+		frameTimeAccumulated += deltaTime * 1000.0;
+		if (++frameTimeFrames == FRAME_TIME_SAMPLES)
+		{
+			std::cout << cubeInstances.Count() << " cubes, frame time: " << std::fixed << std::setprecision(3) << frameTimeAccumulated / frameTimeFrames << " ms" << std::endl;
+			frameTimeAccumulated = 0.0;
+			frameTimeFrames = 0;
+		}
+
 		// PROCESS INPUT
 		processInput(window);
-		cubeShader = &shaders[selectedShader];
+		cubeShader = &lightCasterShaders.Get(lightCasterVariants[selectedShader]);
+
+		if (instancesDirty)
+		{
+			if (stressMode && stressCubes.empty())
+			{
+				std::mt19937 rng(1337);
+				std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+				float offset = (STRESS_CUBE_SIDE - 1) * STRESS_CUBE_SPACING * 0.5f;
+				stressCubes.reserve(STRESS_CUBE_SIDE * STRESS_CUBE_SIDE * STRESS_CUBE_SIDE);
+				for (int z = 0; z < STRESS_CUBE_SIDE; z++)
+					for (int y = 0; y < STRESS_CUBE_SIDE; y++)
+						for (int x = 0; x < STRESS_CUBE_SIDE; x++)
+						{
+							glm::vec3 position = glm::vec3(x, y, z) * STRESS_CUBE_SPACING - glm::vec3(offset, offset, offset + 10.0f);
+							glm::vec3 axis = glm::normalize(glm::vec3(unit(rng), unit(rng), unit(rng)) + glm::vec3(0.0f, 0.001f, 0.0f));
+							stressCubes.push_back({ glm::translate(glm::mat4(1.0f), position), glm::vec4(axis, unit(rng) * 2.0f) });
+						}
+			}
+			cubeInstances.Upload(stressMode ? stressCubes : containerCubes);
+			instancesDirty = false;
+		}
 
 		// CLEAR COLOR BUFFER & DEPTH BUFFER
 		glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
@@ -196,41 +294,40 @@ int main()
 
 		cubeShader->use();
 		if (selectedShader == SHADERS::DIRECTION)
-			cubeShader->setVec3("light.direction", directionLightDir);
+			cubeShader->setVec3("lights[0].direction", directionLightDir);
 		else if (selectedShader == SHADERS::POINT)
 		{
-			cubeShader->setVec3("light.position", lightPos);
-			cubeShader->setFloat("light.constant", constant);
-			cubeShader->setFloat("light.linear", linear);
-			cubeShader->setFloat("light.quadratic", quadratic);
+			cubeShader->setVec3("lights[0].position", lightPos);
+			cubeShader->setFloat("lights[0].constant", constant);
+			cubeShader->setFloat("lights[0].linear", linear);
+			cubeShader->setFloat("lights[0].quadratic", quadratic);
 		}
 		else if (selectedShader == SHADERS::SPOT)
 		{
-			cubeShader->setVec3("light.position", camera.Position);
-			cubeShader->setVec3("light.direction", camera.Front);
-			cubeShader->setFloat("light.cutOff", cutOff);
+			cubeShader->setVec3("lights[0].position", camera.Position);
+			cubeShader->setVec3("lights[0].direction", camera.Front);
+			cubeShader->setFloat("lights[0].cutOff", cutOff);
 
-			cubeShader->setFloat("light.constant", constant);
-			cubeShader->setFloat("light.linear", linear);
-			cubeShader->setFloat("light.quadratic", quadratic);
+			cubeShader->setFloat("lights[0].constant", constant);
+			cubeShader->setFloat("lights[0].linear", linear);
+			cubeShader->setFloat("lights[0].quadratic", quadratic);
 		}
 		cubeShader->setInt("material.diffuse", 0);
 		cubeShader->setInt("material.specular", 1);
 		cubeShader->setVec3("viewPos", camera.Position);
 		// LIGHTING PROPERTIES
-		cubeShader->setVec3("light.ambient", lightAmbient);
-		cubeShader->setVec3("light.diffuse", lightDiffuse);
-		cubeShader->setVec3("light.specular", lightSpecular);
+		cubeShader->setVec3("lights[0].ambient", lightAmbient);
+		cubeShader->setVec3("lights[0].diffuse", lightDiffuse);
+		cubeShader->setVec3("lights[0].specular", lightSpecular);
 		// MATERIAL PROPERTIES
 		cubeShader->setFloat("material.shininess", materialShininess);
 
 		// VIEW/PROJECTION MATRICES
-		glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+		glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, stressMode ? 400.0f : 100.0f);
 		glm::mat4 view = camera.GetViewMatrix();
 		cubeShader->setMat4("projection", projection);
 		cubeShader->setMat4("view", view);
-		// MODEL MATRIX
-		glm::mat4 model = glm::mat4(1.0f);
+		cubeShader->setFloat("time", currentFrameTime);
 
 		// BIND TEXTURE MAPS
 		glActiveTexture(GL_TEXTURE0);
@@ -238,20 +335,10 @@ int main()
 		glActiveTexture(GL_TEXTURE1);
 		glBindTexture(GL_TEXTURE_2D, specularMap);
 
-		// RENDER CONTAINERS 
+		// RENDER CONTAINERS, transforms and spin come from the instance buffer
+		cubeInstances.Bind();
 		glBindVertexArray(cubeVAO);
-		for (unsigned int i = 0; i < 10; i++)
-		{
-			// calculate the model matrix for each object and pass it to shader before drawing
-			glm::mat4 model = glm::mat4(1.0f);
-			model = glm::translate(model, cubePositions[i]);
-			float angle = 20.0f * i;
-			model = glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
-			cubeShader->setMat4("model", model);
-
-			glBindVertexArray(cubeVAO);
-			glDrawArrays(GL_TRIANGLES, 0, 36);
-		}
+		glDrawArraysInstanced(GL_TRIANGLES, 0, 36, cubeInstances.Count());
 
 		// RENDER POINT LIGHT CUBE
 		if (selectedShader == SHADERS::POINT)
@@ -259,19 +346,18 @@ int main()
 			lightCubeShader.use();
 			lightCubeShader.setMat4("projection", projection);
 			lightCubeShader.setMat4("view", view);
-			model = glm::mat4(1.0f);
-			model = glm::translate(model, lightPos);
-			model = glm::scale(model, glm::vec3(0.2f));
-			lightCubeShader.setMat4("model", model);
 
+			lightCubeInstances.Bind();
 			glBindVertexArray(lightCubeVAO);
-			glDrawArrays(GL_TRIANGLES, 0, 36);
+			glDrawArraysInstanced(GL_TRIANGLES, 0, 36, lightCubeInstances.Count());
 		}
 
 		glfwSwapBuffers(window);
 		glfwPollEvents();
 	}
 
+	cubeInstances.Release();
+	lightCubeInstances.Release();
 	glfwTerminate();
 
 	return 0;
@@ -302,6 +388,15 @@ void processInput(GLFWwindow* window)
 		camera.ProcessKeyboard(LEFT, deltaTime);
 	if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
 		camera.ProcessKeyboard(RIGHT, deltaTime);
+
+	bool stressKeyDown = glfwGetKey(window, GLFW_KEY_I) == GLFW_PRESS;
+	if (stressKeyDown && !stressKeyDownLastFrame)
+	{
+		stressMode = !stressMode;
+		instancesDirty = true;
+		std::cout << "Stress mode: " << (stressMode ? "ON" : "OFF") << std::endl;
+	}
+	stressKeyDownLastFrame = stressKeyDown;
 }
 
 void MouseCallback(GLFWwindow* window, double xPosIn, double yPosIn)
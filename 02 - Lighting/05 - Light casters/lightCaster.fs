@@ -0,0 +1,101 @@
+#version 460 core
+
+// Keywords, injected by ShaderVariants:
+//   LIGHT_DIRECTIONAL, LIGHT_POINT or LIGHT_SPOT selects the caster type
+//   SPECULAR_MAP samples material.specular, otherwise highlights are white
+//   NR_LIGHTS is the number of lights of that type
+#ifndef NR_LIGHTS
+#define NR_LIGHTS 1
+#endif
+
+struct Material
+{
+    sampler2D diffuse;
+    sampler2D specular;
+    float shininess;
+};
+
+struct Light
+{
+    vec3 position;
+    vec3 direction;
+    float cutOff;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+
+    float constant;
+    float linear;
+    float quadratic;
+};
+
+out vec4 FragColor;
+
+in vec3 FragPos;
+in vec3 Normal;
+in vec2 TexCoords;
+
+uniform vec3 viewPos;
+uniform Material material;
+uniform Light lights[NR_LIGHTS];
+
+vec3 CalcLight(Light light, vec3 norm, vec3 viewDir, vec3 diffuseColor, vec3 specularColor)
+{
+    // ambient
+    vec3 ambient = light.ambient * diffuseColor;
+
+#ifdef LIGHT_DIRECTIONAL
+    vec3 lightDir = normalize(-light.direction);
+#else
+    vec3 lightDir = normalize(light.position - FragPos);
+#endif
+
+#ifdef LIGHT_SPOT
+    // outside the cone only the ambient term remains
+    float theta = dot(normalize(-light.direction), lightDir);
+    if (theta <= light.cutOff)
+        return ambient;
+#endif
+
+    // diffuse
+    float diff = max(dot(norm, lightDir), 0.0);
+    vec3 diffuse = light.diffuse * diff * diffuseColor;
+
+    // specular
+    vec3 reflectDir = reflect(-lightDir, norm);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+    vec3 specular = light.specular * spec * specularColor;
+
+#if defined(LIGHT_POINT) || defined(LIGHT_SPOT)
+    // attenuation
+    float distance = length(light.position - FragPos);
+    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+
+#ifdef LIGHT_POINT
+    // the flashlight keeps its ambient term unattenuated
+    ambient *= attenuation;
+#endif
+    diffuse *= attenuation;
+    specular *= attenuation;
+#endif
+
+    return ambient + diffuse + specular;
+}
+
+void main()
+{
+    vec3 norm = normalize(Normal);
+    vec3 viewDir = normalize(viewPos - FragPos);
+    vec3 diffuseColor = texture(material.diffuse, TexCoords).rgb;
+#ifdef SPECULAR_MAP
+    vec3 specularColor = texture(material.specular, TexCoords).rgb;
+#else
+    vec3 specularColor = vec3(1.0);
+#endif
+
+    vec3 result = vec3(0.0);
+    for (int i = 0; i < NR_LIGHTS; i++)
+        result += CalcLight(lights[i], norm, viewDir, diffuseColor, specularColor);
+    FragColor = vec4(result, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,50 @@
+#version 460 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec2 TexCoords;
+
+uniform mat4 projection;
+uniform mat4 view;
+// seconds since start, drives the per-instance spin
+uniform float time;
+
+// per-instance data, InstanceBuffer<CubeInstance> in InstanceBuffer.h
+struct CubeInstance
+{
+	mat4 model;
+	// xyz = rotation axis, w = angular speed (radians per second)
+	vec4 spin;
+};
+
+layout (std430, binding = 0) readonly buffer CubeInstances
+{
+	CubeInstance instances[];
+};
+
+// rotation matrix around a unit axis (Rodrigues)
+mat3 rotation(vec3 axis, float angle)
+{
+	float s = sin(angle);
+	float c = cos(angle);
+	float t = 1.0 - c;
+	return mat3(t * axis.x * axis.x + c,          t * axis.x * axis.y + s * axis.z, t * axis.x * axis.z - s * axis.y,
+	            t * axis.x * axis.y - s * axis.z, t * axis.y * axis.y + c,          t * axis.y * axis.z + s * axis.x,
+	            t * axis.x * axis.z + s * axis.y, t * axis.y * axis.z - s * axis.x, t * axis.z * axis.z + c);
+}
+
+void main()
+{
+	CubeInstance instance = instances[gl_InstanceID];
+	mat3 spin = instance.spin.w != 0.0 ? rotation(instance.spin.xyz, instance.spin.w * time) : mat3(1.0);
+
+	// instances only translate, rotate and scale uniformly, so mat3(model) transforms normals correctly
+	FragPos = vec3(instance.model * vec4(spin * aPos, 1.0));
+	Normal = mat3(instance.model) * (spin * aNormal);
+	TexCoords = aTexCoords;
+
+	gl_Position = projection * view * vec4(FragPos, 1.0);
+}
@@ -0,0 +1,193 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "Shader.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// Shader storage binding points, after the instance buffers of InstanceBuffer.h
+#define POINT_LIGHT_BINDING 2
+#define CLUSTER_BOUNDS_BINDING 3
+#define CLUSTER_LIGHT_COUNT_BINDING 4
+#define CLUSTER_LIGHT_INDEX_BINDING 5
+#define CLUSTER_OVERFLOW_BINDING 6
+
+// View frustum split into CLUSTER_X * CLUSTER_Y screen tiles and CLUSTER_Z exponential depth slices.
+// The same values are #defined in cluster_bounds.cs, cluster_assign.cs and cubeShader.fs.
+#define CLUSTER_X 16
+#define CLUSTER_Y 9
+#define CLUSTER_Z 24
+#define CLUSTER_COUNT (CLUSTER_X * CLUSTER_Y * CLUSTER_Z)
+// every cluster owns a fixed slice of the index buffer, lights past this are dropped
+#define MAX_LIGHTS_PER_CLUSTER 256
+// local_size_x of both compute shaders
+#define CLUSTER_GROUP_SIZE 128
+
+// std430 mirror of PointLight in cubeShader.fs and cluster_assign.cs
+struct PointLightData
+{
+	// w = radius of influence, see ClusteredLights::Radius
+	glm::vec4 position;
+	glm::vec4 ambient;
+	glm::vec4 diffuse;
+	glm::vec4 specular;
+	// x = constant, y = linear, z = quadratic
+	glm::vec4 attenuation;
+};
+
+static_assert(sizeof(PointLightData) == 80, "PointLightData must match the std430 PointLight struct");
+
+// Clustered forward shading: point lights live in a shader storage buffer, and a compute pass lists for every
+// view space cluster the lights whose sphere of influence touches it. The fragment shader then finds its cluster
+// from gl_FragCoord and its view depth and only loops over that cluster's list, so shading cost follows the
+// lights near each pixel rather than the total light count.
+// Cluster bounds only depend on the projection and are rebuilt when it changes; lights are assigned every frame.
+// The buffers are plain GL names released by Release(), which must run while the context is still current.
+class ClusteredLights
+{
+public:
+	ClusteredLights()
+	{
+		glGenBuffers(1, &lightBuffer);
+		boundsBuffer = createStorage(CLUSTER_COUNT * 2 * sizeof(glm::vec4));
+		countBuffer = createStorage(CLUSTER_COUNT * sizeof(GLuint));
+		indexBuffer = createStorage(CLUSTER_COUNT * MAX_LIGHTS_PER_CLUSTER * sizeof(GLuint));
+		overflowBuffer = createStorage(sizeof(Overflow));
+	}
+
+	ClusteredLights(const ClusteredLights&) = delete;
+	ClusteredLights& operator=(const ClusteredLights&) = delete;
+
+	// lights that touched a cluster whose list was already full, and were left out of it
+	struct Overflow
+	{
+		GLuint clusters = 0;
+		GLuint droppedLights = 0;
+	};
+
+	// Deletes the buffers, call before glfwTerminate
+	void Release()
+	{
+		GLuint buffers[] = { lightBuffer, boundsBuffer, countBuffer, indexBuffer, overflowBuffer };
+		glDeleteBuffers(5, buffers);
+		lightBuffer = boundsBuffer = countBuffer = indexBuffer = overflowBuffer = 0;
+	}
+
+	// Replaces every light, the buffer is only reallocated when it grows
+	void Upload(const std::vector<PointLightData>& lights)
+	{
+		count = static_cast<unsigned int>(lights.size());
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, lightBuffer);
+		if (count > capacity)
+		{
+			glBufferData(GL_SHADER_STORAGE_BUFFER, lights.size() * sizeof(PointLightData), lights.data(), GL_DYNAMIC_DRAW);
+			capacity = count;
+		}
+		else if (count > 0)
+			glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, lights.size() * sizeof(PointLightData), lights.data());
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	}
+
+	// Builds the light lists for this frame. The Frame and Lights blocks must already hold this frame's view
+	// and light count; the draws that follow read the lists after the storage barrier.
+	void Assign(Shader& boundsShader, Shader& assignShader, const glm::mat4& projection, int width, int height, float zNear, float zFar)
+	{
+		Bind();
+		if (projection != boundsProjection || width != boundsWidth || height != boundsHeight)
+		{
+			boundsShader.use();
+			boundsShader.setMat4("inverseProjection", glm::inverse(projection));
+			boundsShader.setVec2("screenSize", glm::vec2(width, height));
+			boundsShader.setFloat("zNear", zNear);
+			boundsShader.setFloat("zFar", zFar);
+			glDispatchCompute(groupCount(), 1, 1);
+			glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+			boundsProjection = projection;
+			boundsWidth = width;
+			boundsHeight = height;
+		}
+		assignShader.use();
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, overflowBuffer);
+		glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+		glDispatchCompute(groupCount(), 1, 1);
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+	}
+
+	void Bind() const
+	{
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, POINT_LIGHT_BINDING, lightBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CLUSTER_BOUNDS_BINDING, boundsBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CLUSTER_LIGHT_COUNT_BINDING, countBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CLUSTER_LIGHT_INDEX_BINDING, indexBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CLUSTER_OVERFLOW_BINDING, overflowBuffer);
+	}
+
+	// Overflow of the last Assign. Waits for the GPU, only meant for the periodic report.
+	Overflow ReadOverflow() const
+	{
+		Overflow overflow;
+		glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, overflowBuffer);
+		glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(Overflow), &overflow);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+		return overflow;
+	}
+
+	unsigned int Count() const
+	{
+		return count;
+	}
+
+	// Depth slice scale and bias, cluster tile size in pixels: the clusterParams of the Lights block.
+	// A view depth d falls in slice floor(log(d) * scale + bias).
+	static glm::vec4 Params(int width, int height, float zNear, float zFar)
+	{
+		float scale = CLUSTER_Z / std::log(zFar / zNear);
+		return glm::vec4(scale, -std::log(zNear) * scale, float(width) / CLUSTER_X, float(height) / CLUSTER_Y);
+	}
+
+	// Distance at which the light's brightest channel, attenuated, drops under threshold. The shaders fade the
+	// light out towards it, so nothing is lost by not listing the light in clusters beyond.
+	static float Radius(const PointLightData& light, float threshold = 1.0f / 64.0f)
+	{
+		// ambient is attenuated like the other terms, so it counts towards the reach too
+		glm::vec3 peak = glm::max(glm::max(glm::vec3(light.diffuse), glm::vec3(light.specular)), glm::vec3(light.ambient));
+		float intensity = std::max({ peak.r, peak.g, peak.b });
+		float c = light.attenuation.x - intensity / threshold;
+		// a light that never reaches the threshold (dark, or dimmer than it even at distance 0) lights nothing
+		if (intensity <= 0.0f || c >= 0.0f)
+			return 0.0f;
+		float b = light.attenuation.y;
+		float a = light.attenuation.z;
+		if (a <= 0.0f)
+			return b > 0.0f ? -c / b : 1.0e6f;
+		return (-b + std::sqrt(b * b - 4.0f * a * c)) / (2.0f * a);
+	}
+
+private:
+	GLuint lightBuffer = 0, boundsBuffer = 0, countBuffer = 0, indexBuffer = 0, overflowBuffer = 0;
+	unsigned int count = 0;
+	unsigned int capacity = 0;
+	glm::mat4 boundsProjection = glm::mat4(0.0f);
+	int boundsWidth = 0, boundsHeight = 0;
+
+	static GLuint createStorage(size_t size)
+	{
+		GLuint buffer;
+		glGenBuffers(1, &buffer);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, size, nullptr, GL_DYNAMIC_COPY);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+		return buffer;
+	}
+
+	static GLuint groupCount()
+	{
+		return (CLUSTER_COUNT + CLUSTER_GROUP_SIZE - 1) / CLUSTER_GROUP_SIZE;
+	}
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// Shader storage binding points, a separate namespace from the uniform block bindings
+#define CUBE_INSTANCE_BINDING 0
+#define LIGHT_CUBE_INSTANCE_BINDING 1
+
+// std430 mirror of CubeInstance in cubeShader.vs/lightCube.vs
+struct CubeInstance
+{
+	glm::mat4 model;
+	// xyz = rotation axis, w = angular speed in radians per second (0 = static); applied in the vertex shader
+	glm::vec4 spin;
+};
+
+static_assert(sizeof(CubeInstance) == 80, "CubeInstance must match the std430 CubeInstance struct");
+
+// Per-instance data for one instanced draw, bound once to a fixed shader storage binding point
+template <typename T>
+class InstanceBuffer
+{
+public:
+	unsigned int ID;
+
+	InstanceBuffer(unsigned int binding) : binding(binding)
+	{
+		glGenBuffers(1, &ID);
+	}
+
+	// Replaces the whole array, the buffer is only reallocated when it grows
+	void Upload(const std::vector<T>& instances)
+	{
+		count = static_cast<unsigned int>(instances.size());
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, ID);
+		if (count > capacity)
+		{
+			glBufferData(GL_SHADER_STORAGE_BUFFER, instances.size() * sizeof(T), instances.data(), GL_STATIC_DRAW);
+			capacity = count;
+		}
+		else
+			glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, instances.size() * sizeof(T), instances.data());
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	}
+
+	void Bind() const
+	{
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, ID);
+	}
+
+	unsigned int Count() const
+	{
+		return count;
+	}
+
+	// Deletes the buffer, call before glfwTerminate
+	void Release()
+	{
+		glDeleteBuffers(1, &ID);
+		ID = 0;
+		count = capacity = 0;
+	}
+
+private:
+	unsigned int binding;
+	unsigned int count = 0;
+	unsigned int capacity = 0;
+};
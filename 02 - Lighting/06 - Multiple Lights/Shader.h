@@ -6,6 +6,17 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+// Location of an active uniform, resolved once after linking. An invalid handle (-1) is ignored by glUniform*.
+struct UniformHandle
+{
+	GLint location = -1;
+	bool IsValid() const { return location >= 0; }
+};
 
 class Shader
 {
@@ -57,39 +68,204 @@ public:
 
 		glDeleteShader(vertexID);
 		glDeleteShader(fragmentID);
+
+		reflectUniforms();
+	}
+
+	// Compute program from a single source file
+	explicit Shader(const char* computePath)
+	{
+		std::string computeCode;
+		std::ifstream cShaderFile;
+		cShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+		try
+		{
+			cShaderFile.open(computePath);
+			std::stringstream cShaderStream;
+			cShaderStream << cShaderFile.rdbuf();
+			cShaderFile.close();
+			computeCode = cShaderStream.str();
+		}
+		catch (std::ifstream::failure& e)
+		{
+			std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
+		}
+
+		const char* cShaderCode = computeCode.c_str();
+		unsigned int computeID = glCreateShader(GL_COMPUTE_SHADER);
+		glShaderSource(computeID, 1, &cShaderCode, NULL);
+		glCompileShader(computeID);
+		checkCompileErrors(computeID, "COMPUTE");
+		ID = glCreateProgram();
+		glAttachShader(ID, computeID);
+		glLinkProgram(ID);
+		checkCompileErrors(ID, "PROGRAM");
+
+		glDeleteShader(computeID);
+
+		reflectUniforms();
 	}
 
+	// When false every name lookup goes back to glGetUniformLocation, for comparing against the cache
+	static inline bool UseUniformCache = true;
+
 	void use() const
 	{
 		glUseProgram(ID);
 	}
 
-	void setInt(const std::string& name, int x) const
+	// Resolve a handle once and keep it, setters taking handles do no hashing and no GL query
+	UniformHandle getUniform(std::string_view name) const
+	{
+		if (!UseUniformCache)
+			return { glGetUniformLocation(ID, std::string(name).c_str()) };
+		if (uniformSlots.empty())
+			return {};
+
+		uint64_t hash = hashName(name);
+		size_t mask = uniformSlots.size() - 1;
+		for (size_t i = hash & mask; ; i = (i + 1) & mask)
+		{
+			const UniformSlot& slot = uniformSlots[i];
+			if (slot.hash == 0)
+				return {};
+			if (slot.hash == hash && std::string_view(uniformNames).substr(slot.nameOffset, slot.nameLength) == name)
+				return { slot.location };
+		}
+	}
+
+	void setInt(UniformHandle uniform, int x) const
+	{
+		glUniform1i(uniform.location, x);
+	}
+
+	void setMat4(UniformHandle uniform, const glm::mat4& mat) const
+	{
+		glUniformMatrix4fv(uniform.location, 1, GL_FALSE, &mat[0][0]);
+	}
+
+	void setVec3(UniformHandle uniform, float x, float y, float z) const
+	{
+		glUniform3f(uniform.location, x, y, z);
+	}
+
+	void setVec3(UniformHandle uniform, glm::vec3 input) const
+	{
+		glUniform3f(uniform.location, input.x, input.y, input.z);
+	}
+
+	void setVec2(UniformHandle uniform, glm::vec2 input) const
+	{
+		glUniform2f(uniform.location, input.x, input.y);
+	}
+
+	void setFloat(UniformHandle uniform, float x) const
+	{
+		glUniform1f(uniform.location, x);
+	}
+
+	void setInt(std::string_view name, int x) const
+	{
+		setInt(getUniform(name), x);
+	}
+
+	void setMat4(std::string_view name, const glm::mat4& mat) const
 	{
-		glUniform1i(glGetUniformLocation(ID, name.c_str()), x);
+		setMat4(getUniform(name), mat);
 	}
 
-	void setMat4(const std::string& name, const glm::mat4& mat) const
+	void setVec3(std::string_view name, float x, float y, float z) const
 	{
-		glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+		setVec3(getUniform(name), x, y, z);
 	}
 
-	void setVec3(const std::string& name, float x, float y, float z) const
+	void setVec3(std::string_view name, glm::vec3 input) const
 	{
-		glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+		setVec3(getUniform(name), input);
 	}
 
-	void setVec3(const std::string& name, glm::vec3 input) const
+	void setVec2(std::string_view name, glm::vec2 input) const
 	{
-		glUniform3f(glGetUniformLocation(ID, name.c_str()), input.x, input.y, input.z);
+		setVec2(getUniform(name), input);
 	}
 
-	void setFloat(const std::string& name, float x) const
+	void setFloat(std::string_view name, float x) const
 	{
-		glUniform1f(glGetUniformLocation(ID, name.c_str()), x);
+		setFloat(getUniform(name), x);
 	}
 
 private:
+	// Open addressing table over every active uniform name, hash 0 marks an empty slot.
+	// Names live back to back in one string so the table itself stays flat.
+	struct UniformSlot
+	{
+		uint64_t hash = 0;
+		uint32_t nameOffset = 0;
+		uint32_t nameLength = 0;
+		GLint location = -1;
+	};
+	std::vector<UniformSlot> uniformSlots;
+	std::string uniformNames;
+
+	static uint64_t hashName(std::string_view name)
+	{
+		// FNV-1a
+		uint64_t hash = 14695981039346656037ull;
+		for (char c : name)
+			hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+		return hash ? hash : 1;
+	}
+
+	void reflectUniforms()
+	{
+		GLint count = 0, maxLength = 0;
+		glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+		glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+		// arrays of basic types report only "name[0]", every element and the bare name get a slot too
+		std::vector<std::pair<std::string, GLint>> entries;
+		std::vector<GLchar> buffer(maxLength > 0 ? maxLength : 1);
+		for (GLint i = 0; i < count; i++)
+		{
+			GLsizei length = 0;
+			GLint size = 0;
+			GLenum type = 0;
+			glGetActiveUniform(ID, i, maxLength, &length, &size, &type, buffer.data());
+			std::string name(buffer.data(), length);
+			GLint location = glGetUniformLocation(ID, name.c_str());
+			// uniform block members have no location
+			if (location < 0)
+				continue;
+			entries.emplace_back(name, location);
+			if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0)
+			{
+				std::string base = name.substr(0, name.size() - 3);
+				entries.emplace_back(base, location);
+				for (GLint element = 1; element < size; element++)
+				{
+					std::string elementName = base + "[" + std::to_string(element) + "]";
+					entries.emplace_back(elementName, glGetUniformLocation(ID, elementName.c_str()));
+				}
+			}
+		}
+
+		// keep the load factor at or under one half
+		size_t capacity = 16;
+		while (capacity < entries.size() * 2)
+			capacity *= 2;
+		uniformSlots.assign(capacity, UniformSlot());
+		uniformNames.clear();
+		for (const auto& entry : entries)
+		{
+			uint64_t hash = hashName(entry.first);
+			size_t i = hash & (capacity - 1);
+			while (uniformSlots[i].hash != 0)
+				i = (i + 1) & (capacity - 1);
+			uniformSlots[i] = { hash, static_cast<uint32_t>(uniformNames.size()), static_cast<uint32_t>(entry.first.size()), entry.second };
+			uniformNames += entry.first;
+		}
+	}
+
 	void checkCompileErrors(GLuint id, std::string type)
 	{
 		GLint success;
@@ -6,9 +6,16 @@
 #include "stb_image.h"
 #include "Shader.h"
 #include "Camera.h"
+#include "UniformBuffer.h"
+#include "InstanceBuffer.h"
+#include "ClusteredLights.h"
 
 #include <iostream>
 #include <format>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
 
 // WINDOW SETTINGS
 const unsigned int SCR_WIDTH = 1024;
@@ -24,6 +31,37 @@ float lastY = SCR_HEIGHT / 2.0f;
 float deltaTime = 0.0f;
 float lastFrameTime = 0.0f;
 
+// UNIFORM CACHE, toggled with U; CPU frame time is averaged over FRAME_TIME_SAMPLES frames
+const int FRAME_TIME_SAMPLES = 240;
+bool uniformKeyDownLastFrame = false;
+
+// STRESS MODE, toggled with I: a STRESS_CUBE_SIDE^3 lattice of spinning cubes instead of the ten containers
+const int STRESS_CUBE_SIDE = 48;
+const float STRESS_CUBE_SPACING = 2.5f;
+bool stressMode = false;
+bool stressKeyDownLastFrame = false;
+bool instancesDirty = true;
+
+// POINT LIGHTS, L cycles through the counts: the four tutorial lights plus orbiting coloured ones.
+// C toggles clustered shading against looping over every light for every fragment.
+const unsigned int LIGHT_COUNTS[] = { 4, 512, 2048, 8192 };
+const int LIGHT_COUNT_STEPS = sizeof(LIGHT_COUNTS) / sizeof(LIGHT_COUNTS[0]);
+int lightCountStep = 0;
+bool lightCountKeyDownLastFrame = false;
+bool clusteredShading = true;
+bool clusteredKeyDownLastFrame = false;
+bool lightsDirty = true;
+
+// circular path of a moving light, evaluated on the CPU and uploaded every frame
+struct LightOrbit
+{
+	glm::vec3 center;
+	float radius;
+	// radians per second
+	float speed;
+	float phase;
+};
+
 // PROTOTYPES
 void FrameBufferSizeCallback(GLFWwindow* window, int width, int height);
 void processInput(GLFWwindow* window);
@@ -61,6 +99,8 @@ int main()
 
 	Shader cubeShader("cubeShader.vs", "cubeShader.fs");
 	Shader lightCubeShader("lightCube.vs", "lightCube.fs");
+	Shader clusterBoundsShader("cluster_bounds.cs");
+	Shader clusterAssignShader("cluster_assign.cs");
 
 	float vertices[] = {
 		// positions          // normals           // texture coords
@@ -158,6 +198,41 @@ int main()
 	cubeShader.setInt("material.diffuse", 0);
 	cubeShader.setInt("material.specular", 1);
 
+	// every cube is one instance in a shader storage buffer, drawn with a single instanced call
+	std::vector<CubeInstance> containerCubes;
+	for (int i = 0; i < 10; ++i)
+	{
+		glm::mat4 model = glm::translate(glm::mat4(1.0f), cubePositions[i]);
+		float angle = 20.0f * i;
+		model = glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
+		containerCubes.push_back({ model, glm::vec4(0.0f) });
+	}
+	std::vector<CubeInstance> stressCubes; // built the first time stress mode is entered
+
+	// one light cube per point light, moved along with it
+	std::vector<CubeInstance> lightCubes;
+	std::vector<PointLightData> pointLights;
+	std::vector<LightOrbit> lightOrbits;
+
+	InstanceBuffer<CubeInstance> cubeInstances(CUBE_INSTANCE_BINDING);
+	InstanceBuffer<CubeInstance> lightCubeInstances(LIGHT_CUBE_INSTANCE_BINDING);
+	ClusteredLights clusteredLights;
+
+	// camera and lights live in uniform buffers bound once, instead of being set on every program
+	UniformBuffer<FrameUniforms> frameBuffer(FRAME_UBO_BINDING);
+	UniformBuffer<LightUniforms> lightBuffer(LIGHTS_UBO_BINDING);
+
+	// the light count and cluster parameters are refreshed every frame, the rest never changes
+	LightUniforms lights = {};
+	lights.dirLight.direction = glm::vec4(-0.2f, -1.0f, -0.3f, 0.0f);
+	lights.dirLight.ambient = glm::vec4(0.05f, 0.05f, 0.05f, 0.0f);
+	lights.dirLight.diffuse = glm::vec4(0.4f, 0.4f, 0.4f, 0.0f);
+	lights.dirLight.specular = glm::vec4(0.5f, 0.5f, 0.5f, 0.0f);
+
+	double cpuTimeAccumulated = 0.0;
+	double frameTimeAccumulated = 0.0;
+	int cpuTimeFrames = 0;
+
 	while (!glfwWindowShouldClose(window))
 	{
 		// PER-FRAME TIME LOGIC
@@ -168,96 +243,153 @@ int main()
 		// PROCESS INPUT
 		processInput(window);
 
+		auto cpuFrameStart = std::chrono::high_resolution_clock::now();
+
+		if (instancesDirty)
+		{
+			if (stressMode && stressCubes.empty())
+			{
+				std::mt19937 rng(1337);
+				std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+				float offset = (STRESS_CUBE_SIDE - 1) * STRESS_CUBE_SPACING * 0.5f;
+				stressCubes.reserve(STRESS_CUBE_SIDE * STRESS_CUBE_SIDE * STRESS_CUBE_SIDE);
+				for (int z = 0; z < STRESS_CUBE_SIDE; z++)
+					for (int y = 0; y < STRESS_CUBE_SIDE; y++)
+						for (int x = 0; x < STRESS_CUBE_SIDE; x++)
+						{
+							glm::vec3 position = glm::vec3(x, y, z) * STRESS_CUBE_SPACING - glm::vec3(offset, offset, offset + 10.0f);
+							glm::vec3 axis = glm::normalize(glm::vec3(unit(rng), unit(rng), unit(rng)) + glm::vec3(0.0f, 0.001f, 0.0f));
+							stressCubes.push_back({ glm::translate(glm::mat4(1.0f), position), glm::vec4(axis, unit(rng) * 2.0f) });
+						}
+			}
+			cubeInstances.Upload(stressMode ? stressCubes : containerCubes);
+			instancesDirty = false;
+		}
+
+		if (lightsDirty)
+		{
+			// the tutorial lights stay where they were, the others are scattered over whatever is being drawn
+			unsigned int lightCount = LIGHT_COUNTS[lightCountStep];
+			pointLights.clear();
+			lightOrbits.clear();
+			for (int i = 0; i < 4; i++)
+			{
+				PointLightData light;
+				light.position = glm::vec4(pointLightPositions[i], 0.0f);
+				light.ambient = glm::vec4(0.05f, 0.05f, 0.05f, 0.0f);
+				light.diffuse = glm::vec4(0.8f, 0.8f, 0.8f, 0.0f);
+				light.specular = glm::vec4(1.0f, 1.0f, 1.0f, 0.0f);
+				light.attenuation = glm::vec4(1.0f, 0.09f, 0.032f, 0.0f);
+				pointLights.push_back(light);
+				lightOrbits.push_back({ pointLightPositions[i], 0.0f, 0.0f, 0.0f });
+			}
+			std::mt19937 rng(7);
+			std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+			float extent = (STRESS_CUBE_SIDE - 1) * STRESS_CUBE_SPACING * 0.5f;
+			glm::vec3 regionMin = stressMode ? glm::vec3(-extent, -extent, -2.0f * extent - 10.0f) : glm::vec3(-20.0f, -10.0f, -40.0f);
+			glm::vec3 regionMax = stressMode ? glm::vec3(extent, extent, -10.0f) : glm::vec3(20.0f, 10.0f, 10.0f);
+			for (unsigned int i = 4; i < lightCount; i++)
+			{
+				glm::vec3 color = glm::vec3(unit(rng), unit(rng), unit(rng));
+				color /= std::max({ color.r, color.g, color.b, 0.01f });
+				PointLightData light;
+				light.ambient = glm::vec4(0.0f);
+				light.diffuse = glm::vec4(color, 0.0f);
+				light.specular = glm::vec4(color, 0.0f);
+				light.attenuation = glm::vec4(1.0f, 0.7f, 1.8f, 0.0f);
+				pointLights.push_back(light);
+				glm::vec3 center = glm::mix(regionMin, regionMax, glm::vec3(unit(rng), unit(rng), unit(rng)));
+				lightOrbits.push_back({ center, 0.5f + 2.0f * unit(rng), (unit(rng) - 0.5f) * 4.0f, unit(rng) * glm::two_pi<float>() });
+			}
+			for (PointLightData& light : pointLights)
+				light.position.w = ClusteredLights::Radius(light);
+			lightCubes.assign(pointLights.size(), { glm::mat4(1.0f), glm::vec4(0.0f) });
+			lightsDirty = false;
+		}
+
+		// MOVE THE LIGHTS, positions and light cubes are uploaded again every frame
+		for (size_t i = 0; i < pointLights.size(); i++)
+		{
+			const LightOrbit& orbit = lightOrbits[i];
+			float angle = orbit.phase + orbit.speed * currentFrameTime;
+			glm::vec3 position = orbit.center + orbit.radius * glm::vec3(std::cos(angle), 0.5f * std::sin(2.0f * angle), std::sin(angle));
+			pointLights[i].position = glm::vec4(position, pointLights[i].position.w);
+			lightCubes[i].model = glm::scale(glm::translate(glm::mat4(1.0f), position), glm::vec3(i < 4 ? 0.2f : 0.08f));
+		}
+		clusteredLights.Upload(pointLights);
+		lightCubeInstances.Upload(lightCubes);
+
 		// CLEAR COLOR BUFFER & DEPTH BUFFER
 		glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+		// PROJECTION / VIEW TRANSFORM, uploaded once for every program
+		float zNear = 0.1f, zFar = stressMode ? 400.0f : 100.0f;
+		FrameUniforms frame;
+		frame.projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, zNear, zFar);
+		frame.view = camera.GetViewMatrix();
+		frame.viewPos = glm::vec4(camera.Position, 1.0f);
+		frame.time = glm::vec4(currentFrameTime, deltaTime, 0.0f, 0.0f);
+		frameBuffer.Update(frame);
+
+		// LIGHT CLUSTERS, rebuilt from this frame's view and light positions before anything is shaded
+		int width, height;
+		glfwGetFramebufferSize(window, &width, &height);
+		lights.lightCount = glm::ivec4(clusteredLights.Count(), clusteredShading ? 1 : 0, 0, 0);
+		lights.clusterParams = ClusteredLights::Params(width, height, zNear, zFar);
+		lightBuffer.Update(lights);
+		if (clusteredShading)
+			clusteredLights.Assign(clusterBoundsShader, clusterAssignShader, frame.projection, width, height, zNear, zFar);
+		else
+			clusteredLights.Bind();
+
 		cubeShader.use();
-		cubeShader.setVec3("viewPos", camera.Position);
 		cubeShader.setFloat("material.shininess", 32.0f);
 
-		// directional light
-		cubeShader.setVec3("dirLight.direction", -0.2f, -1.0f, -0.3f);
-		cubeShader.setVec3("dirLight.ambient", 0.05f, 0.05f, 0.05f);
-		cubeShader.setVec3("dirLight.diffuse", 0.4f, 0.4f, 0.4f);
-		cubeShader.setVec3("dirLight.specular", 0.5f, 0.5f, 0.5f);
-		// point light 1
-		cubeShader.setVec3("pointLights[0].position", pointLightPositions[0]);
-		cubeShader.setVec3("pointLights[0].ambient", 0.05f, 0.05f, 0.05f);
-		cubeShader.setVec3("pointLights[0].diffuse", 0.8f, 0.8f, 0.8f);
-		cubeShader.setVec3("pointLights[0].specular", 1.0f, 1.0f, 1.0f);
-		cubeShader.setFloat("pointLights[0].constant", 1.0f);
-		cubeShader.setFloat("pointLights[0].linear", 0.09f);
-		cubeShader.setFloat("pointLights[0].quadratic", 0.032f);
-		// point light 2
-		cubeShader.setVec3("pointLights[1].position", pointLightPositions[1]);
-		cubeShader.setVec3("pointLights[1].ambient", 0.05f, 0.05f, 0.05f);
-		cubeShader.setVec3("pointLights[1].diffuse", 0.8f, 0.8f, 0.8f);
-		cubeShader.setVec3("pointLights[1].specular", 1.0f, 1.0f, 1.0f);
-		cubeShader.setFloat("pointLights[1].constant", 1.0f);
-		cubeShader.setFloat("pointLights[1].linear", 0.09f);
-		cubeShader.setFloat("pointLights[1].quadratic", 0.032f);
-		// point light 3
-		cubeShader.setVec3("pointLights[2].position", pointLightPositions[2]);
-		cubeShader.setVec3("pointLights[2].ambient", 0.05f, 0.05f, 0.05f);
-		cubeShader.setVec3("pointLights[2].diffuse", 0.8f, 0.8f, 0.8f);
-		cubeShader.setVec3("pointLights[2].specular", 1.0f, 1.0f, 1.0f);
-		cubeShader.setFloat("pointLights[2].constant", 1.0f);
-		cubeShader.setFloat("pointLights[2].linear", 0.09f);
-		cubeShader.setFloat("pointLights[2].quadratic", 0.032f);
-		// point light 4
-		cubeShader.setVec3("pointLights[3].position", pointLightPositions[3]);
-		cubeShader.setVec3("pointLights[3].ambient", 0.05f, 0.05f, 0.05f);
-		cubeShader.setVec3("pointLights[3].diffuse", 0.8f, 0.8f, 0.8f);
-		cubeShader.setVec3("pointLights[3].specular", 1.0f, 1.0f, 1.0f);
-		cubeShader.setFloat("pointLights[3].constant", 1.0f);
-		cubeShader.setFloat("pointLights[3].linear", 0.09f);
-		cubeShader.setFloat("pointLights[3].quadratic", 0.032f);
-
-		// PROJECTION / VIEW TRANSFORM
-		glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-		cubeShader.setMat4("projection", projection);
-		glm::mat4 view = camera.GetViewMatrix();
-		cubeShader.setMat4("view", view);
-
 		// BIND DIFFUSE MAP 
 		glActiveTexture(GL_TEXTURE0);
 		glBindTexture(GL_TEXTURE_2D, diffuseMap);
 		glActiveTexture(GL_TEXTURE1);
 		glBindTexture(GL_TEXTURE_2D, specularMap);
 
-		// MODEL TRANSFORMATION
-		for (int i = 0; i < 10; ++i)
-		{
-			glm::mat4 model = glm::translate(glm::mat4(1.0f), cubePositions[i]);
-			float angle = 20.0f * i;
-			model = glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
-			cubeShader.setMat4("model", model);
-
-			glBindVertexArray(cubeVAO);
-			glDrawArrays(GL_TRIANGLES, 0, 36);
-		}
+		// DRAW CUBES, transforms and spin come from the instance buffer
+		cubeInstances.Bind();
+		glBindVertexArray(cubeVAO);
+		glDrawArraysInstanced(GL_TRIANGLES, 0, 36, cubeInstances.Count());
 
 		// DRAW POINT LIGHT CUBES
 		lightCubeShader.use();
-		lightCubeShader.setMat4("projection", projection);
-		lightCubeShader.setMat4("view", view);
-
+		lightCubeInstances.Bind();
 		glBindVertexArray(lightCubeVAO);
-		for (unsigned int i = 0; i < 4; i++)
+		glDrawArraysInstanced(GL_TRIANGLES, 0, 36, lightCubeInstances.Count());
+
+		// CPU TIME SPENT RECORDING THE FRAME (excludes the swap, which waits on the GPU)
+		cpuTimeAccumulated += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - cpuFrameStart).count();
+		frameTimeAccumulated += deltaTime * 1000.0;
+		if (++cpuTimeFrames == FRAME_TIME_SAMPLES)
 		{
-			glm::mat4 model = glm::mat4(1.0f);
-			model = glm::translate(model, pointLightPositions[i]);
-			model = glm::scale(model, glm::vec3(0.2f)); 
-			lightCubeShader.setMat4("model", model);
-			glDrawArrays(GL_TRIANGLES, 0, 36);
+			std::cout << std::format("{} cubes, {} point lights ({}), CPU frame time ({}): {:.4f} ms, frame time: {:.3f} ms", cubeInstances.Count(),
+				clusteredLights.Count(), clusteredShading ? "clustered" : "every light per fragment", Shader::UseUniformCache ? "uniform cache" : "glGetUniformLocation",
+				cpuTimeAccumulated / cpuTimeFrames, frameTimeAccumulated / cpuTimeFrames) << std::endl;
+			if (clusteredShading)
+			{
+				// full cluster lists drop lights silently in the shader, so say how many
+				ClusteredLights::Overflow overflow = clusteredLights.ReadOverflow();
+				std::cout << std::format("Cluster overflow: {} lights dropped in {} of {} clusters (max {} per cluster)", overflow.droppedLights,
+					overflow.clusters, CLUSTER_COUNT, MAX_LIGHTS_PER_CLUSTER) << std::endl;
+			}
+			cpuTimeAccumulated = 0.0;
+			frameTimeAccumulated = 0.0;
+			cpuTimeFrames = 0;
 		}
 
-		
 		glfwSwapBuffers(window);
 		glfwPollEvents();
 	}
 
+	clusteredLights.Release();
+	cubeInstances.Release();
+	lightCubeInstances.Release();
 	glfwTerminate();
 
 	return 0;
@@ -302,6 +434,41 @@ void processInput(GLFWwindow* window)
 		camera.ProcessKeyboard(LEFT, deltaTime);
 	if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
 		camera.ProcessKeyboard(RIGHT, deltaTime);
+
+	bool uniformKeyDown = glfwGetKey(window, GLFW_KEY_U) == GLFW_PRESS;
+	if (uniformKeyDown && !uniformKeyDownLastFrame)
+	{
+		Shader::UseUniformCache = !Shader::UseUniformCache;
+		std::cout << "Uniform cache: " << (Shader::UseUniformCache ? "ON" : "OFF") << std::endl;
+	}
+	uniformKeyDownLastFrame = uniformKeyDown;
+
+	bool stressKeyDown = glfwGetKey(window, GLFW_KEY_I) == GLFW_PRESS;
+	if (stressKeyDown && !stressKeyDownLastFrame)
+	{
+		stressMode = !stressMode;
+		instancesDirty = true;
+		lightsDirty = true;
+		std::cout << "Stress mode: " << (stressMode ? "ON" : "OFF") << std::endl;
+	}
+	stressKeyDownLastFrame = stressKeyDown;
+
+	bool lightCountKeyDown = glfwGetKey(window, GLFW_KEY_L) == GLFW_PRESS;
+	if (lightCountKeyDown && !lightCountKeyDownLastFrame)
+	{
+		lightCountStep = (lightCountStep + 1) % LIGHT_COUNT_STEPS;
+		lightsDirty = true;
+		std::cout << "Point lights: " << LIGHT_COUNTS[lightCountStep] << std::endl;
+	}
+	lightCountKeyDownLastFrame = lightCountKeyDown;
+
+	bool clusteredKeyDown = glfwGetKey(window, GLFW_KEY_C) == GLFW_PRESS;
+	if (clusteredKeyDown && !clusteredKeyDownLastFrame)
+	{
+		clusteredShading = !clusteredShading;
+		std::cout << "Clustered shading: " << (clusteredShading ? "ON" : "OFF") << std::endl;
+	}
+	clusteredKeyDownLastFrame = clusteredKeyDown;
 }
 
 unsigned int loadTexture(char const* path)
@@ -0,0 +1,135 @@
+#version 460 core
+
+// one invocation per cluster, CLUSTER_GROUP_SIZE in ClusteredLights.h
+layout (local_size_x = 128) in;
+
+// must match ClusteredLights.h
+#define CLUSTER_X 16
+#define CLUSTER_Y 9
+#define CLUSTER_Z 24
+#define CLUSTER_COUNT (CLUSTER_X * CLUSTER_Y * CLUSTER_Z)
+#define MAX_LIGHTS_PER_CLUSTER 256
+
+struct DirLight
+{
+    vec4 direction;
+    vec4 ambient;
+    vec4 diffuse;
+    vec4 specular;
+};
+
+struct PointLight
+{
+    // w = radius of influence
+    vec4 position;
+    vec4 ambient;
+    vec4 diffuse;
+    vec4 specular;
+    vec4 attenuation;
+};
+
+struct ClusterBounds
+{
+    vec4 minPoint;
+    vec4 maxPoint;
+};
+
+layout (std140, binding = 0) uniform Frame
+{
+    mat4 view;
+    mat4 projection;
+    vec4 viewPos;
+    vec4 time;
+};
+
+layout (std140, binding = 1) uniform Lights
+{
+    DirLight dirLight;
+    ivec4 lightCount;
+    vec4 clusterParams;
+};
+
+layout (std430, binding = 2) readonly buffer PointLights
+{
+    PointLight pointLights[];
+};
+
+layout (std430, binding = 3) readonly buffer Clusters
+{
+    ClusterBounds clusters[];
+};
+
+layout (std430, binding = 4) writeonly buffer ClusterLightCounts
+{
+    uint clusterLightCount[];
+};
+
+layout (std430, binding = 5) writeonly buffer ClusterLightIndices
+{
+    uint clusterLightIndices[];
+};
+
+// x = clusters whose list overflowed, y = lights they dropped; cleared before every dispatch (ClusteredLights.h)
+layout (std430, binding = 6) buffer ClusterOverflow
+{
+    uint overflowClusters;
+    uint droppedLights;
+};
+
+// view space center and radius of a batch of lights, loaded once per workgroup
+shared vec4 batch[gl_WorkGroupSize.x];
+
+bool sphereTouchesBox(vec4 sphere, vec3 minPoint, vec3 maxPoint)
+{
+    vec3 closest = clamp(sphere.xyz, minPoint, maxPoint);
+    vec3 offset = closest - sphere.xyz;
+    return dot(offset, offset) <= sphere.w * sphere.w;
+}
+
+void main()
+{
+    uint index = gl_GlobalInvocationID.x;
+    bool active = index < CLUSTER_COUNT;
+    vec3 minPoint = vec3(0.0), maxPoint = vec3(0.0);
+    if (active)
+    {
+        minPoint = clusters[index].minPoint.xyz;
+        maxPoint = clusters[index].maxPoint.xyz;
+    }
+
+    uint lights = uint(lightCount.x);
+    uint count = 0u;
+    uint dropped = 0u;
+    for (uint first = 0u; first < lights; first += gl_WorkGroupSize.x)
+    {
+        uint light = first + gl_LocalInvocationID.x;
+        if (light < lights)
+        {
+            vec4 position = pointLights[light].position;
+            batch[gl_LocalInvocationID.x] = vec4((view * vec4(position.xyz, 1.0)).xyz, position.w);
+        }
+        barrier();
+
+        uint batchSize = min(gl_WorkGroupSize.x, lights - first);
+        for (uint i = 0u; active && i < batchSize; i++)
+        {
+            if (!sphereTouchesBox(batch[i], minPoint, maxPoint))
+                continue;
+            if (count < MAX_LIGHTS_PER_CLUSTER)
+            {
+                clusterLightIndices[index * MAX_LIGHTS_PER_CLUSTER + count] = first + i;
+                count++;
+            }
+            else
+                dropped++;
+        }
+        barrier();
+    }
+    if (active)
+        clusterLightCount[index] = count;
+    if (dropped > 0u)
+    {
+        atomicAdd(overflowClusters, 1u);
+        atomicAdd(droppedLights, dropped);
+    }
+}
\ No newline at end of file
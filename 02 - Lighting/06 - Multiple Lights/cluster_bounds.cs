@@ -0,0 +1,64 @@
+#version 460 core
+
+// one invocation per cluster, CLUSTER_GROUP_SIZE in ClusteredLights.h
+layout (local_size_x = 128) in;
+
+// must match ClusteredLights.h
+#define CLUSTER_X 16
+#define CLUSTER_Y 9
+#define CLUSTER_Z 24
+#define CLUSTER_COUNT (CLUSTER_X * CLUSTER_Y * CLUSTER_Z)
+
+// view space axis aligned bounds, w unused
+struct ClusterBounds
+{
+    vec4 minPoint;
+    vec4 maxPoint;
+};
+
+layout (std430, binding = 3) writeonly buffer Clusters
+{
+    ClusterBounds clusters[];
+};
+
+uniform mat4 inverseProjection;
+uniform vec2 screenSize;
+uniform float zNear;
+uniform float zFar;
+
+// view space point on the near plane under a pixel
+vec3 screenToView(vec2 screen)
+{
+    vec4 view = inverseProjection * vec4(screen / screenSize * 2.0 - 1.0, -1.0, 1.0);
+    return view.xyz / view.w;
+}
+
+// where the ray from the eye through point reaches the view depth
+vec3 rayAtDepth(vec3 point, float depth)
+{
+    return point * (depth / -point.z);
+}
+
+void main()
+{
+    uint index = gl_GlobalInvocationID.x;
+    if (index >= CLUSTER_COUNT)
+        return;
+    uvec3 cell = uvec3(index % CLUSTER_X, (index / CLUSTER_X) % CLUSTER_Y, index / (CLUSTER_X * CLUSTER_Y));
+
+    // screen tile corners; x and y of a view ray only depend on the pixel's x and y, so two rays bound the tile
+    vec2 tileSize = screenSize / vec2(CLUSTER_X, CLUSTER_Y);
+    vec3 minRay = screenToView(vec2(cell.xy) * tileSize);
+    vec3 maxRay = screenToView(vec2(cell.xy + 1u) * tileSize);
+
+    // exponential slices, as many per doubling of depth wherever the slice is
+    float nearDepth = zNear * pow(zFar / zNear, float(cell.z) / CLUSTER_Z);
+    float farDepth = zNear * pow(zFar / zNear, float(cell.z + 1u) / CLUSTER_Z);
+
+    vec3 a = rayAtDepth(minRay, nearDepth);
+    vec3 b = rayAtDepth(minRay, farDepth);
+    vec3 c = rayAtDepth(maxRay, nearDepth);
+    vec3 d = rayAtDepth(maxRay, farDepth);
+    clusters[index].minPoint = vec4(min(min(a, b), min(c, d)), 0.0);
+    clusters[index].maxPoint = vec4(max(max(a, b), max(c, d)), 0.0);
+}
\ No newline at end of file
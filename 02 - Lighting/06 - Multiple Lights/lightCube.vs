@@ -2,11 +2,28 @@
 
 layout (location = 0) in vec3 aPos;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// per-frame data, shared by every program through UniformBuffer<FrameUniforms>
+layout (std140, binding = 0) uniform Frame
+{
+	mat4 view;
+	mat4 projection;
+	vec4 viewPos;
+	vec4 time;
+};
+
+// same layout as in cubeShader.vs, the spin is ignored
+struct CubeInstance
+{
+	mat4 model;
+	vec4 spin;
+};
+
+layout (std430, binding = 1) readonly buffer LightCubeInstances
+{
+	CubeInstance instances[];
+};
 
 void main()
 {
-	gl_Position = projection * view * model * vec4(aPos, 1.0);
+	gl_Position = projection * view * instances[gl_InstanceID].model * vec4(aPos, 1.0);
 }
\ No newline at end of file
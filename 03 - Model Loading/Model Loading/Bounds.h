@@ -0,0 +1,111 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cfloat>
+
+// Axis aligned box, starts out empty (min > max) so the first Expand sets it
+struct BoundingBox {
+    glm::vec3 min = glm::vec3(FLT_MAX);
+    glm::vec3 max = glm::vec3(-FLT_MAX);
+
+    bool IsValid() const { return min.x <= max.x && min.y <= max.y && min.z <= max.z; }
+    glm::vec3 Center() const { return (min + max) * 0.5f; }
+    glm::vec3 Extents() const { return (max - min) * 0.5f; }
+
+    void Expand(const glm::vec3& point)
+    {
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+    }
+
+    void Expand(const BoundingBox& other)
+    {
+        if (!other.IsValid())
+            return;
+        min = glm::min(min, other.min);
+        max = glm::max(max, other.max);
+    }
+
+    // Box around the transformed box (Arvo): the center moves with the matrix, the extents through |M|
+    BoundingBox Transformed(const glm::mat4& transform) const
+    {
+        if (!IsValid())
+            return *this;
+        glm::vec3 center = glm::vec3(transform * glm::vec4(Center(), 1.0f));
+        glm::mat3 absolute = glm::mat3(transform);
+        for (int i = 0; i < 3; i++)
+            absolute[i] = glm::abs(absolute[i]);
+        glm::vec3 extents = absolute * Extents();
+        return { center - extents, center + extents };
+    }
+};
+
+struct BoundingSphere {
+    glm::vec3 center = glm::vec3(0.0f);
+    float radius = 0.0f;
+
+    // encloses the box, looser than a minimal sphere but free to compute
+    static BoundingSphere FromBox(const BoundingBox& box)
+    {
+        if (!box.IsValid())
+            return {};
+        return { box.Center(), glm::length(box.Extents()) };
+    }
+
+    // non-uniform scales grow the radius by the largest axis scale
+    BoundingSphere Transformed(const glm::mat4& transform) const
+    {
+        float scale = glm::max(glm::length(glm::vec3(transform[0])), glm::max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+        return { glm::vec3(transform * glm::vec4(center, 1.0f)), radius * scale };
+    }
+};
+
+// Six planes (xyz = inward normal, w = distance) in the space the matrix maps from: pass
+// projection * view for world space planes. Order: left, right, bottom, top, near, far.
+struct Frustum {
+    glm::vec4 planes[6];
+
+    // Gribb/Hartmann: each plane is a sum or difference of the 4th row and one other row of the matrix
+    static Frustum FromMatrix(const glm::mat4& matrix)
+    {
+        glm::vec4 rowX = glm::vec4(matrix[0][0], matrix[1][0], matrix[2][0], matrix[3][0]);
+        glm::vec4 rowY = glm::vec4(matrix[0][1], matrix[1][1], matrix[2][1], matrix[3][1]);
+        glm::vec4 rowZ = glm::vec4(matrix[0][2], matrix[1][2], matrix[2][2], matrix[3][2]);
+        glm::vec4 rowW = glm::vec4(matrix[0][3], matrix[1][3], matrix[2][3], matrix[3][3]);
+
+        Frustum frustum;
+        frustum.planes[0] = rowW + rowX;
+        frustum.planes[1] = rowW - rowX;
+        frustum.planes[2] = rowW + rowY;
+        frustum.planes[3] = rowW - rowY;
+        frustum.planes[4] = rowW + rowZ;
+        frustum.planes[5] = rowW - rowZ;
+        // normalized so plane distances are real distances and can be compared against radii
+        for (glm::vec4& plane : frustum.planes)
+            plane /= glm::length(glm::vec3(plane));
+        return frustum;
+    }
+
+    bool Intersects(const BoundingSphere& sphere) const
+    {
+        for (const glm::vec4& plane : planes)
+            if (glm::dot(glm::vec3(plane), sphere.center) + plane.w < -sphere.radius)
+                return false;
+        return true;
+    }
+
+    // conservative: boxes straddling two planes outside a corner are kept
+    bool Intersects(const BoundingBox& box) const
+    {
+        glm::vec3 center = box.Center();
+        glm::vec3 extents = box.Extents();
+        for (const glm::vec4& plane : planes)
+        {
+            float reach = glm::dot(extents, glm::abs(glm::vec3(plane)));
+            if (glm::dot(glm::vec3(plane), center) + plane.w < -reach)
+                return false;
+        }
+        return true;
+    }
+};
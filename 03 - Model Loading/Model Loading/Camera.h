@@ -5,6 +5,8 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include "Bounds.h"
+
 enum Camera_Movement
 {
 	FORWARD,
@@ -58,6 +60,12 @@ public:
 		return glm::lookAt(Position, Position + Front, Up);
 	}
 
+	// World space culling planes for the given projection
+	Frustum GetFrustum(const glm::mat4& projection)
+	{
+		return Frustum::FromMatrix(projection * GetViewMatrix());
+	}
+
 	void LookAt(glm::vec3 target)
 	{
 		Front = glm::normalize(target - Position);
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "ComputeShader.h"
+#include "GpuResources.h"
+#include "PointLights.h"
+
+#include <cmath>
+
+// Shader storage bindings of the cluster light lists, after the visibility buffer ones
+#define CLUSTER_LIGHT_COUNT_BINDING 14
+#define CLUSTER_LIGHT_INDEX_BINDING 15
+
+// View frustum split into CLUSTER_X * CLUSTER_Y screen tiles and CLUSTER_Z exponential depth slices.
+// The same values are #defined in cluster_assign.cs, shader.fs and transparent.fs.
+#define CLUSTER_X 16
+#define CLUSTER_Y 9
+#define CLUSTER_Z 24
+#define CLUSTER_COUNT (CLUSTER_X * CLUSTER_Y * CLUSTER_Z)
+// every cluster owns a fixed slice of the index buffer, lights past this are dropped and counted in LightListOverflow
+#define MAX_LIGHTS_PER_CLUSTER 256
+// local_size_x of cluster_assign.cs
+#define CLUSTER_GROUP_SIZE 128
+
+// Clustered forward shading for shader.fs and transparent.fs, as in the Multiple Lights sample: one compute pass
+// lists for every view space cluster the point lights whose sphere of influence touches it, and fragments only
+// loop over their cluster's list. Cluster bounds are rebuilt inside the same pass rather than cached, it is one
+// dispatch per frame either way and the projection follows the camera zoom.
+class ClusteredLights {
+public:
+    ClusteredLights()
+    {
+        countBuffer = createStorage(CLUSTER_COUNT * sizeof(GLuint));
+        indexBuffer = createStorage(CLUSTER_COUNT * MAX_LIGHTS_PER_CLUSTER * sizeof(GLuint));
+    }
+
+    // Builds the light lists for this frame. The Frame and Lights blocks must already hold this frame's view
+    // and light count; the draws that follow read the lists after the storage barrier.
+    void Assign(ComputeShader& assignShader, const glm::mat4& projection, int width, int height, float zNear, float zFar)
+    {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CLUSTER_LIGHT_COUNT_BINDING, countBuffer.Id());
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CLUSTER_LIGHT_INDEX_BINDING, indexBuffer.Id());
+        assignShader.use();
+        assignShader.setMat4("inverseProjection", glm::inverse(projection));
+        assignShader.setVec2("screenSize", glm::vec2(width, height));
+        assignShader.setFloat("zNear", zNear);
+        assignShader.setFloat("zFar", zFar);
+        glDispatchCompute(ComputeShader::Groups(CLUSTER_COUNT, CLUSTER_GROUP_SIZE), 1, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+
+    // Depth slice scale and bias, cluster tile size in pixels: the clusterParams of the Lights block.
+    // A view depth d falls in slice floor(log(d) * scale + bias).
+    static glm::vec4 Params(int width, int height, float zNear, float zFar)
+    {
+        float scale = CLUSTER_Z / std::log(zFar / zNear);
+        return glm::vec4(scale, -std::log(zNear) * scale, float(width) / CLUSTER_X, float(height) / CLUSTER_Y);
+    }
+
+private:
+    SharedBuffer countBuffer, indexBuffer;
+
+    static SharedBuffer createStorage(size_t size)
+    {
+        SharedBuffer buffer = GpuResources::CreateBuffer();
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer.Id());
+        glBufferData(GL_SHADER_STORAGE_BUFFER, size, nullptr, GL_DYNAMIC_COPY);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        return buffer;
+    }
+};
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "Shader.h"
+#include "GpuResources.h"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Single-stage compute program. Compiles synchronously: compute passes run from the first frame and have no
+// fallback to draw with, unlike Shader's async path.
+class ComputeShader {
+public:
+    unsigned int ID = 0;
+
+    ComputeShader(const char* computePath, const std::vector<std::string>& defines = {}) : computePath(computePath), defines(defines)
+    {
+        compile();
+    }
+
+    // Keeps the current program when the new source fails to compile; uniform values carry over to the new one
+    void Reload()
+    {
+        compile();
+    }
+
+    void use() const
+    {
+        glUseProgram(ID);
+    }
+
+    // Group counts for total invocations at the given local size
+    static GLuint Groups(size_t invocations, GLuint localSize)
+    {
+        return static_cast<GLuint>((invocations + localSize - 1) / localSize);
+    }
+
+    void setInt(std::string_view name, int x) const
+    {
+        glUniform1i(location(name), x);
+    }
+
+    void setUInt(std::string_view name, unsigned int x) const
+    {
+        glUniform1ui(location(name), x);
+    }
+
+    void setFloat(std::string_view name, float x) const
+    {
+        glUniform1f(location(name), x);
+    }
+
+    void setVec2(std::string_view name, const glm::vec2& value) const
+    {
+        glUniform2fv(location(name), 1, &value[0]);
+    }
+
+    void setVec4(std::string_view name, const glm::vec4& value) const
+    {
+        glUniform4fv(location(name), 1, &value[0]);
+    }
+
+    void setVec4Array(std::string_view name, const glm::vec4* values, int count) const
+    {
+        glUniform4fv(location(name), count, &values[0][0]);
+    }
+
+    void setMat4(std::string_view name, const glm::mat4& mat) const
+    {
+        glUniformMatrix4fv(location(name), 1, GL_FALSE, &mat[0][0]);
+    }
+
+private:
+    std::string computePath;
+    std::vector<std::string> defines;
+    SharedProgram ownedProgram;
+    // locations of every active uniform, reflected once after linking like Shader's
+    UniformTable uniforms;
+
+    GLint location(std::string_view name) const
+    {
+        return uniforms.Find(name).location;
+    }
+
+    void compile()
+    {
+        std::string code;
+        std::ifstream file;
+        file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+        try
+        {
+            file.open(computePath);
+            std::stringstream stream;
+            stream << file.rdbuf();
+            code = stream.str();
+        }
+        catch (std::ifstream::failure& e)
+        {
+            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << computePath << " " << e.what() << std::endl;
+            return;
+        }
+        code = Shader::injectDefines(code, defines);
+
+        const char* source = code.c_str();
+        GLuint shader = glCreateShader(GL_COMPUTE_SHADER);
+        glShaderSource(shader, 1, &source, NULL);
+        glCompileShader(shader);
+        GLuint program = glCreateProgram();
+        glAttachShader(program, shader);
+        glLinkProgram(program);
+
+        GLint compiled = GL_FALSE, linked = GL_FALSE;
+        GLchar infoLog[1024];
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+        if (!compiled)
+        {
+            glGetShaderInfoLog(shader, 1024, NULL, infoLog);
+            std::cout << "ERROR::SHADER_COMPILATION_ERROR of type: COMPUTE (" << computePath << ")\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
+        }
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        if (compiled && !linked)
+        {
+            glGetProgramInfoLog(program, 1024, NULL, infoLog);
+            std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: PROGRAM (" << computePath << ")\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
+        }
+        glDetachShader(program, shader);
+        glDeleteShader(shader);
+        if (!linked)
+        {
+            glDeleteProgram(program);
+            return;
+        }
+        if (ID)
+            Shader::CopyUniforms(ID, program);
+        ownedProgram = SharedProgram::Adopt(program);
+        ID = program;
+        uniforms.Reflect(program);
+    }
+};
@@ -0,0 +1,230 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "Bounds.h"
+
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// GCC/Clang only emit AVX2 code in functions that ask for it, MSVC emits whatever intrinsics it is given
+#if defined(_MSC_VER) && !defined(__clang__)
+#define CULLING_TARGET_AVX2
+#else
+#define CULLING_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#endif
+
+// Bounding spheres as structure of arrays, so one SIMD load picks up the same component of 4/8 spheres
+struct SphereSoA {
+    std::vector<float> x, y, z, radius;
+
+    void Add(const BoundingSphere& sphere)
+    {
+        x.push_back(sphere.center.x);
+        y.push_back(sphere.center.y);
+        z.push_back(sphere.center.z);
+        radius.push_back(sphere.radius);
+    }
+
+    void Reserve(size_t count)
+    {
+        x.reserve(count);
+        y.reserve(count);
+        z.reserve(count);
+        radius.reserve(count);
+    }
+
+    void Clear()
+    {
+        x.clear();
+        y.clear();
+        z.clear();
+        radius.clear();
+    }
+
+    size_t Size() const { return x.size(); }
+};
+
+// Batch sphere/frustum tests writing the indices of the visible spheres, in order, to a compact list.
+// The vector paths test a whole register of spheres against all six planes, then append every lane
+// unconditionally and only advance the write position for lanes that passed, so there is no branch per sphere.
+namespace FrustumCulling {
+    enum Path {
+        SCALAR,
+        SSE,
+        AVX2,
+        BEST
+    };
+
+    inline const char* PathName(Path path)
+    {
+        switch (path)
+        {
+        case SCALAR: return "scalar";
+        case SSE: return "SSE";
+        case AVX2: return "AVX2";
+        default: return "best";
+        }
+    }
+
+    inline bool Avx2Supported()
+    {
+#if defined(_MSC_VER) && !defined(__clang__)
+        static const bool supported = [] {
+            int info[4];
+            __cpuid(info, 1);
+            bool osxsave = (info[2] & (1 << 27)) != 0;
+            bool fma = (info[2] & (1 << 12)) != 0;
+            // the OS has to save the YMM registers on context switches
+            if (!osxsave || !fma || (_xgetbv(0) & 6) != 6)
+                return false;
+            __cpuidex(info, 7, 0);
+            return (info[1] & (1 << 5)) != 0;
+        }();
+        return supported;
+#else
+        static const bool supported = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+        return supported;
+#endif
+    }
+
+    inline size_t cullScalar(const Frustum& frustum, const SphereSoA& spheres, size_t begin, uint32_t* out)
+    {
+        size_t count = 0;
+        for (size_t i = begin; i < spheres.Size(); i++)
+        {
+            bool inside = true;
+            for (const glm::vec4& plane : frustum.planes)
+                inside &= plane.x * spheres.x[i] + plane.y * spheres.y[i] + plane.z * spheres.z[i] + plane.w >= -spheres.radius[i];
+            out[count] = static_cast<uint32_t>(i);
+            count += inside;
+        }
+        return count;
+    }
+
+    inline size_t cullSSE(const Frustum& frustum, const SphereSoA& spheres, uint32_t* out)
+    {
+        __m128 planes[6][4];
+        for (int p = 0; p < 6; p++)
+            for (int c = 0; c < 4; c++)
+                planes[p][c] = _mm_set1_ps(frustum.planes[p][c]);
+        const __m128 signMask = _mm_set1_ps(-0.0f);
+
+        size_t count = 0;
+        size_t batched = spheres.Size() & ~size_t(3);
+        for (size_t i = 0; i < batched; i += 4)
+        {
+            __m128 x = _mm_loadu_ps(&spheres.x[i]);
+            __m128 y = _mm_loadu_ps(&spheres.y[i]);
+            __m128 z = _mm_loadu_ps(&spheres.z[i]);
+            __m128 negativeRadius = _mm_xor_ps(_mm_loadu_ps(&spheres.radius[i]), signMask);
+            __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+            for (int p = 0; p < 6; p++)
+            {
+                __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planes[p][0], x), _mm_mul_ps(planes[p][1], y)),
+                                             _mm_add_ps(_mm_mul_ps(planes[p][2], z), planes[p][3]));
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+            }
+            int mask = _mm_movemask_ps(inside);
+            for (int lane = 0; lane < 4; lane++)
+            {
+                out[count] = static_cast<uint32_t>(i + lane);
+                count += (mask >> lane) & 1;
+            }
+        }
+        return count + cullScalar(frustum, spheres, batched, out + count);
+    }
+
+    CULLING_TARGET_AVX2 inline size_t cullAVX2(const Frustum& frustum, const SphereSoA& spheres, uint32_t* out)
+    {
+        __m256 planes[6][4];
+        for (int p = 0; p < 6; p++)
+            for (int c = 0; c < 4; c++)
+                planes[p][c] = _mm256_set1_ps(frustum.planes[p][c]);
+        const __m256 signMask = _mm256_set1_ps(-0.0f);
+
+        size_t count = 0;
+        size_t batched = spheres.Size() & ~size_t(7);
+        for (size_t i = 0; i < batched; i += 8)
+        {
+            __m256 x = _mm256_loadu_ps(&spheres.x[i]);
+            __m256 y = _mm256_loadu_ps(&spheres.y[i]);
+            __m256 z = _mm256_loadu_ps(&spheres.z[i]);
+            __m256 negativeRadius = _mm256_xor_ps(_mm256_loadu_ps(&spheres.radius[i]), signMask);
+            __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+            for (int p = 0; p < 6; p++)
+            {
+                __m256 distance = _mm256_fmadd_ps(planes[p][0], x, _mm256_fmadd_ps(planes[p][1], y, _mm256_fmadd_ps(planes[p][2], z, planes[p][3])));
+                inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negativeRadius, _CMP_GE_OQ));
+            }
+            int mask = _mm256_movemask_ps(inside);
+            for (int lane = 0; lane < 8; lane++)
+            {
+                out[count] = static_cast<uint32_t>(i + lane);
+                count += (mask >> lane) & 1;
+            }
+        }
+        return count + cullScalar(frustum, spheres, batched, out + count);
+    }
+
+    // Replaces visible with the indices of every sphere touching the frustum; AVX2 falls back to SSE on CPUs without it
+    inline void Cull(const Frustum& frustum, const SphereSoA& spheres, std::vector<uint32_t>& visible, Path path = BEST)
+    {
+        if (path == BEST || (path == AVX2 && !Avx2Supported()))
+            path = Avx2Supported() ? AVX2 : SSE;
+
+        // every lane is written before the count decides whether it stays, so the list needs one full register of slack
+        visible.resize(spheres.Size() + 8);
+        size_t count;
+        if (path == AVX2)
+            count = cullAVX2(frustum, spheres, visible.data());
+        else if (path == SSE)
+            count = cullSSE(frustum, spheres, visible.data());
+        else
+            count = cullScalar(frustum, spheres, 0, visible.data());
+        visible.resize(count);
+    }
+
+    // Times every path over the same random spheres and checks they agree
+    inline void Benchmark(size_t sphereCount = 1000000, int iterations = 20)
+    {
+        SphereSoA spheres;
+        spheres.Reserve(sphereCount);
+        std::mt19937 rng(42);
+        std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+        std::uniform_real_distribution<float> size(0.5f, 5.0f);
+        for (size_t i = 0; i < sphereCount; i++)
+            spheres.Add({ glm::vec3(position(rng), position(rng), position(rng)), size(rng) });
+
+        glm::mat4 projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 1000.0f);
+        glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        Frustum frustum = Frustum::FromMatrix(projection * view);
+
+        std::cout << "CULLING::BENCHMARK " << sphereCount << " spheres, " << iterations << " iterations" << std::endl;
+        std::vector<uint32_t> visible, reference;
+        Cull(frustum, spheres, reference, SCALAR);
+        for (Path path : { SCALAR, SSE, AVX2 })
+        {
+            if (path == AVX2 && !Avx2Supported())
+            {
+                std::cout << "  AVX2    not supported by this CPU" << std::endl;
+                continue;
+            }
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < iterations; i++)
+                Cull(frustum, spheres, visible, path);
+            double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / iterations;
+            std::cout << "  " << PathName(path) << ": " << milliseconds << " ms, " << sphereCount / (milliseconds * 1000.0)
+                      << " M spheres/s, visible " << visible.size() << (visible == reference ? "" : " (MISMATCH)") << std::endl;
+        }
+    }
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "ComputeShader.h"
+#include "GpuResources.h"
+
+#include <iostream>
+
+// local_size of deferred_lighting.cs, one workgroup shades and culls lights for one tile
+#define DEFERRED_TILE_SIZE 16
+// light list size of one tile, also in deferred_lighting.cs and visibility_resolve.cs; the rest is dropped
+#define MAX_TILE_LIGHTS 256
+// RGBA8 albedo + specular, RG16 octahedral normal, 32-bit depth
+#define GBUFFER_BYTES_PER_PIXEL 12
+
+// Deferred shading with a compact G-buffer and tiled lighting.
+// The geometry pass writes albedo with the specular intensity in alpha, and the world space normal folded onto
+// an octahedron into two 16-bit channels; position is not stored, the lighting pass rebuilds it from depth.
+// Lighting is one compute dispatch: every 16x16 tile finds its depth range, keeps the point lights whose
+// sphere reaches the tile's view space box, then shades its pixels with only those lights. Each pixel is shaded
+// once whatever the overdraw. Transparent surfaces are then drawn forward into the lit image, depth tested
+// against the G-buffer, before it is copied to the screen.
+class DeferredRenderer {
+public:
+    // Binds the G-buffer, resized to the framebuffer when that changes. A minimized window (0x0) keeps the old targets.
+    void BeginGeometry(int width, int height)
+    {
+        if ((width != targetWidth || height != targetHeight) && width > 0 && height > 0)
+            resize(width, height);
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, gBuffer.Id());
+        // color needs no clear, lighting ignores every pixel left at the far plane
+        glClear(GL_DEPTH_BUFFER_BIT);
+    }
+
+    // Shades the G-buffer into the lit image; the Frame block must hold this frame's view
+    void Light(ComputeShader& lightingShader, const glm::mat4& projection, const glm::mat4& view, float shininess, const glm::vec4& background)
+    {
+        lightingShader.use();
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, albedoSpecularTexture.Id());
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, normalTexture.Id());
+        glActiveTexture(GL_TEXTURE2);
+        glBindTexture(GL_TEXTURE_2D, depthTexture.Id());
+        glActiveTexture(GL_TEXTURE0);
+        lightingShader.setInt("gAlbedoSpecular", 0);
+        lightingShader.setInt("gNormal", 1);
+        lightingShader.setInt("gDepth", 2);
+        glBindImageTexture(0, litTexture.Id(), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+        lightingShader.setMat4("inverseProjection", glm::inverse(projection));
+        lightingShader.setMat4("inverseViewProjection", glm::inverse(projection * view));
+        lightingShader.setFloat("shininess", shininess);
+        lightingShader.setVec4("background", background);
+        glDispatchCompute(ComputeShader::Groups(targetWidth, DEFERRED_TILE_SIZE), ComputeShader::Groups(targetHeight, DEFERRED_TILE_SIZE), 1);
+        // the image stores must land before the forward pass blends over them and the blit reads them
+        glMemoryBarrier(GL_FRAMEBUFFER_BARRIER_BIT);
+    }
+
+    // Forward drawing on top of the lit image, against the G-buffer's depth
+    void BeginForward()
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, litFramebuffer.Id());
+    }
+
+    // Copies the lit image to the framebuffer that was bound before BeginGeometry
+    void EndFrame()
+    {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, litFramebuffer.Id());
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, previousFramebuffer);
+        glBlitFramebuffer(0, 0, targetWidth, targetHeight, 0, 0, targetWidth, targetHeight, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+    }
+
+    // Size of one G-buffer, written once by the geometry pass and read once by lighting
+    size_t GBufferBytes() const { return size_t(targetWidth) * targetHeight * GBUFFER_BYTES_PER_PIXEL; }
+
+private:
+    SharedTexture albedoSpecularTexture, normalTexture, depthTexture, litTexture;
+    SharedFramebuffer gBuffer, litFramebuffer;
+    GLint previousFramebuffer = 0;
+    int targetWidth = 0, targetHeight = 0;
+
+    static SharedTexture createTarget(GLenum format, int width, int height)
+    {
+        SharedTexture texture = GpuResources::CreateTexture();
+        glBindTexture(GL_TEXTURE_2D, texture.Id());
+        glTexStorage2D(GL_TEXTURE_2D, 1, format, width, height);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        return texture;
+    }
+
+    static void checkFramebuffer(const char* name)
+    {
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::DEFERRED::" << name << "_FRAMEBUFFER_INCOMPLETE" << std::endl;
+    }
+
+    void resize(int width, int height)
+    {
+        targetWidth = width;
+        targetHeight = height;
+        albedoSpecularTexture = createTarget(GL_RGBA8, width, height);
+        normalTexture = createTarget(GL_RG16, width, height);
+        depthTexture = createTarget(GL_DEPTH_COMPONENT32F, width, height);
+        litTexture = createTarget(GL_RGBA8, width, height);
+
+        if (!gBuffer)
+            gBuffer = GpuResources::CreateFramebuffer();
+        glBindFramebuffer(GL_FRAMEBUFFER, gBuffer.Id());
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, albedoSpecularTexture.Id(), 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, normalTexture.Id(), 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthTexture.Id(), 0);
+        const GLenum attachments[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+        glDrawBuffers(2, attachments);
+        checkFramebuffer("GBUFFER");
+
+        if (!litFramebuffer)
+            litFramebuffer = GpuResources::CreateFramebuffer();
+        glBindFramebuffer(GL_FRAMEBUFFER, litFramebuffer.Id());
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, litTexture.Id(), 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthTexture.Id(), 0);
+        checkFramebuffer("LIT");
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+};
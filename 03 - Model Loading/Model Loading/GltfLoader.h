@@ -0,0 +1,414 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "stb_image.h"
+
+#include "Json.h"
+#include "MappedFile.h"
+#include "Mesh.h"
+
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <vector>
+
+// defined in Model.h
+unsigned int TextureFromFile(const char* path, const std::string& directory, bool gamma);
+
+// defined in stb_image.cpp: the calling thread's flip flag, saved and put back around the glTF image decodes
+void stbi_get_flip_state_thread(int* flip, int* set);
+void stbi_restore_flip_state_thread(int flip, int set);
+
+// Native glTF 2.0 / GLB loader.
+// The file (and any external .bin) is memory-mapped and every bufferView referenced by a mesh accessor is
+// handed to glBufferData straight from the mapping: no aiScene, no std::vector<Vertex>, one driver copy.
+// Accessors become VertexAttribute pointers with the source component type/stride, so quantized or
+// interleaved layouts are drawn as stored.
+//
+// Load returns false for anything outside that fast path (data: URIs, sparse accessors, ...), and
+// Model then falls back to Assimp. Like the Assimp path, node transforms are not applied.
+class GltfLoader
+{
+public:
+    static bool Load(const std::string& path, const std::string& directory, std::vector<Mesh>& meshes, std::vector<Texture>& texturesLoaded)
+    {
+        GltfLoader loader(directory, texturesLoaded);
+        if (!loader.open(path))
+            return false;
+
+        std::vector<Mesh> loaded;
+        if (!loader.loadScene(loaded))
+            return false;
+
+        meshes.insert(meshes.end(), loaded.begin(), loaded.end());
+        return true;
+    }
+
+private:
+    static const uint32_t GLB_MAGIC = 0x46546C67;      // "glTF"
+    static const uint32_t GLB_CHUNK_JSON = 0x4E4F534A; // "JSON"
+    static const uint32_t GLB_CHUNK_BIN = 0x004E4942;  // "BIN\0"
+
+    struct BufferRange {
+        const unsigned char* data = nullptr;
+        size_t size = 0;
+    };
+
+    std::string directory;
+    std::vector<Texture>& texturesLoaded;
+    std::vector<std::unique_ptr<MappedFile>> files;
+    JsonValue document;
+    BufferRange glbBinary;
+    std::vector<BufferRange> buffers;
+    // bufferView index -> GL buffer, uploaded on first use and shared by every mesh reading from it
+    std::map<int, SharedBuffer> uploadedViews;
+
+    GltfLoader(const std::string& directory, std::vector<Texture>& texturesLoaded)
+        : directory(directory), texturesLoaded(texturesLoaded)
+    {
+    }
+
+    bool open(const std::string& path)
+    {
+        files.push_back(std::make_unique<MappedFile>(path));
+        const MappedFile& file = *files.back();
+        if (!file.IsValid())
+            return false;
+
+        const char* json = reinterpret_cast<const char*>(file.Data());
+        const char* jsonEnd = json + file.Size();
+
+        if (file.Size() >= 20 && readU32(file.Data()) == GLB_MAGIC)
+        {
+            // GLB: 12 byte header, then JSON chunk, then optional BIN chunk
+            if (readU32(file.Data() + 4) != 2)
+                return false;
+            size_t offset = 12;
+            bool hasJson = false;
+            while (offset + 8 <= file.Size())
+            {
+                uint32_t chunkLength = readU32(file.Data() + offset);
+                uint32_t chunkType = readU32(file.Data() + offset + 4);
+                const unsigned char* chunkData = file.Data() + offset + 8;
+                if (offset + 8 + chunkLength > file.Size())
+                    return false;
+                if (chunkType == GLB_CHUNK_JSON && !hasJson)
+                {
+                    json = reinterpret_cast<const char*>(chunkData);
+                    jsonEnd = json + chunkLength;
+                    hasJson = true;
+                }
+                else if (chunkType == GLB_CHUNK_BIN && !glbBinary.data)
+                {
+                    glbBinary.data = chunkData;
+                    glbBinary.size = chunkLength;
+                }
+                offset += 8 + ((chunkLength + 3) & ~3u);
+            }
+            if (!hasJson)
+                return false;
+        }
+
+        if (!JsonValue::Parse(json, jsonEnd, document))
+        {
+            std::cout << "ERROR::GLTF::invalid JSON in " << path << std::endl;
+            return false;
+        }
+        if (document["asset"]["version"].AsString().rfind("2.", 0) != 0)
+            return false;
+
+        return mapBuffers();
+    }
+
+    bool mapBuffers()
+    {
+        const JsonValue& bufferList = document["buffers"];
+        for (size_t i = 0; i < bufferList.Size(); i++)
+        {
+            const JsonValue& buffer = bufferList[i];
+            BufferRange range;
+            if (!buffer.Has("uri"))
+            {
+                // only the first buffer of a GLB may omit its uri
+                if (i != 0 || !glbBinary.data)
+                    return false;
+                range = glbBinary;
+            }
+            else
+            {
+                const std::string& uri = buffer["uri"].AsString();
+                if (uri.rfind("data:", 0) == 0)
+                    return false;
+                files.push_back(std::make_unique<MappedFile>(directory + '/' + uri));
+                if (!files.back()->IsValid())
+                {
+                    std::cout << "ERROR::GLTF::cannot map buffer " << uri << std::endl;
+                    return false;
+                }
+                range.data = files.back()->Data();
+                range.size = files.back()->Size();
+            }
+            if (range.size < buffer["byteLength"].AsSize())
+                return false;
+            buffers.push_back(range);
+        }
+        return true;
+    }
+
+    bool loadScene(std::vector<Mesh>& meshes)
+    {
+        const JsonValue& scenes = document["scenes"];
+        if (scenes.Size() == 0)
+        {
+            // no scene graph: load every mesh once
+            for (size_t i = 0; i < document["meshes"].Size(); i++)
+                if (!loadMesh(static_cast<int>(i), meshes))
+                    return false;
+            return true;
+        }
+
+        const JsonValue& scene = scenes[document["scene"].AsSize(0)];
+        for (size_t i = 0; i < scene["nodes"].Size(); i++)
+            if (!loadNode(scene["nodes"][i].AsInt(), meshes))
+                return false;
+        return true;
+    }
+
+    bool loadNode(int nodeIndex, std::vector<Mesh>& meshes)
+    {
+        const JsonValue& node = document["nodes"][nodeIndex];
+        if (node.Has("mesh") && !loadMesh(node["mesh"].AsInt(), meshes))
+            return false;
+        for (size_t i = 0; i < node["children"].Size(); i++)
+            if (!loadNode(node["children"][i].AsInt(), meshes))
+                return false;
+        return true;
+    }
+
+    bool loadMesh(int meshIndex, std::vector<Mesh>& meshes)
+    {
+        const JsonValue& primitives = document["meshes"][meshIndex]["primitives"];
+        for (size_t p = 0; p < primitives.Size(); p++)
+        {
+            const JsonValue& primitive = primitives[p];
+            // triangles only
+            if (primitive["mode"].AsInt(4) != 4)
+                continue;
+
+            // glTF attribute semantic -> Mesh/Vertex attribute location
+            static const std::pair<const char*, unsigned int> semantics[] = {
+                { "POSITION", 0 }, { "NORMAL", 1 }, { "TEXCOORD_0", 2 }, { "TANGENT", 3 }, { "JOINTS_0", 5 }, { "WEIGHTS_0", 6 }
+            };
+
+            std::vector<VertexAttribute> attributes;
+            unsigned int vertexCount = 0;
+            BoundingBox bounds;
+            for (const auto& semantic : semantics)
+            {
+                const JsonValue& accessorIndex = primitive["attributes"][semantic.first];
+                if (accessorIndex.IsNull())
+                    continue;
+                VertexAttribute attribute;
+                if (!makeAttribute(accessorIndex.AsInt(), semantic.second, attribute))
+                    return false;
+                if (semantic.second == 0)
+                {
+                    const JsonValue& accessor = document["accessors"][accessorIndex.AsSize()];
+                    vertexCount = static_cast<unsigned int>(accessor["count"].AsSize());
+                    // min/max are required on POSITION accessors by the spec
+                    if (accessor["min"].Size() == 3 && accessor["max"].Size() == 3)
+                        for (int corner = 0; corner < 2; corner++)
+                        {
+                            const JsonValue& extreme = accessor[corner ? "max" : "min"];
+                            bounds.Expand(glm::vec3(extreme[0].AsNumber(), extreme[1].AsNumber(), extreme[2].AsNumber()));
+                        }
+                }
+                attributes.push_back(attribute);
+            }
+            if (vertexCount == 0)
+                continue;
+
+            SharedBuffer indexBuffer;
+            GLenum indexType = GL_UNSIGNED_INT;
+            size_t indexOffset = 0;
+            unsigned int indexCount = 0;
+            if (primitive.Has("indices"))
+            {
+                const JsonValue& accessor = document["accessors"][primitive["indices"].AsSize()];
+                if (accessor.Has("sparse") || !accessor.Has("bufferView"))
+                    return false;
+                // glTF componentType values are the GL enums (GL_UNSIGNED_BYTE/SHORT/INT)
+                indexType = static_cast<GLenum>(accessor["componentType"].AsInt());
+                indexOffset = accessor["byteOffset"].AsSize(0);
+                indexCount = static_cast<unsigned int>(accessor["count"].AsSize());
+                indexBuffer = uploadView(accessor["bufferView"].AsInt());
+                if (!indexBuffer)
+                    return false;
+            }
+            else
+            {
+                // non-indexed primitive: the only data generated on the CPU
+                std::vector<unsigned int> sequential(vertexCount);
+                for (unsigned int i = 0; i < vertexCount; i++)
+                    sequential[i] = i;
+                indexBuffer = GpuResources::CreateBuffer();
+                glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer.Id());
+                glBufferData(GL_ELEMENT_ARRAY_BUFFER, sequential.size() * sizeof(unsigned int), sequential.data(), GL_STATIC_DRAW);
+                indexCount = vertexCount;
+            }
+
+            meshes.push_back(Mesh(attributes, indexBuffer, indexType, indexOffset, indexCount, vertexCount, loadMaterial(primitive["material"]), bounds));
+        }
+        return true;
+    }
+
+    bool makeAttribute(int accessorIndex, unsigned int location, VertexAttribute& attribute)
+    {
+        const JsonValue& accessor = document["accessors"][accessorIndex];
+        if (accessor.Has("sparse") || !accessor.Has("bufferView"))
+            return false;
+
+        const std::string& type = accessor["type"].AsString();
+        GLint size = type == "SCALAR" ? 1 : type == "VEC2" ? 2 : type == "VEC3" ? 3 : type == "VEC4" ? 4 : 0;
+        if (size == 0)
+            return false;
+
+        const JsonValue& view = document["bufferViews"][accessor["bufferView"].AsSize()];
+        attribute.location = location;
+        attribute.buffer = uploadView(accessor["bufferView"].AsInt());
+        attribute.size = size;
+        attribute.type = static_cast<GLenum>(accessor["componentType"].AsInt());
+        attribute.normalized = accessor["normalized"].boolean ? GL_TRUE : GL_FALSE;
+        attribute.stride = static_cast<GLsizei>(view["byteStride"].AsSize(0));
+        attribute.offset = accessor["byteOffset"].AsSize(0);
+        return static_cast<bool>(attribute.buffer);
+    }
+
+    SharedBuffer uploadView(int viewIndex)
+    {
+        auto uploaded = uploadedViews.find(viewIndex);
+        if (uploaded != uploadedViews.end())
+            return uploaded->second;
+
+        const JsonValue& view = document["bufferViews"][viewIndex];
+        size_t bufferIndex = view["buffer"].AsSize();
+        size_t offset = view["byteOffset"].AsSize(0);
+        size_t length = view["byteLength"].AsSize();
+        if (bufferIndex >= buffers.size() || offset + length > buffers[bufferIndex].size)
+            return {};
+
+        SharedBuffer buffer = GpuResources::CreateBuffer();
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer.Id());
+        glBufferData(GL_COPY_WRITE_BUFFER, length, buffers[bufferIndex].data + offset, GL_STATIC_DRAW);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        uploadedViews[viewIndex] = buffer;
+        return buffer;
+    }
+
+    std::vector<Texture> loadMaterial(const JsonValue& materialIndex)
+    {
+        std::vector<Texture> textures;
+        if (materialIndex.IsNull())
+            return textures;
+
+        const JsonValue& material = document["materials"][materialIndex.AsSize()];
+        const JsonValue& baseColor = material["pbrMetallicRoughness"]["baseColorTexture"];
+        if (!baseColor.IsNull())
+            loadTexture(baseColor["index"].AsInt(), TEXTURE_DIFFUSE, textures);
+        const JsonValue& normal = material["normalTexture"];
+        if (!normal.IsNull())
+            loadTexture(normal["index"].AsInt(), TEXTURE_NORMAL, textures);
+        return textures;
+    }
+
+    void loadTexture(int textureIndex, StringId typeName, std::vector<Texture>& textures)
+    {
+        const JsonValue& image = document["images"][document["textures"][textureIndex]["source"].AsSize()];
+        std::string key = image.Has("uri") ? image["uri"].AsString() : "bufferView:" + std::to_string(image["bufferView"].AsInt(-1));
+
+        StringId path(key);
+        for (const Texture& loaded : texturesLoaded)
+        {
+            if (loaded.path == path)
+            {
+                textures.push_back(loaded);
+                return;
+            }
+        }
+
+        Texture texture;
+        texture.type = typeName;
+        texture.path = path;
+        // glTF UVs have a top-left origin and cannot be flipped without touching the vertex data,
+        // so decode these images unflipped (the demos flip globally for the Assimp path); the caller's
+        // setting is restored on every way out
+        struct FlipGuard {
+            int flip = 0, set = 0;
+            FlipGuard() { stbi_get_flip_state_thread(&flip, &set); }
+            ~FlipGuard() { stbi_restore_flip_state_thread(flip, set); }
+        } flipGuard;
+        stbi_set_flip_vertically_on_load_thread(false);
+        if (image.Has("uri"))
+        {
+            if (key.rfind("data:", 0) == 0)
+                return;
+            texture.handle = SharedTexture::Adopt(TextureFromFile(key.c_str(), directory, false));
+        }
+        else
+        {
+            // embedded image: decode straight out of the mapped buffer
+            const JsonValue& view = document["bufferViews"][image["bufferView"].AsSize()];
+            size_t bufferIndex = view["buffer"].AsSize();
+            if (bufferIndex >= buffers.size())
+                return;
+            const unsigned char* bytes = buffers[bufferIndex].data + view["byteOffset"].AsSize(0);
+            texture.handle = SharedTexture::Adopt(textureFromMemory(bytes, static_cast<int>(view["byteLength"].AsSize()), key));
+        }
+        textures.push_back(texture);
+        texturesLoaded.push_back(texture);
+    }
+
+    static unsigned int textureFromMemory(const unsigned char* bytes, int length, const std::string& name)
+    {
+        unsigned int textureID;
+        glGenTextures(1, &textureID);
+
+        int width, height, nrComponents;
+        unsigned char* data = stbi_load_from_memory(bytes, length, &width, &height, &nrComponents, 0);
+        if (data)
+        {
+            GLenum format = GL_RGBA;
+            if (nrComponents == 1)
+                format = GL_RED;
+            else if (nrComponents == 3)
+                format = GL_RGB;
+
+            glBindTexture(GL_TEXTURE_2D, textureID);
+            glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+            glGenerateMipmap(GL_TEXTURE_2D);
+
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        }
+        else
+        {
+            std::cout << "Texture failed to load from glTF image: " << name << std::endl;
+        }
+        stbi_image_free(data);
+
+        return textureID;
+    }
+
+    static uint32_t readU32(const unsigned char* bytes)
+    {
+        // GLB is little-endian
+        return uint32_t(bytes[0]) | (uint32_t(bytes[1]) << 8) | (uint32_t(bytes[2]) << 16) | (uint32_t(bytes[3]) << 24);
+    }
+};
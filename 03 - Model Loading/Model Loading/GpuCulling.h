@@ -0,0 +1,204 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "Bounds.h"
+#include "ComputeShader.h"
+#include "GpuResources.h"
+#include "HiZ.h"
+#include "Model.h"
+#include "Shader.h"
+
+#include <cstdint>
+#include <vector>
+
+// Shader storage bindings of the GPU culling pass, after the VAT ones
+#define GPU_CULL_INSTANCE_BINDING 3
+#define GPU_CULL_MESH_BINDING 4
+#define GPU_CULL_COMMAND_BINDING 5
+#define GPU_CULL_COUNT_BINDING 6
+#define GPU_CULL_VISIBILITY_BINDING 8
+#define GPU_CULL_STATS_BINDING 9
+// local_size_x of cull.cs
+#define GPU_CULL_GROUP_SIZE 64
+
+// std430 mirror of Instance in cull.cs and the GPU_INSTANCES variants of shader.vs/depth.vs
+struct GpuInstance {
+    glm::mat4 model;
+    // world space bounding sphere, xyz = center, w = radius
+    glm::vec4 sphere;
+};
+
+// std430 mirror of MeshDraw in cull.cs: the per-mesh part of a DrawElementsIndirectCommand
+struct GpuMeshDraw {
+    GLuint count;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint padding;
+};
+
+// glMultiDrawElementsIndirect* command layout, written by cull.cs
+struct DrawElementsIndirectCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+// Matches the phase uniform of cull.cs
+enum CullPhase {
+    CULL_FRUSTUM,
+    // frustum and visible last frame: the occluders the pyramid is built from
+    CULL_EARLY,
+    // frustum and the pyramid test: only instances that were not drawn by the early phase
+    CULL_LATE
+};
+
+static_assert(sizeof(GpuInstance) == 80, "GpuInstance must match the std430 Instance struct");
+static_assert(sizeof(GpuMeshDraw) == 16, "GpuMeshDraw must match the std430 MeshDraw struct");
+static_assert(sizeof(DrawElementsIndirectCommand) == 20, "DrawElementsIndirectCommand must be tightly packed");
+
+// Many placements of one Model culled and compacted entirely on the GPU.
+// cull.cs runs one invocation per instance; every visible instance appends one command per mesh to that mesh's
+// slice of the command buffer (baseInstance = instance index, read back as gl_BaseInstance by the vertex shader)
+// and bumps the mesh's counter in the parameter buffer. Drawing is then one glMultiDrawElementsIndirectCount
+// per mesh, whatever the instance count: the CPU never sees the visible set.
+// With occlusion culling a frame is two passes: draw the early phase, build the HiZ pyramid from that depth,
+// then draw the late phase, which also records per-instance visibility for the next frame's early phase.
+class GpuCulling {
+public:
+    struct Stats {
+        GLuint frustumVisible = 0;
+        GLuint occlusionVisible = 0;
+    };
+
+    GpuCulling(Model& model, const std::vector<glm::mat4>& transforms) : model(model)
+    {
+        instanceCount = static_cast<GLuint>(transforms.size());
+        meshCount = static_cast<GLuint>(model.meshes.size());
+
+        BoundingSphere localSphere = BoundingSphere::FromBox(model.bounds);
+        std::vector<GpuInstance> instances;
+        instances.reserve(transforms.size());
+        for (const glm::mat4& transform : transforms)
+        {
+            BoundingSphere sphere = localSphere.Transformed(transform);
+            instances.push_back({ transform, glm::vec4(sphere.center, sphere.radius) });
+        }
+        std::vector<GpuMeshDraw> meshDraws;
+        for (const Mesh& mesh : model.meshes)
+            meshDraws.push_back({ mesh.GetIndexCount(), mesh.GetFirstIndex(), 0, 0 });
+
+        instanceBuffer = createStorage(instances.size() * sizeof(GpuInstance), instances.data());
+        meshBuffer = createStorage(meshDraws.size() * sizeof(GpuMeshDraw), meshDraws.data());
+        commandBuffer = createStorage(size_t(meshCount) * instanceCount * sizeof(DrawElementsIndirectCommand), nullptr);
+        countBuffer = createStorage(meshCount * sizeof(GLuint), nullptr);
+        visibilityBuffer = createStorage(instances.size() * sizeof(GLuint), nullptr);
+        statsBuffer = createStorage(sizeof(Stats), nullptr);
+        clear(visibilityBuffer);
+        clear(statsBuffer);
+    }
+
+    // Rebuilds the command lists for this frustum; the draws that follow wait on it through the command barrier
+    void Cull(ComputeShader& cullShader, const Frustum& frustum, CullPhase phase = CULL_FRUSTUM)
+    {
+        cullShader.use();
+        dispatch(cullShader, frustum, phase);
+    }
+
+    // The late phase, against the pyramid built from the early phase's depth
+    void CullOccluded(ComputeShader& cullShader, const Frustum& frustum, const glm::mat4& viewProjection, const HiZPyramid& hiZ)
+    {
+        cullShader.use();
+        hiZ.Bind(cullShader, 0);
+        cullShader.setMat4("viewProjection", viewProjection);
+        clear(statsBuffer);
+        dispatch(cullShader, frustum, CULL_LATE);
+    }
+
+    // shader must be a GPU_INSTANCES variant, it reads its model matrix from the instance buffer
+    void Draw(Shader& shader, RenderPass pass = COLOR_PASS)
+    {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GPU_CULL_INSTANCE_BINDING, instanceBuffer.Id());
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer.Id());
+        glBindBuffer(GL_PARAMETER_BUFFER, countBuffer.Id());
+        for (GLuint i = 0; i < meshCount; i++)
+        {
+            GLintptr commandOffset = GLintptr(i) * instanceCount * sizeof(DrawElementsIndirectCommand);
+            model.meshes[i].DrawIndirectCount(shader, commandOffset, GLintptr(i) * sizeof(GLuint), static_cast<GLsizei>(instanceCount), pass);
+        }
+        glBindBuffer(GL_PARAMETER_BUFFER, 0);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    }
+
+    // Reads back the first mesh's counter, i.e. the number of visible instances. Stalls until the cull
+    // has run, so only call it for occasional statistics.
+    GLuint ReadVisibleCount() const
+    {
+        GLuint visible = 0;
+        glBindBuffer(GL_COPY_READ_BUFFER, countBuffer.Id());
+        glGetBufferSubData(GL_COPY_READ_BUFFER, 0, sizeof(GLuint), &visible);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        return visible;
+    }
+
+    // Counters of the last late phase; stalls like ReadVisibleCount
+    Stats ReadStats() const
+    {
+        Stats stats;
+        glBindBuffer(GL_COPY_READ_BUFFER, statsBuffer.Id());
+        glGetBufferSubData(GL_COPY_READ_BUFFER, 0, sizeof(Stats), &stats);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        return stats;
+    }
+
+    GLuint InstanceCount() const { return instanceCount; }
+
+private:
+    Model& model;
+    GLuint instanceCount = 0, meshCount = 0;
+    SharedBuffer instanceBuffer, meshBuffer, commandBuffer, countBuffer, visibilityBuffer, statsBuffer;
+
+    static SharedBuffer createStorage(size_t size, const void* data)
+    {
+        SharedBuffer buffer = GpuResources::CreateBuffer();
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer.Id());
+        // empty buffers are still given a byte so they can be bound
+        glBufferData(GL_SHADER_STORAGE_BUFFER, size ? size : 4, data, data ? GL_STATIC_DRAW : GL_DYNAMIC_COPY);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        return buffer;
+    }
+
+    static void clear(const SharedBuffer& buffer)
+    {
+        GLuint zero = 0;
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer.Id());
+        glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+
+    // cullShader must be in use
+    void dispatch(ComputeShader& cullShader, const Frustum& frustum, CullPhase phase)
+    {
+        clear(countBuffer);
+        bindStorage();
+        cullShader.setVec4Array("frustumPlanes", frustum.planes, 6);
+        cullShader.setUInt("instanceCount", instanceCount);
+        cullShader.setUInt("meshCount", meshCount);
+        cullShader.setUInt("phase", static_cast<GLuint>(phase));
+        glDispatchCompute(ComputeShader::Groups(instanceCount, GPU_CULL_GROUP_SIZE), 1, 1);
+        glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+
+    void bindStorage() const
+    {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GPU_CULL_INSTANCE_BINDING, instanceBuffer.Id());
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GPU_CULL_MESH_BINDING, meshBuffer.Id());
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GPU_CULL_COMMAND_BINDING, commandBuffer.Id());
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GPU_CULL_COUNT_BINDING, countBuffer.Id());
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GPU_CULL_VISIBILITY_BINDING, visibilityBuffer.Id());
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GPU_CULL_STATS_BINDING, statsBuffer.Id());
+    }
+};
@@ -0,0 +1,241 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+enum class GpuResourceType : uint8_t {
+    Texture,
+    Buffer,
+    VertexArray,
+    Program,
+    Query,
+    Framebuffer
+};
+
+// Index into a pool slot plus the generation the slot had when the handle was made. Once the object is
+// freed the slot's generation moves on, so stale handles resolve to 0 instead of to whatever reuses the slot.
+template <GpuResourceType Type>
+struct GpuHandle {
+    uint32_t index = 0;
+    uint32_t generation = 0;
+
+    bool IsValid() const { return generation != 0; }
+    bool operator==(const GpuHandle& other) const { return index == other.index && generation == other.generation; }
+    bool operator!=(const GpuHandle& other) const { return !(*this == other); }
+};
+
+// Dense, reference counted table of GL object names of one kind. Ids, generations and counts live in
+// parallel arrays, so resolving a handle is two loads from contiguous memory. Objects whose count drops to
+// zero are queued and only deleted by Collect(), which keeps destructors free of GL calls: a Mesh going out
+// of scope after glfwTerminate, or on a streaming thread, is fine.
+template <GpuResourceType Type>
+class GpuPool {
+public:
+    static GpuPool& Get()
+    {
+        static GpuPool pool;
+        return pool;
+    }
+
+    // Takes ownership of an existing GL name, the handle starts with one reference
+    GpuHandle<Type> Adopt(GLuint id)
+    {
+        if (id == 0)
+            return {};
+        uint32_t index;
+        if (!freeSlots.empty())
+        {
+            index = freeSlots.back();
+            freeSlots.pop_back();
+        }
+        else
+        {
+            index = static_cast<uint32_t>(ids.size());
+            ids.push_back(0);
+            generations.push_back(1);
+            refCounts.push_back(0);
+        }
+        ids[index] = id;
+        refCounts[index] = 1;
+        live++;
+        return { index, generations[index] };
+    }
+
+    // 0 for null or stale handles
+    GLuint Resolve(GpuHandle<Type> handle) const
+    {
+        if (handle.index >= ids.size() || generations[handle.index] != handle.generation)
+            return 0;
+        return ids[handle.index];
+    }
+
+    void Retain(GpuHandle<Type> handle)
+    {
+        if (Resolve(handle))
+            refCounts[handle.index]++;
+    }
+
+    void Release(GpuHandle<Type> handle)
+    {
+        if (!Resolve(handle) || --refCounts[handle.index] > 0)
+            return;
+        pendingDeletes.push_back(ids[handle.index]);
+        ids[handle.index] = 0;
+        // generation 0 is the null handle, skip it on wrap-around
+        if (++generations[handle.index] == 0)
+            generations[handle.index] = 1;
+        freeSlots.push_back(handle.index);
+        live--;
+    }
+
+    // Deletes every object released since the last call, needs a current context
+    void Collect()
+    {
+        if (pendingDeletes.empty())
+            return;
+        GLsizei count = static_cast<GLsizei>(pendingDeletes.size());
+        switch (Type)
+        {
+        case GpuResourceType::Texture: glDeleteTextures(count, pendingDeletes.data()); break;
+        case GpuResourceType::Buffer: glDeleteBuffers(count, pendingDeletes.data()); break;
+        case GpuResourceType::VertexArray: glDeleteVertexArrays(count, pendingDeletes.data()); break;
+        case GpuResourceType::Program:
+            for (GLuint program : pendingDeletes)
+                glDeleteProgram(program);
+            break;
+        case GpuResourceType::Query: glDeleteQueries(count, pendingDeletes.data()); break;
+        case GpuResourceType::Framebuffer: glDeleteFramebuffers(count, pendingDeletes.data()); break;
+        }
+        deleted += pendingDeletes.size();
+        pendingDeletes.clear();
+    }
+
+    size_t LiveCount() const { return live; }
+    size_t DeletedCount() const { return deleted; }
+
+private:
+    std::vector<GLuint> ids;
+    std::vector<uint32_t> generations;
+    std::vector<uint32_t> refCounts;
+    std::vector<uint32_t> freeSlots;
+    std::vector<GLuint> pendingDeletes;
+    size_t live = 0;
+    size_t deleted = 0;
+};
+
+// Owning reference to a pooled object: copies share it, the last one to go releases it.
+template <GpuResourceType Type>
+class GpuResource {
+public:
+    GpuResource() = default;
+
+    static GpuResource Adopt(GLuint id)
+    {
+        GpuResource resource;
+        resource.handle = GpuPool<Type>::Get().Adopt(id);
+        return resource;
+    }
+
+    GpuResource(const GpuResource& other) : handle(other.handle)
+    {
+        GpuPool<Type>::Get().Retain(handle);
+    }
+
+    GpuResource(GpuResource&& other) noexcept : handle(other.handle)
+    {
+        other.handle = {};
+    }
+
+    GpuResource& operator=(GpuResource other) noexcept
+    {
+        std::swap(handle, other.handle);
+        return *this;
+    }
+
+    ~GpuResource()
+    {
+        GpuPool<Type>::Get().Release(handle);
+    }
+
+    GLuint Id() const { return GpuPool<Type>::Get().Resolve(handle); }
+    GpuHandle<Type> Handle() const { return handle; }
+    explicit operator bool() const { return Id() != 0; }
+
+private:
+    GpuHandle<Type> handle;
+};
+
+using SharedTexture = GpuResource<GpuResourceType::Texture>;
+using SharedBuffer = GpuResource<GpuResourceType::Buffer>;
+using SharedVertexArray = GpuResource<GpuResourceType::VertexArray>;
+using SharedProgram = GpuResource<GpuResourceType::Program>;
+using SharedQuery = GpuResource<GpuResourceType::Query>;
+using SharedFramebuffer = GpuResource<GpuResourceType::Framebuffer>;
+
+namespace GpuResources {
+    // Call once per frame (and before shutdown) to delete everything released since the last call
+    inline void Collect()
+    {
+        GpuPool<GpuResourceType::Texture>::Get().Collect();
+        GpuPool<GpuResourceType::Buffer>::Get().Collect();
+        GpuPool<GpuResourceType::VertexArray>::Get().Collect();
+        GpuPool<GpuResourceType::Program>::Get().Collect();
+        GpuPool<GpuResourceType::Query>::Get().Collect();
+        GpuPool<GpuResourceType::Framebuffer>::Get().Collect();
+    }
+
+    inline SharedTexture CreateTexture()
+    {
+        GLuint id = 0;
+        glGenTextures(1, &id);
+        return SharedTexture::Adopt(id);
+    }
+
+    inline SharedBuffer CreateBuffer()
+    {
+        GLuint id = 0;
+        glGenBuffers(1, &id);
+        return SharedBuffer::Adopt(id);
+    }
+
+    inline SharedVertexArray CreateVertexArray()
+    {
+        GLuint id = 0;
+        glGenVertexArrays(1, &id);
+        return SharedVertexArray::Adopt(id);
+    }
+
+    inline SharedQuery CreateQuery()
+    {
+        GLuint id = 0;
+        glGenQueries(1, &id);
+        return SharedQuery::Adopt(id);
+    }
+
+    inline SharedFramebuffer CreateFramebuffer()
+    {
+        GLuint id = 0;
+        glGenFramebuffers(1, &id);
+        return SharedFramebuffer::Adopt(id);
+    }
+
+    inline void Report()
+    {
+        std::cout << "GPU::RESOURCES live/deleted: textures " << GpuPool<GpuResourceType::Texture>::Get().LiveCount()
+                  << "/" << GpuPool<GpuResourceType::Texture>::Get().DeletedCount()
+                  << ", buffers " << GpuPool<GpuResourceType::Buffer>::Get().LiveCount()
+                  << "/" << GpuPool<GpuResourceType::Buffer>::Get().DeletedCount()
+                  << ", vertex arrays " << GpuPool<GpuResourceType::VertexArray>::Get().LiveCount()
+                  << "/" << GpuPool<GpuResourceType::VertexArray>::Get().DeletedCount()
+                  << ", programs " << GpuPool<GpuResourceType::Program>::Get().LiveCount()
+                  << "/" << GpuPool<GpuResourceType::Program>::Get().DeletedCount()
+                  << ", queries " << GpuPool<GpuResourceType::Query>::Get().LiveCount()
+                  << "/" << GpuPool<GpuResourceType::Query>::Get().DeletedCount()
+                  << ", framebuffers " << GpuPool<GpuResourceType::Framebuffer>::Get().LiveCount()
+                  << "/" << GpuPool<GpuResourceType::Framebuffer>::Get().DeletedCount() << std::endl;
+    }
+}
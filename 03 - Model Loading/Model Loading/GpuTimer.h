@@ -0,0 +1,63 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "GpuResources.h"
+
+#include <cstdint>
+
+// GL_TIME_ELAPSED around a span of GPU work. Results are read one frame late from a ring of queries, so
+// reading never waits for the GPU; Milliseconds() is the last span that has finished.
+class GpuTimer {
+public:
+    // the queries are pooled, so a timer outliving the context (a local of main) makes no GL call on destruction
+    GpuTimer()
+    {
+        for (SharedQuery& query : queries)
+            query = GpuResources::CreateQuery();
+    }
+
+    GpuTimer(const GpuTimer&) = delete;
+    GpuTimer& operator=(const GpuTimer&) = delete;
+
+    void Begin()
+    {
+        collect();
+        glBeginQuery(GL_TIME_ELAPSED, queries[current].Id());
+    }
+
+    void End()
+    {
+        glEndQuery(GL_TIME_ELAPSED);
+        issued[current] = true;
+        current = (current + 1) % QUERY_COUNT;
+    }
+
+    double Milliseconds() const { return milliseconds; }
+
+private:
+    static const int QUERY_COUNT = 4;
+    SharedQuery queries[QUERY_COUNT];
+    bool issued[QUERY_COUNT] = {};
+    int current = 0;
+    double milliseconds = 0.0;
+
+    // oldest first, stops at the first query the GPU has not reached yet
+    void collect()
+    {
+        for (int i = 0; i < QUERY_COUNT; i++)
+        {
+            int slot = (current + i) % QUERY_COUNT;
+            if (!issued[slot])
+                continue;
+            GLint available = GL_FALSE;
+            glGetQueryObjectiv(queries[slot].Id(), GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available)
+                break;
+            GLuint64 nanoseconds = 0;
+            glGetQueryObjectui64v(queries[slot].Id(), GL_QUERY_RESULT, &nanoseconds);
+            milliseconds = nanoseconds / 1.0e6;
+            issued[slot] = false;
+        }
+    }
+};
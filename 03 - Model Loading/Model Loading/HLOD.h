@@ -0,0 +1,322 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "Mesh.h"
+#include "Model.h"
+#include "Shader.h"
+
+#include <string>
+#include <iostream>
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <tuple>
+
+// A placed, non-moving instance of a Model in a scene.
+struct SceneObject {
+    Model* model;
+    glm::mat4 transform;
+};
+
+// Hierarchical LOD proxies.
+// Build step: static objects are grouped by a uniform grid of clusterSize, every group is merged into
+// world space, simplified by vertex clustering and re-textured through one baked atlas (diffuse and
+// specular), so a whole group collapses into a single Mesh and a single draw.
+// Runtime: a cluster whose bounding sphere is farther than switchDistance draws its proxy instead of
+// its members.
+struct HLODCluster {
+    std::vector<size_t> objects;
+    glm::vec3 center;
+    float radius;
+    // index into HLOD::proxies
+    size_t proxy;
+};
+
+class HLOD
+{
+public:
+    std::vector<HLODCluster> clusters;
+    std::vector<Mesh> proxies;
+    float switchDistance;
+    // filled by Draw
+    unsigned int drawCalls = 0;
+    unsigned int proxiesDrawn = 0;
+
+    HLOD(const std::vector<SceneObject>& objects, float clusterSize, float switchDistance, int simplifyResolution = 24, int atlasTileSize = 256)
+        : switchDistance(switchDistance)
+    {
+        build(objects, clusterSize, simplifyResolution, atlasTileSize);
+    }
+
+    // shader must take "model" as a mat4 like shader.vs; proxies are already in world space
+    void Draw(Shader& shader, const std::vector<SceneObject>& objects, const glm::vec3& cameraPosition, RenderPass pass = COLOR_PASS)
+    {
+        drawCalls = 0;
+        proxiesDrawn = 0;
+        for (const HLODCluster& cluster : clusters)
+        {
+            float distance = glm::length(cameraPosition - cluster.center) - cluster.radius;
+            if (distance > switchDistance)
+            {
+                shader.setMat4("model", glm::mat4(1.0f));
+                proxies[cluster.proxy].Draw(shader, pass);
+                drawCalls++;
+                proxiesDrawn++;
+                continue;
+            }
+            for (size_t index : cluster.objects)
+            {
+                shader.setMat4("model", objects[index].transform);
+                objects[index].model->Draw(shader, pass);
+                drawCalls += static_cast<unsigned int>(objects[index].model->meshes.size());
+            }
+        }
+    }
+
+private:
+    // one atlas tile per distinct (diffuse, specular) texture pair
+    struct TileKey {
+        unsigned int diffuse;
+        unsigned int specular;
+        bool operator<(const TileKey& other) const
+        {
+            return diffuse != other.diffuse ? diffuse < other.diffuse : specular < other.specular;
+        }
+    };
+
+    struct CellKey {
+        int x, y, z, tile;
+        bool operator==(const CellKey& other) const
+        {
+            return x == other.x && y == other.y && z == other.z && tile == other.tile;
+        }
+    };
+
+    struct CellHash {
+        size_t operator()(const CellKey& key) const
+        {
+            return (static_cast<size_t>(key.x) * 73856093u) ^ (static_cast<size_t>(key.y) * 19349663u) ^
+                   (static_cast<size_t>(key.z) * 83492791u) ^ (static_cast<size_t>(key.tile) * 2654435761u);
+        }
+    };
+
+    void build(const std::vector<SceneObject>& objects, float clusterSize, int simplifyResolution, int atlasTileSize)
+    {
+        // 1. group by the grid cell containing each object's origin
+        std::map<std::tuple<int, int, int>, std::vector<size_t>> cells;
+        for (size_t i = 0; i < objects.size(); i++)
+        {
+            glm::vec3 origin = glm::vec3(objects[i].transform[3]);
+            glm::ivec3 cell = glm::ivec3(glm::floor(origin / clusterSize));
+            cells[std::make_tuple(cell.x, cell.y, cell.z)].push_back(i);
+        }
+
+        size_t sourceTriangles = 0, proxyTriangles = 0;
+        for (auto& cell : cells)
+        {
+            HLODCluster cluster;
+            cluster.objects = cell.second;
+            cluster.proxy = proxies.size();
+            proxies.push_back(buildProxy(objects, cluster.objects, simplifyResolution, atlasTileSize, sourceTriangles, proxyTriangles));
+            computeBounds(proxies.back(), cluster);
+            clusters.push_back(cluster);
+        }
+
+        std::cout << "HLOD: " << objects.size() << " objects -> " << clusters.size() << " clusters, "
+                  << sourceTriangles << " -> " << proxyTriangles << " triangles in proxies" << std::endl;
+    }
+
+    static void computeBounds(const Mesh& proxy, HLODCluster& cluster)
+    {
+        glm::vec3 minimum(std::numeric_limits<float>::max()), maximum(-std::numeric_limits<float>::max());
+        for (const Vertex& vertex : proxy.vertices)
+        {
+            minimum = glm::min(minimum, vertex.Position);
+            maximum = glm::max(maximum, vertex.Position);
+        }
+        cluster.center = proxy.vertices.empty() ? glm::vec3(0.0f) : (minimum + maximum) * 0.5f;
+        cluster.radius = proxy.vertices.empty() ? 0.0f : glm::length(maximum - minimum) * 0.5f;
+    }
+
+    Mesh buildProxy(const std::vector<SceneObject>& objects, const std::vector<size_t>& members, int simplifyResolution,
+                    int atlasTileSize, size_t& sourceTriangles, size_t& proxyTriangles)
+    {
+        // 2. atlas layout
+        std::map<TileKey, int> tiles;
+        for (size_t index : members)
+            for (const Mesh& mesh : objects[index].model->meshes)
+                tiles.emplace(tileKey(mesh), static_cast<int>(tiles.size()));
+        int tilesPerRow = static_cast<int>(std::ceil(std::sqrt(static_cast<float>(tiles.size()))));
+        float tileScale = 1.0f / tilesPerRow;
+
+        // 3. merge into world space with atlas UVs
+        std::vector<Vertex> vertices;
+        std::vector<unsigned int> indices;
+        std::vector<int> vertexTile;
+        glm::vec3 minimum(std::numeric_limits<float>::max()), maximum(-std::numeric_limits<float>::max());
+        for (size_t index : members)
+        {
+            const glm::mat4& transform = objects[index].transform;
+            glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(transform)));
+            for (const Mesh& mesh : objects[index].model->meshes)
+            {
+                int tile = tiles[tileKey(mesh)];
+                glm::vec2 tileOffset = glm::vec2(tile % tilesPerRow, tile / tilesPerRow) * tileScale;
+                unsigned int base = static_cast<unsigned int>(vertices.size());
+                for (const Vertex& source : mesh.vertices)
+                {
+                    Vertex vertex = source;
+                    vertex.Position = glm::vec3(transform * glm::vec4(source.Position, 1.0f));
+                    vertex.Normal = glm::normalize(normalMatrix * source.Normal);
+                    // clamp: a proxy tile cannot repeat
+                    vertex.TexCoords = tileOffset + glm::clamp(source.TexCoords, 0.0f, 1.0f) * tileScale;
+                    vertices.push_back(vertex);
+                    vertexTile.push_back(tile);
+                    minimum = glm::min(minimum, vertex.Position);
+                    maximum = glm::max(maximum, vertex.Position);
+                }
+                for (unsigned int i : mesh.indices)
+                    indices.push_back(base + i);
+            }
+        }
+        sourceTriangles += indices.size() / 3;
+
+        // 4. vertex clustering: one representative vertex per grid cell (and atlas tile), degenerate triangles dropped
+        float cellSize = std::max(glm::length(maximum - minimum) / simplifyResolution, 1e-4f);
+        std::unordered_map<CellKey, unsigned int, CellHash> cellIndex;
+        std::vector<Vertex> simplified;
+        std::vector<float> weights;
+        std::vector<unsigned int> remap(vertices.size());
+        for (size_t i = 0; i < vertices.size(); i++)
+        {
+            glm::ivec3 cell = glm::ivec3(glm::floor((vertices[i].Position - minimum) / cellSize));
+            CellKey key = { cell.x, cell.y, cell.z, vertexTile[i] };
+            auto found = cellIndex.find(key);
+            if (found == cellIndex.end())
+            {
+                found = cellIndex.emplace(key, static_cast<unsigned int>(simplified.size())).first;
+                Vertex accumulator = vertices[i];
+                accumulator.Position = glm::vec3(0.0f);
+                accumulator.Normal = glm::vec3(0.0f);
+                accumulator.TexCoords = glm::vec2(0.0f);
+                simplified.push_back(accumulator);
+                weights.push_back(0.0f);
+            }
+            Vertex& target = simplified[found->second];
+            target.Position += vertices[i].Position;
+            target.Normal += vertices[i].Normal;
+            target.TexCoords += vertices[i].TexCoords;
+            weights[found->second] += 1.0f;
+            remap[i] = found->second;
+        }
+        for (size_t i = 0; i < simplified.size(); i++)
+        {
+            simplified[i].Position /= weights[i];
+            simplified[i].TexCoords /= weights[i];
+            float length = glm::length(simplified[i].Normal);
+            simplified[i].Normal = length > 0.0f ? simplified[i].Normal / length : glm::vec3(0.0f, 1.0f, 0.0f);
+        }
+
+        std::vector<unsigned int> simplifiedIndices;
+        for (size_t t = 0; t + 2 < indices.size(); t += 3)
+        {
+            unsigned int a = remap[indices[t]], b = remap[indices[t + 1]], c = remap[indices[t + 2]];
+            if (a == b || b == c || a == c)
+                continue;
+            simplifiedIndices.push_back(a);
+            simplifiedIndices.push_back(b);
+            simplifiedIndices.push_back(c);
+        }
+        proxyTriangles += simplifiedIndices.size() / 3;
+
+        // 5. bake the atlases
+        std::vector<Texture> textures;
+        textures.push_back({ SharedTexture::Adopt(bakeAtlas(tiles, tilesPerRow, atlasTileSize, true)), TEXTURE_DIFFUSE, "hlod_atlas_diffuse"_sid });
+        textures.push_back({ SharedTexture::Adopt(bakeAtlas(tiles, tilesPerRow, atlasTileSize, false)), TEXTURE_SPECULAR, "hlod_atlas_specular"_sid });
+
+        return Mesh(simplified, simplifiedIndices, textures);
+    }
+
+    static TileKey tileKey(const Mesh& mesh)
+    {
+        TileKey key = { 0, 0 };
+        for (const Texture& texture : mesh.textures)
+        {
+            if (texture.type == TEXTURE_DIFFUSE && !key.diffuse)
+                key.diffuse = texture.handle.Id();
+            else if (texture.type == TEXTURE_SPECULAR && !key.specular)
+                key.specular = texture.handle.Id();
+        }
+        return key;
+    }
+
+    // Renders every source texture, downsampled, into its tile of a new atlas texture.
+    unsigned int bakeAtlas(const std::map<TileKey, int>& tiles, int tilesPerRow, int tileSize, bool diffuse)
+    {
+        if (!bakeShader)
+        {
+            bakeShader = std::make_unique<Shader>("hlod_bake.vs", "hlod_bake.fs");
+            bakeVertexArray = GpuResources::CreateVertexArray();
+        }
+
+        int atlasSize = tilesPerRow * tileSize;
+        unsigned int atlas;
+        glGenTextures(1, &atlas);
+        glBindTexture(GL_TEXTURE_2D, atlas);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, atlasSize, atlasSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        GLint previousFramebuffer, previousViewport[4];
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+        glGetIntegerv(GL_VIEWPORT, previousViewport);
+        GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+
+        unsigned int framebuffer;
+        glGenFramebuffers(1, &framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, atlas, 0);
+        glDisable(GL_DEPTH_TEST);
+        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+
+        bakeShader->use();
+        bakeShader->setInt("source", 0);
+        glBindVertexArray(bakeVertexArray.Id());
+        glActiveTexture(GL_TEXTURE0);
+        for (const auto& tile : tiles)
+        {
+            unsigned int source = diffuse ? tile.first.diffuse : tile.first.specular;
+            if (!source)
+                continue;
+            glViewport((tile.second % tilesPerRow) * tileSize, (tile.second / tilesPerRow) * tileSize, tileSize, tileSize);
+            glBindTexture(GL_TEXTURE_2D, source);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+        }
+        glBindVertexArray(0);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+        glDeleteFramebuffers(1, &framebuffer);
+        glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+        if (depthTest)
+            glEnable(GL_DEPTH_TEST);
+
+        glBindTexture(GL_TEXTURE_2D, atlas);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        return atlas;
+    }
+
+    std::unique_ptr<Shader> bakeShader;
+    SharedVertexArray bakeVertexArray;
+};
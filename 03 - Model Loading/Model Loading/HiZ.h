@@ -0,0 +1,138 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "ComputeShader.h"
+#include "GpuResources.h"
+
+#include <algorithm>
+#include <iostream>
+
+// hiz_downsample.cs binds one image unit per level, 8 is the minimum GL guarantees for compute shaders
+#define HIZ_MAX_LEVELS 8
+// each workgroup of hiz_downsample.cs reduces a 32x32 tile of level 0 down to level 5 on its own
+#define HIZ_TILE_SIZE 32
+#define HIZ_COUNTER_BINDING 7
+
+// Offscreen scene target with a sampleable depth texture, and the max-depth pyramid built from it.
+// Level 0 is the largest power of two that fits the screen, every texel holding the farthest depth of the
+// (up to 3x3) screen pixels it covers, and each next level the max of 2x2 texels, so a texel is always a
+// conservative "nothing here is farther than this" for its screen area.
+// The pyramid is built in one dispatch: workgroups reduce their tile to level 5 in shared memory, and the last
+// workgroup to finish (counted with an atomic) reduces the remaining levels from the complete level 5.
+class HiZPyramid {
+public:
+    // Renders the scene into the offscreen target, resized to the framebuffer when that changes; a minimized
+    // window (0x0) keeps the old target, nothing is visible anyway
+    void BeginScene(int width, int height)
+    {
+        if ((width != sceneWidth || height != sceneHeight) && width > 0 && height > 0)
+            resize(width, height);
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer.Id());
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    }
+
+    // Copies the color to the framebuffer that was bound before BeginScene
+    void EndScene()
+    {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer.Id());
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, previousFramebuffer);
+        glBlitFramebuffer(0, 0, sceneWidth, sceneHeight, 0, 0, sceneWidth, sceneHeight, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+    }
+
+    // Call between BeginScene and EndScene, after the occluders are drawn
+    void Build(ComputeShader& downsampleShader)
+    {
+        downsampleShader.use();
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, depthTexture.Id());
+        downsampleShader.setInt("depthTexture", 0);
+        downsampleShader.setInt("levelCount", levels);
+        for (int level = 0; level < HIZ_MAX_LEVELS; level++)
+            glBindImageTexture(level, pyramid.Id(), std::min(level, levels - 1), GL_FALSE, 0, GL_READ_WRITE, GL_R32F);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, HIZ_COUNTER_BINDING, counterBuffer.Id());
+
+        GLuint groupsX = ComputeShader::Groups(pyramidWidth, HIZ_TILE_SIZE);
+        GLuint groupsY = ComputeShader::Groups(pyramidHeight, HIZ_TILE_SIZE);
+        downsampleShader.setUInt("groupCount", groupsX * groupsY);
+        glDispatchCompute(groupsX, groupsY, 1);
+        // the image stores must be visible to texelFetch in the culling pass
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    // Sets the sampler and size uniforms a culling shader needs to test against the pyramid
+    void Bind(ComputeShader& shader, GLuint unit) const
+    {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(GL_TEXTURE_2D, pyramid.Id());
+        shader.setInt("hiZ", static_cast<int>(unit));
+        shader.setVec2("hiZSize", glm::vec2(pyramidWidth, pyramidHeight));
+        shader.setInt("hiZLevels", levels);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+private:
+    SharedTexture colorTexture, depthTexture, pyramid;
+    SharedBuffer counterBuffer;
+    SharedFramebuffer framebuffer;
+    GLint previousFramebuffer = 0;
+    int sceneWidth = 0, sceneHeight = 0;
+    int pyramidWidth = 0, pyramidHeight = 0;
+    int levels = 0;
+
+    static int previousPowerOfTwo(int value)
+    {
+        int power = 1;
+        while (power * 2 <= value)
+            power *= 2;
+        return power;
+    }
+
+    void resize(int width, int height)
+    {
+        sceneWidth = width;
+        sceneHeight = height;
+        pyramidWidth = previousPowerOfTwo(width);
+        pyramidHeight = previousPowerOfTwo(height);
+        levels = 1;
+        while (levels < HIZ_MAX_LEVELS && (pyramidWidth >> levels) > 0 && (pyramidHeight >> levels) > 0)
+            levels++;
+
+        colorTexture = GpuResources::CreateTexture();
+        glBindTexture(GL_TEXTURE_2D, colorTexture.Id());
+        glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, width, height);
+        depthTexture = GpuResources::CreateTexture();
+        glBindTexture(GL_TEXTURE_2D, depthTexture.Id());
+        glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT32F, width, height);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        pyramid = GpuResources::CreateTexture();
+        glBindTexture(GL_TEXTURE_2D, pyramid.Id());
+        glTexStorage2D(GL_TEXTURE_2D, levels, GL_R32F, pyramidWidth, pyramidHeight);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        if (!framebuffer)
+            framebuffer = GpuResources::CreateFramebuffer();
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer.Id());
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTexture.Id(), 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthTexture.Id(), 0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::HIZ::FRAMEBUFFER_INCOMPLETE" << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        if (!counterBuffer)
+        {
+            GLuint zero = 0;
+            counterBuffer = GpuResources::CreateBuffer();
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, counterBuffer.Id());
+            glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint), &zero, GL_DYNAMIC_COPY);
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        }
+    }
+};
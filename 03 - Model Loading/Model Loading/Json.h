@@ -0,0 +1,206 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdlib>
+#include <cstring>
+#include <cstddef>
+
+// Minimal JSON DOM, just enough for asset headers such as glTF. Strings are kept raw (escape
+// sequences other than \" and \\ are not decoded), which is fine for names, keys and URIs.
+struct JsonValue
+{
+    enum Type { NUL, BOOLEAN, NUMBER, STRING, ARRAY, OBJECT };
+
+    Type type = NUL;
+    bool boolean = false;
+    double number = 0.0;
+    std::string string;
+    std::vector<JsonValue> array;
+    std::map<std::string, JsonValue> object;
+
+    bool IsNull() const { return type == NUL; }
+    bool Has(const std::string& key) const { return type == OBJECT && object.count(key) > 0; }
+    size_t Size() const { return type == ARRAY ? array.size() : object.size(); }
+
+    // Missing keys/indices yield a shared null value so lookups can be chained safely.
+    const JsonValue& operator[](const std::string& key) const
+    {
+        if (type == OBJECT)
+        {
+            auto it = object.find(key);
+            if (it != object.end())
+                return it->second;
+        }
+        return Null();
+    }
+
+    const JsonValue& operator[](size_t index) const
+    {
+        if (type == ARRAY && index < array.size())
+            return array[index];
+        return Null();
+    }
+
+    int AsInt(int fallback = 0) const { return type == NUMBER ? static_cast<int>(number) : fallback; }
+    size_t AsSize(size_t fallback = 0) const { return type == NUMBER ? static_cast<size_t>(number) : fallback; }
+    double AsNumber(double fallback = 0.0) const { return type == NUMBER ? number : fallback; }
+    const std::string& AsString() const { return string; }
+
+    static const JsonValue& Null()
+    {
+        static const JsonValue null;
+        return null;
+    }
+
+    static bool Parse(const char* begin, const char* end, JsonValue& out)
+    {
+        const char* cursor = begin;
+        if (!parseValue(cursor, end, out))
+            return false;
+        skipWhitespace(cursor, end);
+        return cursor == end || *cursor == '\0';
+    }
+
+private:
+    static void skipWhitespace(const char*& c, const char* end)
+    {
+        while (c < end && (*c == ' ' || *c == '\t' || *c == '\n' || *c == '\r'))
+            ++c;
+    }
+
+    static bool parseString(const char*& c, const char* end, std::string& out)
+    {
+        if (c >= end || *c != '"')
+            return false;
+        ++c;
+        while (c < end && *c != '"')
+        {
+            if (*c == '\\' && c + 1 < end)
+            {
+                ++c;
+                out += (*c == '"' || *c == '\\' || *c == '/') ? *c : '?';
+                ++c;
+                continue;
+            }
+            out += *c++;
+        }
+        if (c >= end)
+            return false;
+        ++c;
+        return true;
+    }
+
+    static bool parseLiteral(const char*& c, const char* end, const char* literal)
+    {
+        for (; *literal; ++literal, ++c)
+            if (c >= end || *c != *literal)
+                return false;
+        return true;
+    }
+
+    static bool parseValue(const char*& c, const char* end, JsonValue& out)
+    {
+        skipWhitespace(c, end);
+        if (c >= end)
+            return false;
+
+        switch (*c)
+        {
+        case '{':
+        {
+            out.type = OBJECT;
+            ++c;
+            skipWhitespace(c, end);
+            if (c < end && *c == '}')
+            {
+                ++c;
+                return true;
+            }
+            while (c < end)
+            {
+                std::string key;
+                skipWhitespace(c, end);
+                if (!parseString(c, end, key))
+                    return false;
+                skipWhitespace(c, end);
+                if (c >= end || *c != ':')
+                    return false;
+                ++c;
+                if (!parseValue(c, end, out.object[key]))
+                    return false;
+                skipWhitespace(c, end);
+                if (c < end && *c == ',')
+                {
+                    ++c;
+                    continue;
+                }
+                if (c < end && *c == '}')
+                {
+                    ++c;
+                    return true;
+                }
+                return false;
+            }
+            return false;
+        }
+        case '[':
+        {
+            out.type = ARRAY;
+            ++c;
+            skipWhitespace(c, end);
+            if (c < end && *c == ']')
+            {
+                ++c;
+                return true;
+            }
+            while (c < end)
+            {
+                out.array.emplace_back();
+                if (!parseValue(c, end, out.array.back()))
+                    return false;
+                skipWhitespace(c, end);
+                if (c < end && *c == ',')
+                {
+                    ++c;
+                    continue;
+                }
+                if (c < end && *c == ']')
+                {
+                    ++c;
+                    return true;
+                }
+                return false;
+            }
+            return false;
+        }
+        case '"':
+            out.type = STRING;
+            return parseString(c, end, out.string);
+        case 't':
+            out.type = BOOLEAN;
+            out.boolean = true;
+            return parseLiteral(c, end, "true");
+        case 'f':
+            out.type = BOOLEAN;
+            out.boolean = false;
+            return parseLiteral(c, end, "false");
+        case 'n':
+            out.type = NUL;
+            return parseLiteral(c, end, "null");
+        default:
+        {
+            // strtod needs a terminated buffer, numbers are short so copy the token
+            const char* start = c;
+            while (c < end && *c != '\0' && std::strchr("+-0123456789.eE", *c) != nullptr)
+                ++c;
+            if (c == start)
+                return false;
+            out.type = NUMBER;
+            out.number = std::strtod(std::string(start, c).c_str(), nullptr);
+            return true;
+        }
+        }
+    }
+};
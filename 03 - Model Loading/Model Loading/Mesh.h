@@ -6,6 +6,9 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "Shader.h"
+#include "StringId.h"
+#include "GpuResources.h"
+#include "Bounds.h"
 
 #include <string>
 #include <vector>
@@ -30,10 +33,37 @@ struct Vertex {
     float m_Weights[MAX_BONE_INFLUENCE];
 };
 
+// Passes that only need gl_Position (depth prepass, shadow maps, ID buffers) draw through the
+// position-only VAO when the mesh has one, fetching 12 bytes per vertex instead of sizeof(Vertex).
+enum RenderPass {
+    COLOR_PASS,
+    DEPTH_PASS,
+    SHADOW_PASS,
+    ID_PASS
+};
+
+// texture type tags, matched against Texture::type and used as the sampler name prefix
+constexpr StringId TEXTURE_DIFFUSE = "texture_diffuse"_sid;
+constexpr StringId TEXTURE_SPECULAR = "texture_specular"_sid;
+constexpr StringId TEXTURE_NORMAL = "texture_normal"_sid;
+constexpr StringId TEXTURE_HEIGHT = "texture_height"_sid;
+
+// Copies share the GL texture, it is deleted once the last mesh/model referencing it is gone.
 struct Texture {
-    unsigned int id;
-    std::string type;
-    std::string path;
+    SharedTexture handle;
+    StringId type;
+    StringId path;
+};
+
+// Describes one vertex attribute living in an already uploaded GL buffer (e.g. a glTF accessor).
+struct VertexAttribute {
+    unsigned int location;
+    SharedBuffer buffer;
+    GLint size;
+    GLenum type;
+    GLboolean normalized;
+    GLsizei stride;
+    size_t offset;
 };
 
 class Mesh {
@@ -42,68 +72,167 @@ public:
     std::vector<Vertex> vertices;
     std::vector<unsigned int> indices;
     std::vector<Texture> textures;
+    // object space bounds, filled at import
+    BoundingBox bounds;
 
-    Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures)
+    Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures, bool positionStream = true)
     {
         this->vertices = vertices;
         this->indices = indices;
         this->textures = textures;
+        for (const Vertex& vertex : vertices)
+            bounds.Expand(vertex.Position);
 
+        setupSamplerNames();
         setupMesh();
+        if (positionStream)
+            setupPositionStream();
     }
 
-    void Draw(Shader& shader)
+    // Zero-copy path: the vertex/index data already lives in GL buffers uploaded by the loader and shared
+    // with its other meshes, attribute pointers follow the source layout as-is and no CPU copy is kept,
+    // so the bounds come from the loader (glTF position accessors carry min/max).
+    Mesh(const std::vector<VertexAttribute>& attributes, SharedBuffer indexBuffer, GLenum indexType, size_t indexOffset,
+         unsigned int indexCount, unsigned int vertexCount, std::vector<Texture> textures, const BoundingBox& bounds = {})
     {
-        // bind appropriate textures
-        unsigned int diffuseNr = 1;
-        unsigned int specularNr = 1;
-        unsigned int normalNr = 1;
-        unsigned int heightNr = 1;
-        for (unsigned int i = 0; i < textures.size(); i++)
-        {
-            glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
-            // retrieve texture number (the N in diffuse_textureN)
-            std::string number;
-            std::string name = textures[i].type;
-            if (name == "texture_diffuse")
-                number = std::to_string(diffuseNr++);
-            else if (name == "texture_specular")
-                number = std::to_string(specularNr++); // transfer unsigned int to string
-            else if (name == "texture_normal")
-                number = std::to_string(normalNr++); // transfer unsigned int to string
-            else if (name == "texture_height")
-                number = std::to_string(heightNr++); // transfer unsigned int to string
+        this->textures = textures;
+        this->bounds = bounds;
+        this->indexCount = indexCount;
+        this->indexType = indexType;
+        this->indexOffset = indexOffset;
+        this->vertexCount = vertexCount;
 
-            // now set the sampler to the correct texture unit
-            glUniform1i(glGetUniformLocation(shader.ID, (name + number).c_str()), i);
-            // and finally bind the texture
-            glBindTexture(GL_TEXTURE_2D, textures[i].id);
+        setupSamplerNames();
+        setupMesh(attributes, std::move(indexBuffer));
+    }
+
+    void Draw(Shader& shader, RenderPass pass = COLOR_PASS)
+    {
+        if (pass != COLOR_PASS)
+        {
+            DrawPositionOnly();
+            return;
         }
 
+        bindTextures(shader);
+
         // draw mesh
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0);
+        glBindVertexArray(vertexArray.Id());
+        glDrawElements(GL_TRIANGLES, indexCount, indexType, (void*)indexOffset);
         glBindVertexArray(0);
 
         // always good practice to set everything back to defaults once configured.
         glActiveTexture(GL_TEXTURE0);
     }
 
+    // Same as Draw, but issues a single instanced call; per-instance data is fetched by the shader (gl_InstanceID).
+    void DrawInstanced(Shader& shader, unsigned int instanceCount)
+    {
+        bindTextures(shader);
+
+        glBindVertexArray(vertexArray.Id());
+        glDrawElementsInstanced(GL_TRIANGLES, indexCount, indexType, (void*)indexOffset, instanceCount);
+        glBindVertexArray(0);
+
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    // No textures, no attributes besides position: falls back to the full VAO if the mesh has no position stream.
+    void DrawPositionOnly()
+    {
+        glBindVertexArray(positionVertexArray ? positionVertexArray.Id() : vertexArray.Id());
+        glDrawElements(GL_TRIANGLES, indexCount, indexType, (void*)indexOffset);
+        glBindVertexArray(0);
+    }
+
+    // GPU-driven draws: commands (DrawElementsIndirectCommand) and their count come from the buffers bound to
+    // GL_DRAW_INDIRECT_BUFFER and GL_PARAMETER_BUFFER, usually written by a culling compute pass.
+    void DrawIndirectCount(Shader& shader, GLintptr commandOffset, GLintptr countOffset, GLsizei maxDrawCount, RenderPass pass = COLOR_PASS)
+    {
+        if (pass == COLOR_PASS)
+            bindTextures(shader);
+
+        glBindVertexArray(pass == COLOR_PASS || !positionVertexArray ? vertexArray.Id() : positionVertexArray.Id());
+        glMultiDrawElementsIndirectCount(GL_TRIANGLES, indexType, (void*)commandOffset, countOffset, maxDrawCount, 0);
+        glBindVertexArray(0);
+
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    unsigned int GetIndexCount() const { return indexCount; }
+    // indirect commands address indices by element, not by byte
+    unsigned int GetFirstIndex() const
+    {
+        size_t indexSize = indexType == GL_UNSIGNED_BYTE ? 1 : indexType == GL_UNSIGNED_SHORT ? 2 : 4;
+        return static_cast<unsigned int>(indexOffset / indexSize);
+    }
+    unsigned int GetVertexCount() const { return vertexCount; }
+
 private:
-    // Render data
-    unsigned int VAO, VBO, EBO;
+    // Render data, pooled and shared between copies of the mesh
+    SharedVertexArray vertexArray;
+    SharedBuffer vertexBuffer, indexBuffer;
+    // buffers of the zero-copy path, kept alive as long as the VAO points into them
+    std::vector<SharedBuffer> attributeBuffers;
+    unsigned int indexCount = 0, vertexCount = 0;
+    GLenum indexType = GL_UNSIGNED_INT;
+    size_t indexOffset = 0;
+    // Optional tightly packed position stream, shares the index buffer with the full VAO
+    SharedVertexArray positionVertexArray;
+    SharedBuffer positionBuffer;
+    // sampler uniform of every texture (texture_diffuse1, texture_specular1, ...), hashed once at load time
+    std::vector<StringId> samplerNames;
+
+    void bindTextures(Shader& shader)
+    {
+        for (unsigned int i = 0; i < textures.size(); i++)
+        {
+            glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
+            // now set the sampler to the correct texture unit
+            shader.setInt(samplerNames[i], i);
+            // and finally bind the texture
+            glBindTexture(GL_TEXTURE_2D, textures[i].handle.Id());
+        }
+    }
+
+    void setupSamplerNames()
+    {
+        // retrieve texture number (the N in diffuse_textureN)
+        unsigned int diffuseNr = 1;
+        unsigned int specularNr = 1;
+        unsigned int normalNr = 1;
+        unsigned int heightNr = 1;
+        samplerNames.clear();
+        samplerNames.reserve(textures.size());
+        for (const Texture& texture : textures)
+        {
+            if (texture.type == TEXTURE_DIFFUSE)
+                samplerNames.push_back(StringId("texture_diffuse" + std::to_string(diffuseNr++)));
+            else if (texture.type == TEXTURE_SPECULAR)
+                samplerNames.push_back(StringId("texture_specular" + std::to_string(specularNr++)));
+            else if (texture.type == TEXTURE_NORMAL)
+                samplerNames.push_back(StringId("texture_normal" + std::to_string(normalNr++)));
+            else if (texture.type == TEXTURE_HEIGHT)
+                samplerNames.push_back(StringId("texture_height" + std::to_string(heightNr++)));
+            else
+                samplerNames.push_back(texture.type); // unknown tags are used as the sampler name as-is
+        }
+    }
 
     void setupMesh()
     {
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        glGenBuffers(1, &EBO);
+        indexCount = static_cast<unsigned int>(indices.size());
+        vertexCount = static_cast<unsigned int>(vertices.size());
+
+        vertexArray = GpuResources::CreateVertexArray();
+        vertexBuffer = GpuResources::CreateBuffer();
+        indexBuffer = GpuResources::CreateBuffer();
 
-        glBindVertexArray(VAO);
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBindVertexArray(vertexArray.Id());
+        glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer.Id());
         glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
 
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer.Id());
         glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
 
         // Vertex Positions
@@ -132,5 +261,61 @@ private:
 
         glBindVertexArray(0);
     }
-};
 
+    void setupPositionStream()
+    {
+        std::vector<glm::vec3> positions;
+        positions.reserve(vertices.size());
+        for (const Vertex& vertex : vertices)
+            positions.push_back(vertex.Position);
+
+        positionVertexArray = GpuResources::CreateVertexArray();
+        positionBuffer = GpuResources::CreateBuffer();
+
+        glBindVertexArray(positionVertexArray.Id());
+        glBindBuffer(GL_ARRAY_BUFFER, positionBuffer.Id());
+        glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(glm::vec3), positions.data(), GL_STATIC_DRAW);
+
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer.Id());
+
+        // Vertex Positions
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+
+        glBindVertexArray(0);
+    }
+
+    void setupMesh(const std::vector<VertexAttribute>& attributes, SharedBuffer sourceIndexBuffer)
+    {
+        indexBuffer = std::move(sourceIndexBuffer);
+
+        vertexArray = GpuResources::CreateVertexArray();
+        glBindVertexArray(vertexArray.Id());
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer.Id());
+        for (const VertexAttribute& attribute : attributes)
+        {
+            attributeBuffers.push_back(attribute.buffer);
+            glBindBuffer(GL_ARRAY_BUFFER, attribute.buffer.Id());
+            glEnableVertexAttribArray(attribute.location);
+            if (attribute.type == GL_FLOAT || attribute.normalized)
+                glVertexAttribPointer(attribute.location, attribute.size, attribute.type, attribute.normalized, attribute.stride, (void*)attribute.offset);
+            else
+                glVertexAttribIPointer(attribute.location, attribute.size, attribute.type, attribute.stride, (void*)attribute.offset);
+        }
+        glBindVertexArray(0);
+
+        // positions are usually their own tightly packed accessor already, so a second VAO is all depth passes need
+        for (const VertexAttribute& attribute : attributes)
+        {
+            if (attribute.location != 0)
+                continue;
+            positionVertexArray = GpuResources::CreateVertexArray();
+            glBindVertexArray(positionVertexArray.Id());
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer.Id());
+            glBindBuffer(GL_ARRAY_BUFFER, attribute.buffer.Id());
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(0, attribute.size, attribute.type, attribute.normalized, attribute.stride, (void*)attribute.offset);
+            glBindVertexArray(0);
+        }
+    }
+};
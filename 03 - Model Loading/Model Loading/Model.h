@@ -12,6 +12,8 @@
 
 #include "Mesh.h"
 #include "Shader.h"
+#include "GltfLoader.h"
+#include "ObjLoader.h"
 
 #include <string>
 #include <fstream>
@@ -19,9 +21,29 @@
 #include <iostream>
 #include <map>
 #include <vector>
+#include <algorithm>
+#include <cctype>
 
 unsigned int TextureFromFile(const char* path, const std::string& directory, bool gamma = false);
 
+struct BoneInfo {
+    // index into the final bone matrices
+    int id;
+    // transforms a vertex from model space into bone space
+    glm::mat4 offset;
+};
+
+inline glm::mat4 AssimpToGlm(const aiMatrix4x4& from)
+{
+    // assimp matrices are row-major, glm is column-major
+    glm::mat4 to;
+    to[0][0] = from.a1; to[1][0] = from.a2; to[2][0] = from.a3; to[3][0] = from.a4;
+    to[0][1] = from.b1; to[1][1] = from.b2; to[2][1] = from.b3; to[3][1] = from.b4;
+    to[0][2] = from.c1; to[1][2] = from.c2; to[2][2] = from.c3; to[3][2] = from.c4;
+    to[0][3] = from.d1; to[1][3] = from.d2; to[2][3] = from.d3; to[3][3] = from.d4;
+    return to;
+}
+
 class Model
 {
 public:
@@ -29,30 +51,58 @@ public:
     std::vector<Texture> textures_loaded;	// stores all the textures loaded so far, optimization to make sure textures aren't loaded more than once.
     std::vector<Mesh> meshes;
     std::string directory;
+    // union of the mesh bounds, object space
+    BoundingBox bounds;
+    // skeleton data, filled while importing skinned meshes
+    std::map<std::string, BoneInfo> boneInfoMap;
+    int boneCounter = 0;
 
-    Model(std::string const &path)
+    // positionStream: also build a position-only vertex stream for depth/shadow/ID passes
+    Model(std::string const &path, bool positionStream = true) : positionStream(positionStream)
     {
         loadModel(path);
+        for (const Mesh& mesh : meshes)
+            bounds.Expand(mesh.bounds);
     }
     
-    void Draw(Shader& shader)
+    void Draw(Shader& shader, RenderPass pass = COLOR_PASS)
     {
         for (unsigned int i = 0; i < meshes.size(); i++)
-            meshes[i].Draw(shader);
+            meshes[i].Draw(shader, pass);
     }
 private:
+    bool positionStream;
 
     void loadModel(std::string const & path)
     {
+        directory = path.substr(0, path.find_last_of('/'));
+
+        // glTF/GLB and OBJ have dedicated loaders, Assimp handles everything else
+        std::string extension = path.substr(path.find_last_of('.') + 1);
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        if (extension == "gltf" || extension == "glb")
+        {
+            if (GltfLoader::Load(path, directory, meshes, textures_loaded))
+                return;
+            std::cout << "GLTF::falling back to Assimp for " << path << std::endl;
+            meshes.clear();
+        }
+        else if (extension == "obj")
+        {
+            if (ObjLoader::Load(path, directory, meshes, textures_loaded, positionStream))
+                return;
+            std::cout << "OBJ::falling back to Assimp for " << path << std::endl;
+            meshes.clear();
+        }
+
         Assimp::Importer import;
-        const aiScene * scene = import.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs);
+        const aiScene * scene = import.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_LimitBoneWeights);
 
         if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
         {
             std::cout << "ERROR::ASSIMP::" << import.GetErrorString() << std::endl;
             return;
         }
-        directory = path.substr(0, path.find_last_of('/'));
 
         processNode(scene->mRootNode, scene);
     }
@@ -80,6 +130,7 @@ private:
         for (unsigned int i = 0; i < mesh->mNumVertices; i++)
         {
             Vertex vertex;
+            setVertexBoneDataToDefault(vertex);
             glm::vec3 vector;
             // positions
             vector.x = mesh->mVertices[i].x;
@@ -115,6 +166,9 @@ private:
             for (unsigned int j = 0; j < face.mNumIndices; j++)
                 indices.push_back(face.mIndices[j]);
         }
+        // bone weights (only present on skinned meshes)
+        extractBoneWeightForVertices(vertices, mesh);
+
         // process materials
         aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
         // we assume a convention for sampler names in the shaders. Each diffuse texture should be named
@@ -125,34 +179,87 @@ private:
         // normal: texture_normalN
 
         // 1. diffuse maps
-        std::vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
+        std::vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, TEXTURE_DIFFUSE);
         textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
         // 2. specular maps
-        std::vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
+        std::vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, TEXTURE_SPECULAR);
         textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
         // 3. normal maps
-        std::vector<Texture> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal");
+        std::vector<Texture> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, TEXTURE_NORMAL);
         textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
         // 4. height maps
-        std::vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
+        std::vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, TEXTURE_HEIGHT);
         textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
 
         // return a mesh object created from the extracted mesh data
-        return Mesh(vertices, indices, textures);
+        return Mesh(vertices, indices, textures, positionStream);
+    }
+
+    void setVertexBoneDataToDefault(Vertex& vertex)
+    {
+        for (int i = 0; i < MAX_BONE_INFLUENCE; i++)
+        {
+            vertex.m_BoneIDs[i] = -1;
+            vertex.m_Weights[i] = 0.0f;
+        }
+    }
+
+    void setVertexBoneData(Vertex& vertex, int boneID, float weight)
+    {
+        for (int i = 0; i < MAX_BONE_INFLUENCE; ++i)
+        {
+            if (vertex.m_BoneIDs[i] < 0)
+            {
+                vertex.m_BoneIDs[i] = boneID;
+                vertex.m_Weights[i] = weight;
+                break;
+            }
+        }
+    }
+
+    void extractBoneWeightForVertices(std::vector<Vertex>& vertices, aiMesh* mesh)
+    {
+        for (unsigned int boneIndex = 0; boneIndex < mesh->mNumBones; ++boneIndex)
+        {
+            int boneID = -1;
+            std::string boneName = mesh->mBones[boneIndex]->mName.C_Str();
+            if (boneInfoMap.find(boneName) == boneInfoMap.end())
+            {
+                BoneInfo newBoneInfo;
+                newBoneInfo.id = boneCounter;
+                newBoneInfo.offset = AssimpToGlm(mesh->mBones[boneIndex]->mOffsetMatrix);
+                boneInfoMap[boneName] = newBoneInfo;
+                boneID = boneCounter;
+                boneCounter++;
+            }
+            else
+            {
+                boneID = boneInfoMap[boneName].id;
+            }
+
+            aiVertexWeight* weights = mesh->mBones[boneIndex]->mWeights;
+            for (unsigned int weightIndex = 0; weightIndex < mesh->mBones[boneIndex]->mNumWeights; ++weightIndex)
+            {
+                unsigned int vertexId = weights[weightIndex].mVertexId;
+                if (vertexId < vertices.size())
+                    setVertexBoneData(vertices[vertexId], boneID, weights[weightIndex].mWeight);
+            }
+        }
     }
 
-    std::vector<Texture> loadMaterialTextures(aiMaterial* mat, aiTextureType type, std::string typeName)
+    std::vector<Texture> loadMaterialTextures(aiMaterial* mat, aiTextureType type, StringId typeName)
     {
         std::vector<Texture> textures;
         for (unsigned int i = 0; i < mat->GetTextureCount(type); i++)
         {
             aiString str;
             mat->GetTexture(type, i, &str);
+            StringId path(std::string_view(str.C_Str(), str.length));
             // check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
             bool skip = false;
             for (unsigned int j = 0; j < textures_loaded.size(); j++)
             {
-                if (std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
+                if (textures_loaded[j].path == path)
                 {
                     textures.push_back(textures_loaded[j]);
                     skip = true; // a texture with the same filepath has already been loaded, continue to next one. (optimization)
@@ -162,9 +269,9 @@ private:
             if (!skip)
             {   // if texture hasn't been loaded already, load it
                 Texture texture;
-                texture.id = TextureFromFile(str.C_Str(), this->directory);
+                texture.handle = SharedTexture::Adopt(TextureFromFile(str.C_Str(), this->directory));
                 texture.type = typeName;
-                texture.path = str.C_Str();
+                texture.path = path;
                 textures.push_back(texture);
                 textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecessary load duplicate textures.
             }
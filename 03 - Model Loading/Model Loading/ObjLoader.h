@@ -0,0 +1,487 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include "MappedFile.h"
+#include "Mesh.h"
+
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include <deque>
+#include <cmath>
+
+// defined in Model.h
+unsigned int TextureFromFile(const char* path, const std::string& directory, bool gamma);
+
+// Dedicated Wavefront OBJ/MTL loader.
+// The file is memory-mapped and cut into one chunk per hardware thread at line boundaries. A first parallel
+// pass only counts v/vt/vn lines so every chunk knows its global attribute base, the second parallel pass
+// parses, triangulates and deduplicates corners into per-material Vertex/index arrays. Merging is a plain
+// concatenation in file order (corners are only duplicated across chunk seams). The output matches what
+// Model builds through Assimp with aiProcess_Triangulate | aiProcess_FlipUVs.
+class ObjLoader
+{
+public:
+    static bool Load(const std::string& path, const std::string& directory, std::vector<Mesh>& meshes,
+                     std::vector<Texture>& texturesLoaded, bool positionStream)
+    {
+        MappedFile file(path);
+        if (!file.IsValid())
+            return false;
+
+        const char* begin = reinterpret_cast<const char*>(file.Data());
+        const char* end = begin + file.Size();
+
+        // 1. split at line boundaries, at least ~1MB per chunk
+        unsigned int threadCount = std::max(1u, std::thread::hardware_concurrency());
+        size_t chunkCount = std::max<size_t>(1, std::min<size_t>(threadCount, file.Size() / (1 << 20)));
+        std::vector<Chunk> chunks(chunkCount);
+        const char* cursor = begin;
+        for (size_t i = 0; i < chunkCount; i++)
+        {
+            chunks[i].begin = cursor;
+            const char* split = (i + 1 == chunkCount) ? end : begin + file.Size() * (i + 1) / chunkCount;
+            split = std::max(split, cursor);
+            while (split < end && *split != '\n')
+                ++split;
+            chunks[i].end = (split < end) ? split + 1 : end;
+            cursor = chunks[i].end;
+        }
+
+        // 2. count attributes per chunk, prefix sum into global bases
+        runParallel(chunks, [](Chunk& chunk) { countAttributes(chunk); });
+        Counts base;
+        for (Chunk& chunk : chunks)
+        {
+            chunk.base = base;
+            base.positions += chunk.counts.positions;
+            base.texCoords += chunk.counts.texCoords;
+            base.normals += chunk.counts.normals;
+        }
+
+        // 3. parse attributes, then faces; faces may reference attributes of any chunk, so share them globally
+        std::vector<glm::vec3> positions(base.positions);
+        std::vector<glm::vec2> texCoords(base.texCoords);
+        std::vector<glm::vec3> normals(base.normals);
+        runParallel(chunks, [&](Chunk& chunk) { parseAttributes(chunk, positions, texCoords, normals); });
+        runParallel(chunks, [&](Chunk& chunk) { parseFaces(chunk, positions, texCoords, normals); });
+
+        // 4. merge per material in order of first use; faces before the first usemtl of a chunk continue the previous chunk's material
+        std::string currentMaterial;
+        std::vector<std::string> materialOrder;
+        std::map<std::string, std::vector<Group*>> groupsByMaterial;
+        std::string mtlLib;
+        for (Chunk& chunk : chunks)
+        {
+            if (mtlLib.empty())
+                mtlLib = chunk.mtlLib;
+            for (Group& group : chunk.groups)
+            {
+                std::string material = group.inherited ? currentMaterial : group.material;
+                if (groupsByMaterial.find(material) == groupsByMaterial.end())
+                    materialOrder.push_back(material);
+                groupsByMaterial[material].push_back(&group);
+            }
+            if (!chunk.lastMaterial.empty())
+                currentMaterial = chunk.lastMaterial;
+        }
+
+        std::map<std::string, std::vector<std::pair<std::string, std::string>>> materials;
+        if (!mtlLib.empty())
+            materials = parseMtl(directory + '/' + mtlLib);
+
+        for (const std::string& material : materialOrder)
+        {
+            std::vector<Vertex> vertices;
+            std::vector<unsigned int> indices;
+            for (Group* group : groupsByMaterial[material])
+            {
+                unsigned int offset = static_cast<unsigned int>(vertices.size());
+                vertices.insert(vertices.end(), group->vertices.begin(), group->vertices.end());
+                for (unsigned int index : group->indices)
+                    indices.push_back(index + offset);
+            }
+            if (indices.empty())
+                continue;
+
+            std::vector<Texture> textures;
+            for (const auto& map : materials[material])
+                textures.push_back(loadTexture(map.second, StringId(map.first), directory, texturesLoaded));
+
+            meshes.push_back(Mesh(std::move(vertices), std::move(indices), textures, positionStream));
+        }
+        return true;
+    }
+
+private:
+    struct Counts {
+        size_t positions = 0;
+        size_t texCoords = 0;
+        size_t normals = 0;
+    };
+
+    struct Corner {
+        int64_t position, texCoord, normal;
+        bool operator==(const Corner& other) const
+        {
+            return position == other.position && texCoord == other.texCoord && normal == other.normal;
+        }
+    };
+
+    struct CornerHash {
+        size_t operator()(const Corner& corner) const
+        {
+            uint64_t h = static_cast<uint64_t>(corner.position) * 0x9E3779B97F4A7C15ull;
+            h ^= static_cast<uint64_t>(corner.texCoord) * 0xC2B2AE3D27D4EB4Full + (h << 6) + (h >> 2);
+            h ^= static_cast<uint64_t>(corner.normal) * 0x165667B19E3779F9ull + (h << 6) + (h >> 2);
+            return static_cast<size_t>(h);
+        }
+    };
+
+    // faces of one chunk that share a material
+    struct Group {
+        std::string material;
+        // true for faces before the chunk's first usemtl
+        bool inherited = false;
+        std::vector<Vertex> vertices;
+        std::vector<unsigned int> indices;
+        std::unordered_map<Corner, unsigned int, CornerHash> unique;
+    };
+
+    struct Chunk {
+        const char* begin = nullptr;
+        const char* end = nullptr;
+        Counts counts;
+        Counts base;
+        // deque: groups are referenced by pointer while more are appended
+        std::deque<Group> groups;
+        std::string lastMaterial;
+        std::string mtlLib;
+    };
+
+    template <typename Function>
+    static void runParallel(std::vector<Chunk>& chunks, Function function)
+    {
+        std::vector<std::thread> workers;
+        for (size_t i = 1; i < chunks.size(); i++)
+            workers.emplace_back([&chunks, &function, i]() { function(chunks[i]); });
+        function(chunks[0]);
+        for (std::thread& worker : workers)
+            worker.join();
+    }
+
+    static const char* skipSpaces(const char* c, const char* end)
+    {
+        while (c < end && (*c == ' ' || *c == '\t'))
+            ++c;
+        return c;
+    }
+
+    static const char* nextLine(const char* c, const char* end)
+    {
+        const char* newline = static_cast<const char*>(std::memchr(c, '\n', end - c));
+        return newline ? newline + 1 : end;
+    }
+
+    static const char* lineEnd(const char* c, const char* end)
+    {
+        const char* e = static_cast<const char*>(std::memchr(c, '\n', end - c));
+        e = e ? e : end;
+        while (e > c && (e[-1] == '\r' || e[-1] == ' ' || e[-1] == '\t'))
+            --e;
+        return e;
+    }
+
+    // locale independent and much cheaper than strtof for the plain decimals OBJ exporters write
+    static const char* parseFloat(const char* c, const char* end, float& out)
+    {
+        c = skipSpaces(c, end);
+        bool negative = false;
+        if (c < end && (*c == '-' || *c == '+'))
+            negative = (*c++ == '-');
+
+        double value = 0.0;
+        while (c < end && *c >= '0' && *c <= '9')
+            value = value * 10.0 + (*c++ - '0');
+        if (c < end && *c == '.')
+        {
+            ++c;
+            double scale = 0.1;
+            while (c < end && *c >= '0' && *c <= '9')
+            {
+                value += (*c++ - '0') * scale;
+                scale *= 0.1;
+            }
+        }
+        if (c < end && (*c == 'e' || *c == 'E'))
+        {
+            ++c;
+            bool negativeExponent = false;
+            if (c < end && (*c == '-' || *c == '+'))
+                negativeExponent = (*c++ == '-');
+            int exponent = 0;
+            while (c < end && *c >= '0' && *c <= '9')
+                exponent = exponent * 10 + (*c++ - '0');
+            value *= std::pow(10.0, negativeExponent ? -exponent : exponent);
+        }
+        out = static_cast<float>(negative ? -value : value);
+        return c;
+    }
+
+    static const char* parseInt(const char* c, const char* end, int64_t& out)
+    {
+        bool negative = false;
+        if (c < end && (*c == '-' || *c == '+'))
+            negative = (*c++ == '-');
+        int64_t value = 0;
+        while (c < end && *c >= '0' && *c <= '9')
+            value = value * 10 + (*c++ - '0');
+        out = negative ? -value : value;
+        return c;
+    }
+
+    static void countAttributes(Chunk& chunk)
+    {
+        for (const char* c = chunk.begin; c < chunk.end; c = nextLine(c, chunk.end))
+        {
+            c = skipSpaces(c, chunk.end);
+            if (chunk.end - c < 2 || c[0] != 'v')
+                continue;
+            if (c[1] == ' ' || c[1] == '\t')
+                chunk.counts.positions++;
+            else if (c[1] == 't')
+                chunk.counts.texCoords++;
+            else if (c[1] == 'n')
+                chunk.counts.normals++;
+        }
+    }
+
+    static void parseAttributes(Chunk& chunk, std::vector<glm::vec3>& positions, std::vector<glm::vec2>& texCoords, std::vector<glm::vec3>& normals)
+    {
+        size_t p = chunk.base.positions, t = chunk.base.texCoords, n = chunk.base.normals;
+        for (const char* c = chunk.begin; c < chunk.end; c = nextLine(c, chunk.end))
+        {
+            c = skipSpaces(c, chunk.end);
+            if (chunk.end - c < 2 || c[0] != 'v')
+                continue;
+            if (c[1] == ' ' || c[1] == '\t')
+            {
+                glm::vec3& v = positions[p++];
+                c = parseFloat(parseFloat(parseFloat(c + 1, chunk.end, v.x), chunk.end, v.y), chunk.end, v.z);
+            }
+            else if (c[1] == 't')
+            {
+                glm::vec2& v = texCoords[t++];
+                c = parseFloat(parseFloat(c + 2, chunk.end, v.x), chunk.end, v.y);
+                // same convention as aiProcess_FlipUVs
+                v.y = 1.0f - v.y;
+            }
+            else if (c[1] == 'n')
+            {
+                glm::vec3& v = normals[n++];
+                c = parseFloat(parseFloat(parseFloat(c + 2, chunk.end, v.x), chunk.end, v.y), chunk.end, v.z);
+            }
+        }
+    }
+
+    static void parseFaces(Chunk& chunk, const std::vector<glm::vec3>& positions, const std::vector<glm::vec2>& texCoords, const std::vector<glm::vec3>& normals)
+    {
+        // running attribute counts, needed to resolve negative (relative) indices
+        Counts seen = chunk.base;
+        Group* group = nullptr;
+        std::vector<unsigned int> polygon;
+
+        for (const char* c = chunk.begin; c < chunk.end; c = nextLine(c, chunk.end))
+        {
+            c = skipSpaces(c, chunk.end);
+            if (c >= chunk.end)
+                continue;
+            const char* e = lineEnd(c, chunk.end);
+
+            if (c[0] == 'v' && e - c >= 2)
+            {
+                if (c[1] == ' ' || c[1] == '\t')
+                    seen.positions++;
+                else if (c[1] == 't')
+                    seen.texCoords++;
+                else if (c[1] == 'n')
+                    seen.normals++;
+            }
+            else if (c[0] == 'f' && e - c >= 2 && (c[1] == ' ' || c[1] == '\t'))
+            {
+                if (!group)
+                {
+                    chunk.groups.emplace_back();
+                    chunk.groups.back().inherited = true;
+                    group = &chunk.groups.back();
+                }
+
+                polygon.clear();
+                const char* f = c + 1;
+                while (true)
+                {
+                    f = skipSpaces(f, e);
+                    if (f >= e)
+                        break;
+                    int64_t v = 0, vt = 0, vn = 0;
+                    f = parseInt(f, e, v);
+                    if (f < e && *f == '/')
+                    {
+                        ++f;
+                        if (f < e && *f != '/')
+                            f = parseInt(f, e, vt);
+                        if (f < e && *f == '/')
+                            f = parseInt(f + 1, e, vn);
+                    }
+                    // skip anything unexpected up to the next separator
+                    while (f < e && *f != ' ' && *f != '\t')
+                        ++f;
+
+                    Corner corner;
+                    corner.position = resolve(v, seen.positions);
+                    corner.texCoord = resolve(vt, seen.texCoords);
+                    corner.normal = resolve(vn, seen.normals);
+                    if (corner.position < 0 || corner.position >= static_cast<int64_t>(positions.size()))
+                        continue;
+                    polygon.push_back(addCorner(*group, corner, positions, texCoords, normals));
+                }
+
+                // fan triangulation, like aiProcess_Triangulate for convex polygons
+                for (size_t i = 2; i < polygon.size(); i++)
+                {
+                    group->indices.push_back(polygon[0]);
+                    group->indices.push_back(polygon[i - 1]);
+                    group->indices.push_back(polygon[i]);
+                }
+            }
+            else if (e - c > 7 && std::strncmp(c, "usemtl", 6) == 0)
+            {
+                std::string material(skipSpaces(c + 6, e), e);
+                chunk.groups.emplace_back();
+                chunk.groups.back().material = material;
+                group = &chunk.groups.back();
+                chunk.lastMaterial = material;
+            }
+            else if (e - c > 7 && std::strncmp(c, "mtllib", 6) == 0 && chunk.mtlLib.empty())
+            {
+                chunk.mtlLib = std::string(skipSpaces(c + 6, e), e);
+            }
+        }
+
+        // the dedup tables are only needed while parsing
+        for (Group& g : chunk.groups)
+            std::unordered_map<Corner, unsigned int, CornerHash>().swap(g.unique);
+    }
+
+    // OBJ indices are 1-based, negative ones count back from the last attribute seen so far; -1 = absent
+    static int64_t resolve(int64_t index, size_t seen)
+    {
+        if (index > 0)
+            return index - 1;
+        if (index < 0)
+            return static_cast<int64_t>(seen) + index;
+        return -1;
+    }
+
+    static unsigned int addCorner(Group& group, const Corner& corner, const std::vector<glm::vec3>& positions,
+                                  const std::vector<glm::vec2>& texCoords, const std::vector<glm::vec3>& normals)
+    {
+        auto found = group.unique.find(corner);
+        if (found != group.unique.end())
+            return found->second;
+
+        Vertex vertex;
+        vertex.Position = positions[corner.position];
+        vertex.Normal = (corner.normal >= 0 && corner.normal < static_cast<int64_t>(normals.size())) ? normals[corner.normal] : glm::vec3(0.0f);
+        vertex.TexCoords = (corner.texCoord >= 0 && corner.texCoord < static_cast<int64_t>(texCoords.size())) ? texCoords[corner.texCoord] : glm::vec2(0.0f);
+        vertex.Tangent = glm::vec3(0.0f);
+        vertex.Bitangent = glm::vec3(0.0f);
+        for (int i = 0; i < MAX_BONE_INFLUENCE; i++)
+        {
+            vertex.m_BoneIDs[i] = -1;
+            vertex.m_Weights[i] = 0.0f;
+        }
+
+        unsigned int index = static_cast<unsigned int>(group.vertices.size());
+        group.vertices.push_back(vertex);
+        group.unique.emplace(corner, index);
+        return index;
+    }
+
+    // material name -> (texture type, file) using the same type names as Model's Assimp path
+    static std::map<std::string, std::vector<std::pair<std::string, std::string>>> parseMtl(const std::string& path)
+    {
+        std::map<std::string, std::vector<std::pair<std::string, std::string>>> materials;
+        std::ifstream file(path);
+        if (!file)
+        {
+            std::cout << "OBJ::cannot open material library " << path << std::endl;
+            return materials;
+        }
+
+        static const std::pair<const char*, const char*> maps[] = {
+            { "map_Kd", "texture_diffuse" }, { "map_Ks", "texture_specular" },
+            { "map_Bump", "texture_normal" }, { "map_bump", "texture_normal" }, { "bump", "texture_normal" },
+            { "map_Ka", "texture_height" }
+        };
+
+        std::string line, current;
+        while (std::getline(file, line))
+        {
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+            std::istringstream tokens(line);
+            std::string keyword;
+            tokens >> keyword;
+            if (keyword == "newmtl")
+            {
+                tokens >> current;
+                continue;
+            }
+            for (const auto& map : maps)
+            {
+                if (keyword != map.first)
+                    continue;
+                // options such as "-bm 1.0" may precede the file name, which is the last token
+                std::string token, fileName;
+                while (tokens >> token)
+                    fileName = token;
+                if (!fileName.empty())
+                    materials[current].push_back({ map.second, fileName });
+            }
+        }
+        return materials;
+    }
+
+    static Texture loadTexture(const std::string& fileName, StringId typeName, const std::string& directory, std::vector<Texture>& texturesLoaded)
+    {
+        StringId path(fileName);
+        for (const Texture& loaded : texturesLoaded)
+        {
+            if (loaded.path == path)
+            {
+                Texture texture = loaded;
+                texture.type = typeName;
+                return texture;
+            }
+        }
+
+        Texture texture;
+        texture.handle = SharedTexture::Adopt(TextureFromFile(fileName.c_str(), directory, false));
+        texture.type = typeName;
+        texture.path = path;
+        texturesLoaded.push_back(texture);
+        return texture;
+    }
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "GpuResources.h"
+#include "Shader.h"
+#include "SoftwareOcclusion.h"
+
+// Shows an OcclusionRasterizer's depth buffer in a corner of the screen: uncovered pixels are dark red,
+// occluders grey by distance
+class OcclusionDebugView {
+public:
+    OcclusionDebugView() : shader("occlusion_debug.vs", "occlusion_debug.fs")
+    {
+        texture = GpuResources::CreateTexture();
+        emptyVertexArray = GpuResources::CreateVertexArray();
+    }
+
+    // x, y, width, height: the viewport to draw into, in framebuffer pixels
+    void Draw(const OcclusionRasterizer& rasterizer, float nearPlane, float farPlane, int x, int y, int width, int height)
+    {
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, texture.Id());
+        if (rasterizer.Width() != textureWidth || rasterizer.Height() != textureHeight)
+        {
+            textureWidth = rasterizer.Width();
+            textureHeight = rasterizer.Height();
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, textureWidth, textureHeight, 0, GL_RED, GL_FLOAT, rasterizer.Depth().data());
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        }
+        else
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, textureWidth, textureHeight, GL_RED, GL_FLOAT, rasterizer.Depth().data());
+
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        glViewport(x, y, width, height);
+        glDisable(GL_DEPTH_TEST);
+
+        shader.use();
+        shader.setInt("occlusionDepth", 0);
+        shader.setFloat("nearPlane", nearPlane);
+        shader.setFloat("farPlane", farPlane);
+        glBindVertexArray(emptyVertexArray.Id());
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        glBindVertexArray(0);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        glEnable(GL_DEPTH_TEST);
+        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    }
+
+private:
+    Shader shader;
+    SharedTexture texture;
+    SharedVertexArray emptyVertexArray;
+    int textureWidth = 0, textureHeight = 0;
+};
@@ -0,0 +1,248 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "Bounds.h"
+#include "GpuResources.h"
+#include "Shader.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// Hardware occlusion culling with temporal coherence, after CHC++ (flat, without the hierarchy).
+// Every object keeps the visibility its last query returned, and results are only ever collected when the GPU
+// already has them, so the CPU never waits:
+//   - objects visible last frame are drawn normally; every requeryInterval frames (staggered per object) the
+//     draw itself is wrapped in a query, which costs nothing extra
+//   - objects hidden last frame are queried with their bounding box, batchSize boxes per query, after the
+//     visible ones have filled the depth buffer; their real draws follow under conditional rendering on that
+//     query, so an object that comes into view is drawn the same frame without the CPU reading anything back
+// A batch query that passes marks all its members visible; the ones that are not get their own query on their
+// next requeryInterval turn and drop back out. A hidden object whose box query has not come back yet is drawn
+// conditionally on that query again, so it is never missing for a frame just because the GPU is behind.
+class OcclusionQueries {
+public:
+    struct Stats {
+        unsigned int visibleDrawn = 0;
+        unsigned int objectQueries = 0;
+        unsigned int batchQueries = 0;
+        unsigned int conditionalDraws = 0;
+        // results that were not back yet when collected, carried over instead of waited on
+        unsigned int resultsNotReady = 0;
+    };
+
+    int batchSize;
+    int requeryInterval;
+
+    // boxes: world space bounds of every object, indexed like the draws
+    OcclusionQueries(const std::vector<BoundingBox>& boxes, int batchSize = 8, int requeryInterval = 5)
+        : batchSize(batchSize), requeryInterval(requeryInterval)
+    {
+        objects.resize(boxes.size());
+        for (size_t i = 0; i < boxes.size(); i++)
+        {
+            // a little larger than the bounds, the box must not lose to the object's own depth
+            glm::vec3 extents = boxes[i].Extents() * 1.01f + glm::vec3(0.01f);
+            objects[i].box = { boxes[i].Center() - extents, boxes[i].Center() + extents };
+            objects[i].boxTransform = glm::scale(glm::translate(glm::mat4(1.0f), boxes[i].Center()), extents);
+        }
+        createUnitCube();
+    }
+
+    OcclusionQueries(const OcclusionQueries&) = delete;
+    OcclusionQueries& operator=(const OcclusionQueries&) = delete;
+
+    // Takes in every result that has arrived since last frame, call once before drawing
+    void BeginFrame()
+    {
+        frame++;
+        stats = Stats();
+        size_t kept = 0;
+        for (PendingQuery& pending : pendingQueries)
+        {
+            GLuint available = GL_FALSE;
+            glGetQueryObjectuiv(pending.query.Id(), GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available)
+            {
+                stats.resultsNotReady++;
+                // a self move would empty the object list
+                if (&pendingQueries[kept] != &pending)
+                    pendingQueries[kept] = std::move(pending);
+                kept++;
+                continue;
+            }
+            GLuint anySamples = GL_FALSE;
+            glGetQueryObjectuiv(pending.query.Id(), GL_QUERY_RESULT, &anySamples);
+            for (uint32_t index : pending.objects)
+            {
+                objects[index].visible = anySamples != GL_FALSE;
+                objects[index].pending = false;
+                objects[index].pendingQuery = 0;
+            }
+            freeQueries.push_back(std::move(pending.query));
+        }
+        pendingQueries.resize(kept);
+    }
+
+    // Visibility from the last result; objects with a query in flight keep the state they had
+    bool WasVisible(uint32_t index, const glm::vec3& cameraPosition) const
+    {
+        return objects[index].visible || contains(objects[index].box, cameraPosition);
+    }
+
+    // Draws an object that was visible, wrapping the draw in a query when it is due for one
+    template <typename DrawFunction>
+    void DrawVisible(uint32_t index, const DrawFunction& draw)
+    {
+        stats.visibleDrawn++;
+        ObjectState& object = objects[index];
+        if (object.pending || (frame + index) % requeryInterval != 0)
+        {
+            draw(index);
+            return;
+        }
+        SharedQuery query = acquireQuery();
+        glBeginQuery(GL_ANY_SAMPLES_PASSED_CONSERVATIVE, query.Id());
+        draw(index);
+        glEndQuery(GL_ANY_SAMPLES_PASSED_CONSERVATIVE);
+        object.pending = true;
+        object.pendingQuery = query.Id();
+        pendingQueries.push_back({ std::move(query), { index } });
+        stats.objectQueries++;
+    }
+
+    // Queries the boxes of objects that were hidden, then draws them conditionally on those queries.
+    // boxShader only needs a "model" matrix (depth.vs); drawShader is made current again for draw.
+    template <typename DrawFunction>
+    void DrawHidden(const std::vector<uint32_t>& hidden, Shader& boxShader, Shader& drawShader, const DrawFunction& draw)
+    {
+        // objects still waiting on an earlier result get no new query, but are drawn on the one in flight
+        batches.clear();
+        stillPending.clear();
+        for (uint32_t index : hidden)
+        {
+            if (objects[index].pending)
+            {
+                stillPending.push_back(index);
+                continue;
+            }
+            if (batches.empty() || batches.back().objects.size() >= size_t(std::max(batchSize, 1)))
+                batches.push_back({ acquireQuery(), {} });
+            batches.back().objects.push_back(index);
+            objects[index].pending = true;
+            objects[index].pendingQuery = batches.back().query.Id();
+        }
+        if (batches.empty() && stillPending.empty())
+            return;
+
+        // all box queries first, so the state is switched once
+        GLboolean depthMask;
+        glGetBooleanv(GL_DEPTH_WRITEMASK, &depthMask);
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        glDepthMask(GL_FALSE);
+        boxShader.use();
+        glBindVertexArray(cubeVertexArray.Id());
+        for (const PendingQuery& batch : batches)
+        {
+            glBeginQuery(GL_ANY_SAMPLES_PASSED_CONSERVATIVE, batch.query.Id());
+            for (uint32_t index : batch.objects)
+            {
+                boxShader.setMat4("model", objects[index].boxTransform);
+                glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_BYTE, 0);
+            }
+            glEndQuery(GL_ANY_SAMPLES_PASSED_CONSERVATIVE);
+        }
+        glBindVertexArray(0);
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        glDepthMask(depthMask);
+
+        // the GPU skips these unless the batch's boxes passed; NO_WAIT draws anyway if the result is late
+        drawShader.use();
+        for (const PendingQuery& batch : batches)
+        {
+            glBeginConditionalRender(batch.query.Id(), GL_QUERY_NO_WAIT);
+            for (uint32_t index : batch.objects)
+                draw(index);
+            glEndConditionalRender();
+            stats.conditionalDraws += static_cast<unsigned int>(batch.objects.size());
+        }
+        for (uint32_t index : stillPending)
+        {
+            glBeginConditionalRender(objects[index].pendingQuery, GL_QUERY_NO_WAIT);
+            draw(index);
+            glEndConditionalRender();
+        }
+        stats.conditionalDraws += static_cast<unsigned int>(stillPending.size());
+        stats.batchQueries += static_cast<unsigned int>(batches.size());
+        for (PendingQuery& batch : batches)
+            pendingQueries.push_back(std::move(batch));
+    }
+
+    const Stats& GetStats() const { return stats; }
+
+private:
+    struct ObjectState {
+        BoundingBox box;
+        glm::mat4 boxTransform;
+        bool visible = true;
+        bool pending = false;
+        // the query in flight while pending, owned by its PendingQuery
+        GLuint pendingQuery = 0;
+    };
+
+    struct PendingQuery {
+        SharedQuery query;
+        std::vector<uint32_t> objects;
+    };
+
+    std::vector<ObjectState> objects;
+    std::vector<PendingQuery> pendingQueries, batches;
+    // pooled, so nothing is deleted by hand when the queries outlive the context
+    std::vector<SharedQuery> freeQueries;
+    std::vector<uint32_t> stillPending;
+    SharedVertexArray cubeVertexArray;
+    SharedBuffer cubeVertexBuffer, cubeIndexBuffer;
+    unsigned int frame = 0;
+    Stats stats;
+
+    static bool contains(const BoundingBox& box, const glm::vec3& point)
+    {
+        return glm::all(glm::greaterThanEqual(point, box.min)) && glm::all(glm::lessThanEqual(point, box.max));
+    }
+
+    SharedQuery acquireQuery()
+    {
+        if (freeQueries.empty())
+            return GpuResources::CreateQuery();
+        SharedQuery query = std::move(freeQueries.back());
+        freeQueries.pop_back();
+        return query;
+    }
+
+    // [-1, 1] cube, position only like Mesh's position stream so depth.vs can draw it
+    void createUnitCube()
+    {
+        const glm::vec3 corners[8] = {
+            { -1.0f, -1.0f, -1.0f }, { 1.0f, -1.0f, -1.0f }, { 1.0f, 1.0f, -1.0f }, { -1.0f, 1.0f, -1.0f },
+            { -1.0f, -1.0f, 1.0f }, { 1.0f, -1.0f, 1.0f }, { 1.0f, 1.0f, 1.0f }, { -1.0f, 1.0f, 1.0f }
+        };
+        const GLubyte indices[36] = {
+            0, 2, 1, 0, 3, 2,   4, 5, 6, 4, 6, 7,   0, 1, 5, 0, 5, 4,
+            3, 6, 2, 3, 7, 6,   0, 4, 7, 0, 7, 3,   1, 2, 6, 1, 6, 5
+        };
+        cubeVertexArray = GpuResources::CreateVertexArray();
+        cubeVertexBuffer = GpuResources::CreateBuffer();
+        cubeIndexBuffer = GpuResources::CreateBuffer();
+        glBindVertexArray(cubeVertexArray.Id());
+        glBindBuffer(GL_ARRAY_BUFFER, cubeVertexBuffer.Id());
+        glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, cubeIndexBuffer.Id());
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+        glBindVertexArray(0);
+    }
+};
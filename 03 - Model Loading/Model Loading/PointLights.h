@@ -0,0 +1,114 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "GpuResources.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// Shader storage binding of the point lights, after the GPU culling ones
+#define POINT_LIGHT_BINDING 10
+// overflow counters of every light list, see LightListOverflow
+#define LIGHT_OVERFLOW_BINDING 16
+
+// std430 mirror of PointLight in shader.fs, transparent.fs and deferred_lighting.cs
+struct PointLightData {
+    // w = radius of influence, see PointLightData::Radius
+    glm::vec4 position;
+    glm::vec4 ambient;
+    glm::vec4 diffuse;
+    glm::vec4 specular;
+    // x = constant, y = linear, z = quadratic
+    glm::vec4 attenuation;
+
+    // Distance at which the brightest channel, attenuated, drops under threshold. The shaders fade the light
+    // out towards it, so lighting can skip the light anywhere beyond.
+    static float Radius(const PointLightData& light, float threshold = 1.0f / 64.0f)
+    {
+        // ambient is attenuated like the other terms, so it counts towards the reach too
+        glm::vec3 peak = glm::max(glm::max(glm::vec3(light.diffuse), glm::vec3(light.specular)), glm::vec3(light.ambient));
+        float intensity = std::max({ peak.r, peak.g, peak.b });
+        float c = light.attenuation.x - intensity / threshold;
+        // a light that never reaches the threshold (dark, or dimmer than it even at distance 0) lights nothing
+        if (intensity <= 0.0f || c >= 0.0f)
+            return 0.0f;
+        float b = light.attenuation.y;
+        float a = light.attenuation.z;
+        if (a <= 0.0f)
+            return b > 0.0f ? -c / b : 1.0e6f;
+        return (-b + std::sqrt(b * b - 4.0f * a * c)) / (2.0f * a);
+    }
+};
+
+static_assert(sizeof(PointLightData) == 80, "PointLightData must match the std430 PointLight struct");
+
+// std430 mirror of the LightOverflow block. The cluster lists (cluster_assign.cs) and the tile lists
+// (deferred_lighting.cs, visibility_resolve.cs) have a fixed size and drop the lights past it; these count how
+// many lists ran full and how many lights they lost, so truncated lighting shows in the report.
+struct LightListOverflow {
+    GLuint clusters = 0;
+    GLuint clusterLights = 0;
+    GLuint tiles = 0;
+    GLuint tileLights = 0;
+};
+
+// Every point light of the scene in one shader storage buffer, read by the forward shaders and the deferred
+// lighting pass alike; the Lights block only carries the count.
+class PointLightBuffer {
+public:
+    // Replaces every light, the buffer is only reallocated when it grows
+    void Upload(const std::vector<PointLightData>& lights)
+    {
+        count = static_cast<GLuint>(lights.size());
+        if (!buffer)
+            buffer = GpuResources::CreateBuffer();
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer.Id());
+        if (count > capacity)
+        {
+            glBufferData(GL_SHADER_STORAGE_BUFFER, lights.size() * sizeof(PointLightData), lights.data(), GL_DYNAMIC_DRAW);
+            capacity = count;
+        }
+        else if (count > 0)
+            glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, lights.size() * sizeof(PointLightData), lights.data());
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, POINT_LIGHT_BINDING, buffer.Id());
+    }
+
+    GLuint Count() const { return count; }
+
+    // Zeroes the overflow counters and binds them, once per frame before any light list is built
+    void ResetOverflow()
+    {
+        if (!overflowBuffer)
+        {
+            overflowBuffer = GpuResources::CreateBuffer();
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, overflowBuffer.Id());
+            glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(LightListOverflow), nullptr, GL_DYNAMIC_READ);
+        }
+        else
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, overflowBuffer.Id());
+        glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LIGHT_OVERFLOW_BINDING, overflowBuffer.Id());
+    }
+
+    // This frame's overflow so far. Waits for the GPU, only meant for the periodic report.
+    LightListOverflow ReadOverflow() const
+    {
+        LightListOverflow overflow;
+        if (!overflowBuffer)
+            return overflow;
+        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, overflowBuffer.Id());
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(LightListOverflow), &overflow);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        return overflow;
+    }
+
+private:
+    SharedBuffer buffer, overflowBuffer;
+    GLuint count = 0, capacity = 0;
+};
@@ -6,13 +6,365 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+
+#include "StringId.h"
+#include "GpuResources.h"
+
+// Linked programs are stored here by glGetProgramBinary and reloaded on the next launch
+#define SHADER_CACHE_DIRECTORY "shader_cache"
+
+// GL_KHR_parallel_shader_compile is not part of the generated glad loader
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+typedef void (*PFNMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+
+// Blocking compiles finish inside the constructor, async ones draw with the fallback program until they link
+enum ShaderCompileMode {
+	COMPILE_BLOCKING,
+	COMPILE_ASYNC
+};
+
+// Location of an active uniform, resolved once after linking. An invalid handle (-1) is ignored by glUniform*.
+struct UniformHandle
+{
+	GLint location = -1;
+	bool IsValid() const { return location >= 0; }
+};
+
+// Open addressing table over every active uniform name of one program, filled once after linking.
+// Hash 0 marks an empty slot; names live back to back in one string so the table itself stays flat.
+class UniformTable
+{
+public:
+	void Reflect(GLuint program)
+	{
+		GLint count = 0, maxLength = 0;
+		glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+		glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+		// arrays of basic types report only "name[0]", every element and the bare name get a slot too
+		std::vector<std::pair<std::string, GLint>> entries;
+		std::vector<GLchar> buffer(maxLength > 0 ? maxLength : 1);
+		for (GLint i = 0; i < count; i++)
+		{
+			GLsizei length = 0;
+			GLint size = 0;
+			GLenum type = 0;
+			glGetActiveUniform(program, i, maxLength, &length, &size, &type, buffer.data());
+			std::string name(buffer.data(), length);
+			GLint location = glGetUniformLocation(program, name.c_str());
+			// uniform block members have no location
+			if (location < 0)
+				continue;
+			entries.emplace_back(name, location);
+			if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0)
+			{
+				std::string base = name.substr(0, name.size() - 3);
+				entries.emplace_back(base, location);
+				for (GLint element = 1; element < size; element++)
+				{
+					std::string elementName = base + "[" + std::to_string(element) + "]";
+					entries.emplace_back(elementName, glGetUniformLocation(program, elementName.c_str()));
+				}
+			}
+		}
+
+		// keep the load factor at or under one half
+		size_t capacity = 16;
+		while (capacity < entries.size() * 2)
+			capacity *= 2;
+		slots.assign(capacity, Slot());
+		names.clear();
+		for (const auto& entry : entries)
+		{
+			uint64_t hash = HashString(entry.first);
+			size_t i = hash & (capacity - 1);
+			while (slots[i].hash != 0)
+				i = (i + 1) & (capacity - 1);
+			slots[i] = { hash, static_cast<uint32_t>(names.size()), static_cast<uint32_t>(entry.first.size()), entry.second };
+			names += entry.first;
+		}
+	}
+
+	UniformHandle Find(std::string_view name) const
+	{
+		if (slots.empty())
+			return {};
+
+		uint64_t hash = HashString(name);
+		size_t mask = slots.size() - 1;
+		for (size_t i = hash & mask; ; i = (i + 1) & mask)
+		{
+			const Slot& slot = slots[i];
+			if (slot.hash == 0)
+				return {};
+			if (slot.hash == hash && std::string_view(names).substr(slot.nameOffset, slot.nameLength) == name)
+				return { slot.location };
+		}
+	}
+
+	// the 64-bit hash alone identifies the slot
+	UniformHandle Find(StringId name) const
+	{
+		if (slots.empty())
+			return {};
+
+		size_t mask = slots.size() - 1;
+		for (size_t i = name.value & mask; ; i = (i + 1) & mask)
+		{
+			const Slot& slot = slots[i];
+			if (slot.hash == 0)
+				return {};
+			if (slot.hash == name.value)
+				return { slot.location };
+		}
+	}
+
+private:
+	struct Slot
+	{
+		uint64_t hash = 0;
+		uint32_t nameOffset = 0;
+		uint32_t nameLength = 0;
+		GLint location = -1;
+	};
+	std::vector<Slot> slots;
+	std::string names;
+};
 
 class Shader
 {
 public:
-	unsigned int ID;
+	// Program used for drawing, 0 until the first compile has linked
+	unsigned int ID = 0;
+
+	// defines are injected after the #version line of both stages, e.g. { "POINT_LIGHTS 4" }
+	Shader(const char* vertexPath, const char* fragmentPath, const std::vector<std::string>& defines = {}, ShaderCompileMode mode = COMPILE_BLOCKING)
+		: vertexPath(vertexPath), fragmentPath(fragmentPath), defines(defines)
+	{
+		submit();
+		if (mode == COMPILE_BLOCKING)
+			finishPending();
+	}
+
+	// Non-blocking when the driver supports parallel compilation, otherwise the first poll waits for the link
+	bool IsReady()
+	{
+		poll();
+		return ID != 0;
+	}
+
+	bool IsCompiling() const
+	{
+		return pending.program != 0;
+	}
+
+	// Re-reads the sources and compiles in the background, the current program keeps drawing until
+	// the new one has linked and is swapped in. Uniform handles must be re-resolved after the swap;
+	// uniform values are carried over, so values set once after construction survive the reload.
+	void Reload()
+	{
+		discardPending();
+		submit();
+	}
+
+	// Cheap program drawn in place of shaders that are still compiling
+	static Shader& Fallback()
+	{
+		static Shader fallback("fallback.vs", "fallback.fs");
+		return fallback;
+	}
+
+	static bool ParallelCompileSupported()
+	{
+		static const bool supported = [] {
+			GLint count = 0;
+			glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+			for (GLint i = 0; i < count; i++)
+			{
+				std::string_view extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+				if (extension == "GL_KHR_parallel_shader_compile" || extension == "GL_ARB_parallel_shader_compile")
+				{
+					// let the driver use as many compiler threads as it likes
+					auto maxThreads = reinterpret_cast<PFNMAXSHADERCOMPILERTHREADSKHRPROC>(glfwGetProcAddress("glMaxShaderCompilerThreadsKHR"));
+					if (!maxThreads)
+						maxThreads = reinterpret_cast<PFNMAXSHADERCOMPILERTHREADSKHRPROC>(glfwGetProcAddress("glMaxShaderCompilerThreadsARB"));
+					if (maxThreads)
+						maxThreads(0xFFFFFFFFu);
+					return true;
+				}
+			}
+			return false;
+		}();
+		return supported;
+	}
+
+	void use()
+	{
+		poll();
+		glUseProgram(ID ? ID : Fallback().ID);
+	}
+
+	// Resolve a handle once and keep it, setters taking handles do no hashing and no GL query
+	UniformHandle getUniform(std::string_view name) const
+	{
+		// while compiling, names resolve against the fallback program that is actually bound
+		if (!ID && this != &Fallback())
+			return Fallback().getUniform(name);
+		return uniforms.Find(name);
+	}
+
+	// Pre-hashed names skip hashing and the string compare, the 64-bit hash alone identifies the slot.
+	// There is no text to hand to glGetUniformLocation, so this always goes through the table.
+	UniformHandle getUniform(StringId name) const
+	{
+		if (!ID && this != &Fallback())
+			return Fallback().getUniform(name);
+		return uniforms.Find(name);
+	}
+
+	void setInt(UniformHandle uniform, int x) const
+	{
+		glUniform1i(uniform.location, x);
+	}
+
+	void setMat4(UniformHandle uniform, const glm::mat4& mat) const
+	{
+		glUniformMatrix4fv(uniform.location, 1, GL_FALSE, &mat[0][0]);
+	}
+
+	void setVec3(UniformHandle uniform, float x, float y, float z) const
+	{
+		glUniform3f(uniform.location, x, y, z);
+	}
 
-	Shader(const char* vertexPath, const char* fragmentPath)
+	void setVec3(UniformHandle uniform, glm::vec3 input) const
+	{
+		glUniform3f(uniform.location, input.x, input.y, input.z);
+	}
+
+	void setFloat(UniformHandle uniform, float x) const
+	{
+		glUniform1f(uniform.location, x);
+	}
+
+	void setInt(std::string_view name, int x) const
+	{
+		setInt(getUniform(name), x);
+	}
+
+	void setMat4(std::string_view name, const glm::mat4& mat) const
+	{
+		setMat4(getUniform(name), mat);
+	}
+
+	void setVec3(std::string_view name, float x, float y, float z) const
+	{
+		setVec3(getUniform(name), x, y, z);
+	}
+
+	void setVec3(std::string_view name, glm::vec3 input) const
+	{
+		setVec3(getUniform(name), input);
+	}
+
+	void setFloat(std::string_view name, float x) const
+	{
+		setFloat(getUniform(name), x);
+	}
+
+	void setInt(StringId name, int x) const
+	{
+		setInt(getUniform(name), x);
+	}
+
+	void setFloat(StringId name, float x) const
+	{
+		setFloat(getUniform(name), x);
+	}
+
+	// Copies the value of every default block uniform of from into the uniform of the same name and type in to.
+	// Uniform values belong to the program object, a freshly linked one starts at zero.
+	static void CopyUniforms(GLuint from, GLuint to)
+	{
+		GLint count = 0, maxLength = 0;
+		glGetProgramiv(from, GL_ACTIVE_UNIFORMS, &count);
+		glGetProgramiv(from, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+		std::vector<GLchar> buffer(maxLength > 0 ? maxLength : 1);
+		for (GLint i = 0; i < count; i++)
+		{
+			GLsizei length = 0;
+			GLint size = 0;
+			GLenum type = 0;
+			glGetActiveUniform(from, i, maxLength, &length, &size, &type, buffer.data());
+			std::string name(buffer.data(), length);
+			if (glGetUniformLocation(from, name.c_str()) < 0)
+				continue;
+			GLuint index = glGetProgramResourceIndex(to, GL_UNIFORM, name.c_str());
+			if (index == GL_INVALID_INDEX)
+				continue;
+			const GLenum property = GL_TYPE;
+			GLint newType = 0;
+			glGetProgramResourceiv(to, GL_UNIFORM, index, 1, &property, 1, nullptr, &newType);
+			if (static_cast<GLenum>(newType) != type)
+				continue;
+
+			// arrays report "name[0]", every element is read and written on its own
+			std::string base = name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0 ? name.substr(0, name.size() - 3) : name;
+			for (GLint element = 0; element < size; element++)
+			{
+				std::string elementName = size > 1 ? base + "[" + std::to_string(element) + "]" : name;
+				GLint source = glGetUniformLocation(from, elementName.c_str());
+				GLint target = glGetUniformLocation(to, elementName.c_str());
+				if (source >= 0 && target >= 0)
+					copyUniform(from, source, to, target, type);
+			}
+		}
+	}
+
+	// defines are inserted after the #version line; also used for the compute stage (ComputeShader.h)
+	static std::string injectDefines(const std::string& code, const std::vector<std::string>& defines)
+	{
+		if (defines.empty())
+			return code;
+		std::string block;
+		for (const std::string& define : defines)
+			block += "#define " + define + "\n";
+		// #version has to stay the first statement
+		size_t version = code.find("#version");
+		size_t lineEnd = version == std::string::npos ? std::string::npos : code.find('\n', version);
+		if (lineEnd == std::string::npos)
+			return version == std::string::npos ? block + code : code + "\n" + block;
+		return code.substr(0, lineEnd + 1) + block + code.substr(lineEnd + 1);
+	}
+
+private:
+	UniformTable uniforms;
+	// owns ID, which stays a plain copy for the hot paths
+	SharedProgram ownedProgram;
+
+	// Compiles and links without querying any status, so the driver is free to work in the background
+	struct PendingProgram
+	{
+		GLuint program = 0;
+		GLuint vertex = 0;
+		GLuint fragment = 0;
+		uint64_t key = 0;
+	};
+
+	std::string vertexPath, fragmentPath;
+	std::vector<std::string> defines;
+	PendingProgram pending;
+
+	void submit()
 	{
 		std::string vertexCode, fragmentCode;
 		std::ifstream vShaderFile, fShaderFile;
@@ -34,62 +386,222 @@ public:
 		{
 			std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
 		}
+		vertexCode = injectDefines(vertexCode, defines);
+		fragmentCode = injectDefines(fragmentCode, defines);
+
+		// the binary is only valid for the exact sources on the exact driver that produced it
+		uint64_t key = HashString(fragmentCode, HashString(vertexCode, HashString(driverString())));
+		GLuint program = glCreateProgram();
+		if (loadProgramBinary(program, key))
+		{
+			swapIn(program);
+			return;
+		}
 
 		const char* vShaderCode = vertexCode.c_str();
 		const char* fShaderCode = fragmentCode.c_str();
-		unsigned int vertexID, fragmentID;
-		// vertex shader source attaching, check compile
-		vertexID = glCreateShader(GL_VERTEX_SHADER);
-		glShaderSource(vertexID, 1, &vShaderCode, NULL);
-		glCompileShader(vertexID);
-		checkCompileErrors(vertexID, "VERTEX");
-		// fragment shader source attaching, check compile
-		fragmentID = glCreateShader(GL_FRAGMENT_SHADER);
-		glShaderSource(fragmentID, 1, &fShaderCode, NULL);
-		glCompileShader(fragmentID);
-		checkCompileErrors(fragmentID, "FRAGMENT");
-		// create shader program
-		ID = glCreateProgram();
-		glAttachShader(ID, vertexID);
-		glAttachShader(ID, fragmentID);
-		glLinkProgram(ID);
-		checkCompileErrors(ID, "PROGRAM");
+		pending.program = program;
+		pending.key = key;
+		pending.vertex = glCreateShader(GL_VERTEX_SHADER);
+		glShaderSource(pending.vertex, 1, &vShaderCode, NULL);
+		glCompileShader(pending.vertex);
+		pending.fragment = glCreateShader(GL_FRAGMENT_SHADER);
+		glShaderSource(pending.fragment, 1, &fShaderCode, NULL);
+		glCompileShader(pending.fragment);
+		// link program, keeping its binary retrievable for the cache
+		glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		glAttachShader(program, pending.vertex);
+		glAttachShader(program, pending.fragment);
+		glLinkProgram(program);
+	}
 
-		glDeleteShader(vertexID);
-		glDeleteShader(fragmentID);
+	void poll()
+	{
+		if (!pending.program)
+			return;
+		if (ParallelCompileSupported())
+		{
+			GLint complete = GL_FALSE;
+			glGetProgramiv(pending.program, GL_COMPLETION_STATUS_KHR, &complete);
+			if (!complete)
+				return;
+		}
+		finishPending();
 	}
 
-	void use() const
+	// First status query, blocks if the driver is still compiling
+	void finishPending()
 	{
-		glUseProgram(ID);
+		if (!pending.program)
+			return;
+		checkCompileErrors(pending.vertex, "VERTEX");
+		checkCompileErrors(pending.fragment, "FRAGMENT");
+		checkCompileErrors(pending.program, "PROGRAM");
+
+		GLint success = GL_FALSE;
+		glGetProgramiv(pending.program, GL_LINK_STATUS, &success);
+		GLuint program = pending.program;
+		uint64_t key = pending.key;
+		glDetachShader(program, pending.vertex);
+		glDetachShader(program, pending.fragment);
+		glDeleteShader(pending.vertex);
+		glDeleteShader(pending.fragment);
+		pending = PendingProgram();
+
+		// a failed reload keeps the last working program
+		if (!success)
+		{
+			glDeleteProgram(program);
+			return;
+		}
+		saveProgramBinary(program, key);
+		swapIn(program);
 	}
 
-	void setInt(const std::string& name, int x) const
+	void discardPending()
 	{
-		glUniform1i(glGetUniformLocation(ID, name.c_str()), x);
+		if (!pending.program)
+			return;
+		glDeleteShader(pending.vertex);
+		glDeleteShader(pending.fragment);
+		glDeleteProgram(pending.program);
+		pending = PendingProgram();
 	}
 
-	void setMat4(const std::string& name, const glm::mat4& mat) const
+	// the replaced program is released to the pool and deleted at its next Collect
+	void swapIn(GLuint program)
 	{
-		glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+		if (ID)
+			CopyUniforms(ID, program);
+		ownedProgram = SharedProgram::Adopt(program);
+		ID = program;
+		uniforms.Reflect(program);
 	}
 
-	void setVec3(const std::string& name, float x, float y, float z) const
+	// Samplers and images hold their unit as an int. Types not listed here are left at their default.
+	static void copyUniform(GLuint from, GLint source, GLuint to, GLint target, GLenum type)
 	{
-		glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+		GLfloat f[16];
+		GLint i[4];
+		GLuint u[4];
+		switch (type)
+		{
+		case GL_FLOAT: glGetUniformfv(from, source, f); glProgramUniform1fv(to, target, 1, f); break;
+		case GL_FLOAT_VEC2: glGetUniformfv(from, source, f); glProgramUniform2fv(to, target, 1, f); break;
+		case GL_FLOAT_VEC3: glGetUniformfv(from, source, f); glProgramUniform3fv(to, target, 1, f); break;
+		case GL_FLOAT_VEC4: glGetUniformfv(from, source, f); glProgramUniform4fv(to, target, 1, f); break;
+		case GL_FLOAT_MAT3: glGetUniformfv(from, source, f); glProgramUniformMatrix3fv(to, target, 1, GL_FALSE, f); break;
+		case GL_FLOAT_MAT4: glGetUniformfv(from, source, f); glProgramUniformMatrix4fv(to, target, 1, GL_FALSE, f); break;
+		case GL_INT_VEC2: glGetUniformiv(from, source, i); glProgramUniform2iv(to, target, 1, i); break;
+		case GL_INT_VEC3: glGetUniformiv(from, source, i); glProgramUniform3iv(to, target, 1, i); break;
+		case GL_INT_VEC4: glGetUniformiv(from, source, i); glProgramUniform4iv(to, target, 1, i); break;
+		case GL_UNSIGNED_INT: glGetUniformuiv(from, source, u); glProgramUniform1uiv(to, target, 1, u); break;
+		case GL_UNSIGNED_INT_VEC2: glGetUniformuiv(from, source, u); glProgramUniform2uiv(to, target, 1, u); break;
+		case GL_UNSIGNED_INT_VEC3: glGetUniformuiv(from, source, u); glProgramUniform3uiv(to, target, 1, u); break;
+		case GL_UNSIGNED_INT_VEC4: glGetUniformuiv(from, source, u); glProgramUniform4uiv(to, target, 1, u); break;
+		case GL_INT:
+		case GL_BOOL:
+		case GL_SAMPLER_2D:
+		case GL_SAMPLER_2D_SHADOW:
+		case GL_SAMPLER_2D_ARRAY:
+		case GL_SAMPLER_3D:
+		case GL_SAMPLER_CUBE:
+		case GL_UNSIGNED_INT_SAMPLER_2D:
+		case GL_INT_SAMPLER_2D:
+		case GL_IMAGE_2D:
+		case GL_UNSIGNED_INT_IMAGE_2D:
+			glGetUniformiv(from, source, i); glProgramUniform1iv(to, target, 1, i); break;
+		default: break;
+		}
 	}
 
-	void setVec3(const std::string& name, glm::vec3 input) const
+	// Program binary cache. File layout: key, binary format, binary length, binary.
+	static std::string driverString()
 	{
-		glUniform3f(glGetUniformLocation(ID, name.c_str()), input.x, input.y, input.z);
+		std::string driver;
+		for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION, GL_SHADING_LANGUAGE_VERSION })
+		{
+			const GLubyte* value = glGetString(name);
+			driver += value ? reinterpret_cast<const char*>(value) : "";
+			driver += '|';
+		}
+		return driver;
 	}
 
-	void setFloat(const std::string& name, float x) const
+	static bool binaryCacheSupported()
 	{
-		glUniform1f(glGetUniformLocation(ID, name.c_str()), x);
+		GLint formats = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+		return formats > 0;
+	}
+
+	static std::string cachePath(uint64_t key)
+	{
+		char name[32];
+		std::snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+		return std::string(SHADER_CACHE_DIRECTORY) + "/" + name;
+	}
+
+	static bool loadProgramBinary(GLuint& program, uint64_t key)
+	{
+		if (!binaryCacheSupported())
+			return false;
+		std::ifstream file(cachePath(key), std::ios::binary);
+		if (!file)
+			return false;
+
+		uint64_t storedKey = 0;
+		GLenum format = 0;
+		GLint length = 0;
+		file.read(reinterpret_cast<char*>(&storedKey), sizeof(storedKey));
+		file.read(reinterpret_cast<char*>(&format), sizeof(format));
+		file.read(reinterpret_cast<char*>(&length), sizeof(length));
+		if (!file || storedKey != key || length <= 0)
+			return false;
+		std::vector<char> binary(length);
+		if (!file.read(binary.data(), length))
+			return false;
+
+		// a driver update can still reject the binary, recompiling replaces the stale file
+		glProgramBinary(program, format, binary.data(), length);
+		GLint success = GL_FALSE;
+		glGetProgramiv(program, GL_LINK_STATUS, &success);
+		if (!success)
+		{
+			std::cout << "SHADER::CACHE::BINARY_REJECTED " << cachePath(key) << ", recompiling" << std::endl;
+			glDeleteProgram(program);
+			program = glCreateProgram();
+			return false;
+		}
+		return true;
+	}
+
+	static void saveProgramBinary(GLuint program, uint64_t key)
+	{
+		GLint length = 0;
+		if (!binaryCacheSupported())
+			return;
+		glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+		if (length <= 0)
+			return;
+		std::vector<char> binary(length);
+		GLenum format = 0;
+		glGetProgramBinary(program, length, &length, &format, binary.data());
+
+		std::error_code error;
+		std::filesystem::create_directories(SHADER_CACHE_DIRECTORY, error);
+		std::ofstream file(cachePath(key), std::ios::binary | std::ios::trunc);
+		if (!file)
+		{
+			std::cout << "ERROR::SHADER::CACHE_NOT_WRITABLE: " << cachePath(key) << std::endl;
+			return;
+		}
+		file.write(reinterpret_cast<const char*>(&key), sizeof(key));
+		file.write(reinterpret_cast<const char*>(&format), sizeof(format));
+		file.write(reinterpret_cast<const char*>(&length), sizeof(length));
+		file.write(binary.data(), length);
 	}
 
-private:
 	void checkCompileErrors(GLuint id, std::string type)
 	{
 		GLint success;
@@ -0,0 +1,402 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "Bounds.h"
+#include "Model.h"
+
+#include <emmintrin.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <future>
+#include <iostream>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Low-poly stand-in for an occluding object, object space triangle list
+struct OccluderMesh {
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> indices;
+
+    size_t TriangleCount() const { return indices.size() / 3; }
+
+    // Vertex clustering over a resolution^3 grid of the model bounds, the same reduction the HLOD proxies use.
+    // Meshes without a CPU copy of their vertices (the glTF zero-copy path) contribute nothing.
+    static OccluderMesh FromModel(const Model& model, int resolution = 12)
+    {
+        OccluderMesh occluder;
+        if (!model.bounds.IsValid())
+            return occluder;
+
+        glm::vec3 size = glm::max(model.bounds.max - model.bounds.min, glm::vec3(1e-4f));
+        std::unordered_map<uint64_t, uint32_t> cells;
+        std::vector<float> weights;
+        for (const Mesh& mesh : model.meshes)
+        {
+            std::vector<uint32_t> remap(mesh.vertices.size());
+            for (size_t i = 0; i < mesh.vertices.size(); i++)
+            {
+                const glm::vec3& position = mesh.vertices[i].Position;
+                glm::ivec3 cell = glm::clamp(glm::ivec3((position - model.bounds.min) / size * float(resolution)), glm::ivec3(0), glm::ivec3(resolution - 1));
+                uint64_t key = (uint64_t(cell.x) << 42) | (uint64_t(cell.y) << 21) | uint64_t(cell.z);
+                auto found = cells.find(key);
+                if (found == cells.end())
+                {
+                    found = cells.emplace(key, static_cast<uint32_t>(occluder.positions.size())).first;
+                    occluder.positions.push_back(glm::vec3(0.0f));
+                    weights.push_back(0.0f);
+                }
+                occluder.positions[found->second] += position;
+                weights[found->second] += 1.0f;
+                remap[i] = found->second;
+            }
+            for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+            {
+                uint32_t a = remap[mesh.indices[i]], b = remap[mesh.indices[i + 1]], c = remap[mesh.indices[i + 2]];
+                // triangles that collapsed into a cell edge or point
+                if (a == b || b == c || a == c)
+                    continue;
+                occluder.indices.insert(occluder.indices.end(), { a, b, c });
+            }
+        }
+        for (size_t i = 0; i < occluder.positions.size(); i++)
+            occluder.positions[i] /= weights[i];
+        return occluder;
+    }
+
+    // Two triangles spanning an XZ rectangle at height y, e.g. a floor
+    static OccluderMesh Plane(const glm::vec2& min, const glm::vec2& max, float y)
+    {
+        OccluderMesh occluder;
+        occluder.positions = { glm::vec3(min.x, y, min.y), glm::vec3(max.x, y, min.y), glm::vec3(max.x, y, max.y), glm::vec3(min.x, y, max.y) };
+        occluder.indices = { 0, 1, 2, 0, 2, 3 };
+        return occluder;
+    }
+};
+
+// CPU depth-only rasterizer for occlusion tests, no GL involved.
+// AddOccluder transforms, near-clips and projects triangles and bins them into fixed screen tiles; Rasterize
+// then fills the tiles on a few threads, each tile owned by exactly one thread so there is no locking, four
+// pixels at a time with SSE. The buffer holds [0,1] window depth like GL's, row 0 at the bottom.
+// IsVisible compares a box's nearest depth against the buffer over the box's screen rectangle.
+class OcclusionRasterizer {
+public:
+    static const int TILE_WIDTH = 64;
+    static const int TILE_HEIGHT = 32;
+
+    struct Stats {
+        size_t occluderTriangles = 0;
+        size_t rasterizedTriangles = 0;
+        double setupMilliseconds = 0.0;
+        double rasterMilliseconds = 0.0;
+        unsigned int tested = 0;
+        unsigned int occluded = 0;
+    };
+
+    // size is rounded up to whole tiles; threadCount 0 uses every hardware thread
+    OcclusionRasterizer(int width = 256, int height = 128, unsigned int threadCount = 0)
+    {
+        tilesX = (width + TILE_WIDTH - 1) / TILE_WIDTH;
+        tilesY = (height + TILE_HEIGHT - 1) / TILE_HEIGHT;
+        this->width = tilesX * TILE_WIDTH;
+        this->height = tilesY * TILE_HEIGHT;
+        depth.assign(size_t(this->width) * this->height, 1.0f);
+        bins.resize(size_t(tilesX) * tilesY);
+        SetThreadCount(threadCount);
+    }
+
+    void SetThreadCount(unsigned int threadCount)
+    {
+        threads = threadCount ? threadCount : std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // Starts a frame: the occluders and tests that follow use this matrix
+    void Begin(const glm::mat4& viewProjection)
+    {
+        this->viewProjection = viewProjection;
+        triangles.clear();
+        for (std::vector<uint32_t>& bin : bins)
+            bin.clear();
+        stats = Stats();
+    }
+
+    void AddOccluder(const OccluderMesh& mesh, const glm::mat4& transform)
+    {
+        auto start = std::chrono::steady_clock::now();
+        glm::mat4 clipFromObject = viewProjection * transform;
+        clipPositions.resize(mesh.positions.size());
+        for (size_t i = 0; i < mesh.positions.size(); i++)
+            clipPositions[i] = clipFromObject * glm::vec4(mesh.positions[i], 1.0f);
+
+        for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+        {
+            const glm::vec4 corners[3] = { clipPositions[mesh.indices[i]], clipPositions[mesh.indices[i + 1]], clipPositions[mesh.indices[i + 2]] };
+            stats.occluderTriangles++;
+            if (outsideOnePlane(corners))
+                continue;
+            if (corners[0].z >= -corners[0].w && corners[1].z >= -corners[1].w && corners[2].z >= -corners[2].w)
+            {
+                addTriangle(corners[0], corners[1], corners[2]);
+                continue;
+            }
+
+            // Sutherland-Hodgman against the near plane (z = -w), then fan the polygon
+            glm::vec4 polygon[4];
+            int count = 0;
+            for (int v = 0; v < 3; v++)
+            {
+                const glm::vec4& current = corners[v];
+                const glm::vec4& next = corners[(v + 1) % 3];
+                float currentDistance = current.z + current.w;
+                float nextDistance = next.z + next.w;
+                if (currentDistance >= 0.0f)
+                    polygon[count++] = current;
+                if ((currentDistance >= 0.0f) != (nextDistance >= 0.0f))
+                    polygon[count++] = glm::mix(current, next, currentDistance / (currentDistance - nextDistance));
+            }
+            for (int v = 2; v < count; v++)
+                addTriangle(polygon[0], polygon[v - 1], polygon[v]);
+        }
+        stats.setupMilliseconds += millisecondsSince(start);
+    }
+
+    // Clears and fills every tile; IsVisible is only meaningful afterwards
+    void Rasterize()
+    {
+        auto start = std::chrono::steady_clock::now();
+        std::atomic<int> nextTile(0);
+        int tileCount = tilesX * tilesY;
+        auto worker = [this, &nextTile, tileCount]()
+        {
+            for (int tile = nextTile++; tile < tileCount; tile = nextTile++)
+                rasterizeTile(tile);
+        };
+        std::vector<std::future<void>> helpers;
+        for (unsigned int i = 1; i < std::min<unsigned int>(threads, tileCount); i++)
+            helpers.push_back(std::async(std::launch::async, worker));
+        worker();
+        for (std::future<void>& helper : helpers)
+            helper.wait();
+        stats.rasterMilliseconds += millisecondsSince(start);
+    }
+
+    // Conservative: boxes crossing the near plane are visible, boxes entirely off screen are not
+    bool IsVisible(const BoundingBox& box, const glm::mat4& transform)
+    {
+        stats.tested++;
+        glm::mat4 clipFromObject = viewProjection * transform;
+        glm::vec2 minimum(FLT_MAX), maximum(-FLT_MAX);
+        float nearest = 1.0f;
+        for (int i = 0; i < 8; i++)
+        {
+            glm::vec3 corner((i & 1) ? box.max.x : box.min.x, (i & 2) ? box.max.y : box.min.y, (i & 4) ? box.max.z : box.min.z);
+            glm::vec4 clip = clipFromObject * glm::vec4(corner, 1.0f);
+            if (clip.z < -clip.w || clip.w <= 0.0f)
+                return true;
+            glm::vec3 window = toWindow(clip);
+            minimum = glm::min(minimum, glm::vec2(window));
+            maximum = glm::max(maximum, glm::vec2(window));
+            nearest = std::min(nearest, window.z);
+        }
+        int x0 = std::max(0, int(std::floor(minimum.x))), x1 = std::min(width - 1, int(std::ceil(maximum.x)));
+        int y0 = std::max(0, int(std::floor(minimum.y))), y1 = std::min(height - 1, int(std::ceil(maximum.y)));
+        if (x0 > x1 || y0 > y1)
+        {
+            stats.occluded++;
+            return false;
+        }
+
+        // visible as soon as one pixel of the rectangle is not nearer than the box
+        __m128 boxDepth = _mm_set1_ps(nearest);
+        for (int y = y0; y <= y1; y++)
+        {
+            const float* row = &depth[size_t(y) * width];
+            int x = x0;
+            for (; x + 3 <= x1; x += 4)
+                if (_mm_movemask_ps(_mm_cmpge_ps(_mm_loadu_ps(row + x), boxDepth)))
+                    return true;
+            for (; x <= x1; x++)
+                if (row[x] >= nearest)
+                    return true;
+        }
+        stats.occluded++;
+        return false;
+    }
+
+    const std::vector<float>& Depth() const { return depth; }
+    int Width() const { return width; }
+    int Height() const { return height; }
+    unsigned int ThreadCount() const { return threads; }
+    const Stats& GetStats() const { return stats; }
+
+    // Rasterizes the occluder at every placement with 1, 2, 4... threads and times the box tests, no GL needed
+    static void Benchmark(const OccluderMesh& occluder, const BoundingBox& bounds, const std::vector<glm::mat4>& placements,
+                          const glm::mat4& viewProjection, int iterations = 20)
+    {
+        std::cout << "OCCLUSION::BENCHMARK " << placements.size() << " occluders of " << occluder.TriangleCount() << " triangles, "
+                  << iterations << " iterations" << std::endl;
+        OcclusionRasterizer rasterizer;
+        unsigned int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned int threadCount = 1; ; threadCount = std::min(threadCount * 2, maxThreads))
+        {
+            rasterizer.SetThreadCount(threadCount);
+            double setup = 0.0, raster = 0.0, test = 0.0;
+            for (int i = 0; i < iterations; i++)
+            {
+                rasterizer.Begin(viewProjection);
+                for (const glm::mat4& placement : placements)
+                    rasterizer.AddOccluder(occluder, placement);
+                rasterizer.Rasterize();
+                auto start = std::chrono::steady_clock::now();
+                for (const glm::mat4& placement : placements)
+                    rasterizer.IsVisible(bounds, placement);
+                test += millisecondsSince(start);
+                setup += rasterizer.stats.setupMilliseconds;
+                raster += rasterizer.stats.rasterMilliseconds;
+            }
+            const Stats& stats = rasterizer.stats;
+            std::cout << "  " << threadCount << " thread(s): setup " << setup / iterations << " ms, raster " << raster / iterations
+                      << " ms, " << stats.tested << " tests " << test / iterations << " ms, " << stats.rasterizedTriangles << " / "
+                      << stats.occluderTriangles << " triangles rasterized, " << stats.occluded << " occluded" << std::endl;
+            if (threadCount == maxThreads)
+                break;
+        }
+    }
+
+private:
+    // screen space triangle, counter-clockwise, window depth per corner
+    struct Triangle {
+        float x[3], y[3], z[3];
+    };
+
+    int width, height, tilesX, tilesY;
+    unsigned int threads = 1;
+    glm::mat4 viewProjection = glm::mat4(1.0f);
+    std::vector<float> depth;
+    std::vector<Triangle> triangles;
+    // indices into triangles, one list per tile
+    std::vector<std::vector<uint32_t>> bins;
+    std::vector<glm::vec4> clipPositions;
+    Stats stats;
+
+    static double millisecondsSince(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    static bool outsideOnePlane(const glm::vec4* corners)
+    {
+        for (int axis = 0; axis < 3; axis++)
+        {
+            if (corners[0][axis] > corners[0].w && corners[1][axis] > corners[1].w && corners[2][axis] > corners[2].w)
+                return true;
+            if (corners[0][axis] < -corners[0].w && corners[1][axis] < -corners[1].w && corners[2][axis] < -corners[2].w)
+                return true;
+        }
+        return false;
+    }
+
+    glm::vec3 toWindow(const glm::vec4& clip) const
+    {
+        glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        return glm::vec3((ndc.x * 0.5f + 0.5f) * width, (ndc.y * 0.5f + 0.5f) * height, ndc.z * 0.5f + 0.5f);
+    }
+
+    void addTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c)
+    {
+        glm::vec3 window[3] = { toWindow(a), toWindow(b), toWindow(c) };
+        float area = (window[1].x - window[0].x) * (window[2].y - window[0].y) - (window[2].x - window[0].x) * (window[1].y - window[0].y);
+        if (area == 0.0f)
+            return;
+        // both windings occlude, flip to counter-clockwise so the edge tests have one sign
+        if (area < 0.0f)
+            std::swap(window[1], window[2]);
+
+        float minX = std::min({ window[0].x, window[1].x, window[2].x }), maxX = std::max({ window[0].x, window[1].x, window[2].x });
+        float minY = std::min({ window[0].y, window[1].y, window[2].y }), maxY = std::max({ window[0].y, window[1].y, window[2].y });
+        if (maxX < 0.0f || maxY < 0.0f || minX >= width || minY >= height)
+            return;
+        int tileX0 = std::max(0, int(minX) / TILE_WIDTH), tileX1 = std::min(tilesX - 1, int(maxX) / TILE_WIDTH);
+        int tileY0 = std::max(0, int(minY) / TILE_HEIGHT), tileY1 = std::min(tilesY - 1, int(maxY) / TILE_HEIGHT);
+
+        Triangle triangle;
+        for (int v = 0; v < 3; v++)
+        {
+            triangle.x[v] = window[v].x;
+            triangle.y[v] = window[v].y;
+            triangle.z[v] = window[v].z;
+        }
+        uint32_t index = static_cast<uint32_t>(triangles.size());
+        triangles.push_back(triangle);
+        stats.rasterizedTriangles++;
+        for (int tileY = tileY0; tileY <= tileY1; tileY++)
+            for (int tileX = tileX0; tileX <= tileX1; tileX++)
+                bins[size_t(tileY) * tilesX + tileX].push_back(index);
+    }
+
+    void rasterizeTile(int tile)
+    {
+        int tileX = (tile % tilesX) * TILE_WIDTH;
+        int tileY = (tile / tilesX) * TILE_HEIGHT;
+        for (int y = tileY; y < tileY + TILE_HEIGHT; y++)
+            std::fill_n(&depth[size_t(y) * width + tileX], TILE_WIDTH, 1.0f);
+
+        const __m128 laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+        const __m128 zero = _mm_setzero_ps();
+        for (uint32_t index : bins[tile])
+        {
+            const Triangle& triangle = triangles[index];
+            // edge function of the edge opposite each corner: e(x, y) = a x + b y + c, positive inside
+            float a[3], b[3], c[3];
+            for (int v = 0; v < 3; v++)
+            {
+                int from = (v + 1) % 3, to = (v + 2) % 3;
+                a[v] = triangle.y[from] - triangle.y[to];
+                b[v] = triangle.x[to] - triangle.x[from];
+                c[v] = triangle.x[from] * triangle.y[to] - triangle.x[to] * triangle.y[from];
+            }
+            float area = c[0] + c[1] + c[2];
+            // depth plane from the barycentric weights e1 / area and e2 / area
+            float dz1 = (triangle.z[1] - triangle.z[0]) / area, dz2 = (triangle.z[2] - triangle.z[0]) / area;
+            float za = a[1] * dz1 + a[2] * dz2;
+            float zb = b[1] * dz1 + b[2] * dz2;
+            float zc = triangle.z[0] + c[1] * dz1 + c[2] * dz2;
+
+            // bounds clamped in float first, far off-screen corners would overflow int
+            float left = std::max(float(tileX), std::min({ triangle.x[0], triangle.x[1], triangle.x[2] }));
+            float right = std::min(float(tileX + TILE_WIDTH - 1), std::max({ triangle.x[0], triangle.x[1], triangle.x[2] }));
+            float bottom = std::max(float(tileY), std::min({ triangle.y[0], triangle.y[1], triangle.y[2] }));
+            float top = std::min(float(tileY + TILE_HEIGHT - 1), std::max({ triangle.y[0], triangle.y[1], triangle.y[2] }));
+            // x starts on a multiple of 4 (tiles are too), so the 4-wide steps never leave the tile
+            int x0 = int(left) & ~3, x1 = int(std::ceil(right));
+            int y0 = int(bottom), y1 = int(std::ceil(top));
+
+            __m128 edgeA[3] = { _mm_set1_ps(a[0]), _mm_set1_ps(a[1]), _mm_set1_ps(a[2]) };
+            __m128 depthA = _mm_set1_ps(za);
+            for (int y = y0; y <= y1; y++)
+            {
+                float pixelY = y + 0.5f;
+                __m128 edgeRow[3] = { _mm_set1_ps(b[0] * pixelY + c[0]), _mm_set1_ps(b[1] * pixelY + c[1]), _mm_set1_ps(b[2] * pixelY + c[2]) };
+                __m128 depthRow = _mm_set1_ps(zb * pixelY + zc);
+                float* row = &depth[size_t(y) * width];
+                for (int x = x0; x <= x1; x += 4)
+                {
+                    __m128 pixelX = _mm_add_ps(_mm_set1_ps(float(x)), laneOffsets);
+                    __m128 inside = _mm_and_ps(_mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA[0], pixelX), edgeRow[0]), zero),
+                                    _mm_and_ps(_mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA[1], pixelX), edgeRow[1]), zero),
+                                               _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA[2], pixelX), edgeRow[2]), zero)));
+                    if (!_mm_movemask_ps(inside))
+                        continue;
+                    __m128 stored = _mm_loadu_ps(row + x);
+                    __m128 nearer = _mm_min_ps(stored, _mm_add_ps(_mm_mul_ps(depthA, pixelX), depthRow));
+                    _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, stored)));
+                }
+            }
+        }
+    }
+};
@@ -8,8 +8,25 @@
 #include "Camera.h"
 #include "Shader.h"
 #include "Model.h"
-
+#include "VertexAnimation.h"
+#include "HLOD.h"
+#include "UniformBuffer.h"
+#include "Culling.h"
+#include "GpuCulling.h"
+#include "HiZ.h"
+#include "GpuTimer.h"
+#include "SoftwareOcclusion.h"
+#include "OcclusionDebugView.h"
+#include "OcclusionQueries.h"
+#include "PointLights.h"
+#include "ClusteredLights.h"
+#include "Deferred.h"
+#include "VisibilityBuffer.h"
+
+#include <algorithm>
 #include <iostream>
+#include <memory>
+#include <random>
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
@@ -30,6 +47,82 @@ bool firstMouse = true;
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 
+// crowd (vertex animation textures), toggled with C
+const int CROWD_SIDE = 64;
+const float CROWD_SPACING = 3.0f;
+bool crowdMode = false;
+bool crowdKeyDownLastFrame = false;
+
+// static field of models, toggled with F; HLOD proxies for distant clusters, toggled with H
+const int FIELD_SIDE = 24;
+const float FIELD_SPACING = 4.0f;
+const float HLOD_CLUSTER_SIZE = 16.0f;
+const float HLOD_SWITCH_DISTANCE = 30.0f;
+bool fieldMode = false;
+bool fieldKeyDownLastFrame = false;
+bool hlodEnabled = true;
+bool hlodKeyDownLastFrame = false;
+
+// shaders are recompiled from disk in the background with R
+bool reloadRequested = false;
+bool reloadKeyDownLastFrame = false;
+
+// depth prepass through the position-only vertex stream, toggled with P
+bool depthPrepass = true;
+bool prepassKeyDownLastFrame = false;
+
+// frustum culling of meshes and field objects, toggled with K; B benchmarks the SIMD culling paths
+bool frustumCulling = true;
+bool cullingKeyDownLastFrame = false;
+bool cullingReportRequested = false;
+bool benchmarkRequested = false;
+bool benchmarkKeyDownLastFrame = false;
+
+// GPU-driven field: culled and compacted by a compute pass, drawn with one indirect call per mesh; toggled with G
+const int GPU_FIELD_SIDE = 512;
+bool gpuDrivenMode = false;
+bool gpuDrivenKeyDownLastFrame = false;
+// two-phase HiZ occlusion culling of the GPU-driven field, toggled with O
+bool occlusionCulling = true;
+bool occlusionKeyDownLastFrame = false;
+
+// CPU occlusion culling of the field: the nearest visible objects are rasterized as simplified occluders and
+// every other object's box is tested against them before drawing; toggled with X, V shows the occlusion buffer
+const int OCCLUDER_COUNT = 32;
+bool softwareOcclusion = false;
+bool softwareOcclusionKeyDownLastFrame = false;
+bool occlusionDebugView = false;
+bool occlusionDebugKeyDownLastFrame = false;
+
+// hardware occlusion queries on the field's bounding boxes, reusing last frame's results; toggled with Q
+bool hardwareOcclusion = false;
+bool hardwareOcclusionKeyDownLastFrame = false;
+
+// how the model and the CPU field are shaded, M cycles: forward, deferred through a compact G-buffer with
+// tiled lighting, or a visibility buffer of draw and triangle ids resolved from the geometry arena.
+// The crowd and the GPU-driven field stay forward.
+enum RenderPath {
+    FORWARD_RENDERING,
+    DEFERRED_RENDERING,
+    VISIBILITY_BUFFER_RENDERING,
+    RENDER_PATH_COUNT
+};
+const char* const RENDER_PATH_NAMES[RENDER_PATH_COUNT] = { "forward", "deferred", "visibility buffer" };
+RenderPath renderPath = FORWARD_RENDERING;
+bool renderPathKeyDownLastFrame = false;
+
+// point lights, L cycles the counts: the three tutorial lights plus coloured ones scattered over the scene
+const unsigned int LIGHT_COUNTS[] = { 3, 256, 1024, 4096 };
+const int LIGHT_COUNT_STEPS = sizeof(LIGHT_COUNTS) / sizeof(LIGHT_COUNTS[0]);
+int lightCountStep = 0;
+bool lightCountKeyDownLastFrame = false;
+bool lightsDirty = true;
+
+// forward shading (shader.fs, transparent.fs) loops over the lights of its view space cluster only;
+// T switches back to every light per fragment for comparison
+bool clusteredShading = true;
+bool clusteredShadingKeyDownLastFrame = false;
+
 int main()
 {
     glfwInit();
@@ -60,9 +153,99 @@ int main()
     stbi_set_flip_vertically_on_load(true);
     glEnable(GL_DEPTH_TEST);
 
-    Shader ourShader("shader.vs", "shader.fs");
-
-    Model ourModel("./backpack/backpack.obj");
+    // submitted together so the driver can compile them in parallel, draws use Shader::Fallback() until each links
+    Shader ourShader("shader.vs", "shader.fs", {}, COMPILE_ASYNC);
+    Shader depthShader("depth.vs", "depth.fs", {}, COMPILE_ASYNC);
+    // model matrices come from the GPU culling instance buffer
+    Shader indirectShader("shader.vs", "shader.fs", { "GPU_INSTANCES" }, COMPILE_ASYNC);
+    Shader indirectDepthShader("depth.vs", "depth.fs", { "GPU_INSTANCES" }, COMPILE_ASYNC);
+    ComputeShader cullShader("cull.cs");
+    ComputeShader hiZShader("hiz_downsample.cs");
+    Shader gBufferShader("shader.vs", "gbuffer.fs", {}, COMPILE_ASYNC);
+    Shader transparentShader("transparent.vs", "transparent.fs", {}, COMPILE_ASYNC);
+    ComputeShader deferredLightingShader("deferred_lighting.cs");
+    ComputeShader clusterAssignShader("cluster_assign.cs");
+    Shader visibilityShader("depth.vs", "visibility.fs", {}, COMPILE_ASYNC);
+    ComputeShader visibilityResolveShader("visibility_resolve.cs");
+
+    const std::string modelPath = "./backpack/backpack.obj";
+    Model ourModel(modelPath);
+
+    // Crowd: bake the model's animations once, then every instance only picks a clip and a time offset
+    Shader crowdShader("vat.vs", "vat.fs", {}, COMPILE_ASYNC);
+    VertexAnimation crowdAnimation(modelPath, ourModel);
+
+    std::vector<CrowdInstance> crowd;
+    std::mt19937 rng(1337);
+    std::uniform_int_distribution<int> clipDist(0, static_cast<int>(crowdAnimation.clips.size()) - 1);
+    std::uniform_real_distribution<float> unitDist(0.0f, 1.0f);
+    for (int z = 0; z < CROWD_SIDE; z++)
+    {
+        for (int x = 0; x < CROWD_SIDE; x++)
+        {
+            CrowdInstance instance;
+            instance.model = glm::translate(glm::mat4(1.0f), glm::vec3((x - CROWD_SIDE / 2) * CROWD_SPACING, 0.0f, -z * CROWD_SPACING));
+            instance.model = glm::rotate(instance.model, unitDist(rng) * glm::two_pi<float>(), glm::vec3(0.0f, 1.0f, 0.0f));
+            instance.animation = glm::vec4(clipDist(rng), unitDist(rng) * 10.0f, 0.8f + 0.4f * unitDist(rng), 0.0f);
+            crowd.push_back(instance);
+        }
+    }
+    SharedBuffer crowdBuffer = GpuResources::CreateBuffer();
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, crowdBuffer.Id());
+    glBufferData(GL_SHADER_STORAGE_BUFFER, crowd.size() * sizeof(CrowdInstance), crowd.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    // Field: static placements, grouped and merged into HLOD proxies once at load time
+    std::vector<SceneObject> field;
+    for (int z = 0; z < FIELD_SIDE; z++)
+    {
+        for (int x = 0; x < FIELD_SIDE; x++)
+        {
+            glm::mat4 transform = glm::translate(glm::mat4(1.0f), glm::vec3((x - FIELD_SIDE / 2) * FIELD_SPACING, 0.0f, -z * FIELD_SPACING));
+            transform = glm::rotate(transform, unitDist(rng) * glm::two_pi<float>(), glm::vec3(0.0f, 1.0f, 0.0f));
+            field.push_back({ &ourModel, transform });
+        }
+    }
+    HLOD fieldHLOD(field, HLOD_CLUSTER_SIZE, HLOD_SWITCH_DISTANCE);
+
+    // world space bounding sphere of every field object, culled as one batch each frame
+    SphereSoA fieldSpheres;
+    fieldSpheres.Reserve(field.size());
+    for (const SceneObject& object : field)
+        fieldSpheres.Add(BoundingSphere::FromBox(object.model->bounds).Transformed(object.transform));
+    std::vector<uint32_t> visibleObjects;
+    // meshes of the single model inside the frustum, shared by the stats and every pass of the frame
+    std::vector<uint32_t> visibleMeshes;
+    // occluders are a clustered copy of the model, a few hundred triangles instead of the full mesh
+    OccluderMesh fieldOccluder = OccluderMesh::FromModel(ourModel);
+    std::cout << "OCCLUSION::OCCLUDER " << fieldOccluder.TriangleCount() << " triangles" << std::endl;
+    OcclusionRasterizer occlusionRasterizer;
+    OcclusionDebugView occlusionDebug;
+    std::vector<uint32_t> occluderObjects;
+    std::vector<BoundingBox> fieldBoxes;
+    for (const SceneObject& object : field)
+        fieldBoxes.push_back(object.model->bounds.Transformed(object.transform));
+    OcclusionQueries fieldQueries(fieldBoxes);
+    // split of visibleObjects by the last query results
+    std::vector<uint32_t> queryVisibleObjects, queryHiddenObjects;
+    GpuTimer sceneTimer;
+    // last GPU time of the CPU field with the queries on and off
+    double queryMilliseconds[2] = { 0.0, 0.0 };
+    // last GPU time of the model or CPU field scene in each render path
+    double renderPathMilliseconds[RENDER_PATH_COUNT] = {};
+    DeferredRenderer deferred;
+    // the model's vertices and triangles go into the geometry arena up front rather than on the first draw
+    VisibilityBuffer visibility;
+    visibility.Add(ourModel);
+    unsigned int culledTested = 0, culledVisible = 0;
+    unsigned int frameCount = 0;
+
+    // built on first use, the command buffer alone is a few MB per mesh
+    std::unique_ptr<GpuCulling> gpuField;
+    HiZPyramid hiZ;
+    GpuTimer gpuFieldTimer;
+    // last GPU time measured with occlusion culling on and off, for the saving in the report
+    double occlusionMilliseconds[2] = { 0.0, 0.0 };
 
     //glm::vec3 pointLightPositions[] = {
     //    glm::vec3(3.0f, 4.0f, 3.0f),   
@@ -75,6 +258,58 @@ int main()
 		glm::vec3(0.0f,  0.0f, -6.0f)
     };
 
+    // camera and lights live in uniform buffers bound once for every program
+    UniformBuffer<FrameUniforms> frameBuffer(FRAME_UBO_BINDING);
+    UniformBuffer<LightUniforms> lightBuffer(LIGHTS_UBO_BINDING);
+
+    LightUniforms lights = {};
+    lights.dirLight.direction = glm::vec4(-0.2f, -1.0f, -0.3f, 0.0f);
+    lights.dirLight.ambient = glm::vec4(0.05f, 0.05f, 0.05f, 0.0f);
+    lights.dirLight.diffuse = glm::vec4(0.4f, 0.4f, 0.4f, 0.0f);
+    lights.dirLight.specular = glm::vec4(0.5f, 0.5f, 0.5f, 0.0f);
+    // point lights are rebuilt whenever their count or the scene changes
+    std::vector<PointLightData> pointLights;
+    PointLightBuffer pointLightBuffer;
+    ClusteredLights clusteredLights;
+
+    // Transparent grass cards, drawn forward and blended in both render paths
+    float grassVertices[] = {
+        // positions         // texture coords
+        -0.5f, 0.0f, 0.0f,   0.0f, 0.0f,
+         0.5f, 0.0f, 0.0f,   1.0f, 0.0f,
+         0.5f, 1.0f, 0.0f,   1.0f, 1.0f,
+        -0.5f, 0.0f, 0.0f,   0.0f, 0.0f,
+         0.5f, 1.0f, 0.0f,   1.0f, 1.0f,
+        -0.5f, 1.0f, 0.0f,   0.0f, 1.0f
+    };
+    SharedVertexArray grassVertexArray = GpuResources::CreateVertexArray();
+    SharedBuffer grassVertexBuffer = GpuResources::CreateBuffer();
+    glBindVertexArray(grassVertexArray.Id());
+    glBindBuffer(GL_ARRAY_BUFFER, grassVertexBuffer.Id());
+    glBufferData(GL_ARRAY_BUFFER, sizeof(grassVertices), grassVertices, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
+    glBindVertexArray(0);
+    SharedTexture grassTexture = SharedTexture::Adopt(TextureFromFile("grass.png", "."));
+    // repeating would bleed the bottom edge into the top under linear filtering
+    glBindTexture(GL_TEXTURE_2D, grassTexture.Id());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    // a loose ring at the model's feet
+    std::vector<glm::mat4> grassCards;
+    for (int i = 0; i < 24; i++)
+    {
+        float angle = i * glm::two_pi<float>() / 24.0f + unitDist(rng) * 0.2f;
+        float distance = 2.5f + unitDist(rng) * 1.5f;
+        glm::mat4 card = glm::translate(glm::mat4(1.0f), glm::vec3(std::cos(angle) * distance, -3.3f, std::sin(angle) * distance));
+        card = glm::rotate(card, unitDist(rng) * glm::pi<float>(), glm::vec3(0.0f, 1.0f, 0.0f));
+        grassCards.push_back(glm::scale(card, glm::vec3(1.5f)));
+    }
+    std::vector<std::pair<float, size_t>> grassOrder;
+
     // Draw in wireframe
     //glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
@@ -88,62 +323,425 @@ int main()
 
         // Input
         processInput(window);
-
+        if (lightsDirty)
+        {
+            // the tutorial lights stay, the others are scattered over the model or over the whole field
+            pointLights.clear();
+            for (const glm::vec3& position : pointLightPositions)
+            {
+                PointLightData light;
+                light.position = glm::vec4(position, 0.0f);
+                light.ambient = glm::vec4(0.05f, 0.05f, 0.05f, 0.0f);
+                light.diffuse = glm::vec4(0.8f, 0.8f, 0.8f, 0.0f);
+                light.specular = glm::vec4(1.0f, 1.0f, 1.0f, 0.0f);
+                light.attenuation = glm::vec4(1.0f, 0.09f, 0.032f, 0.0f);
+                pointLights.push_back(light);
+            }
+            std::mt19937 lightRng(7);
+            glm::vec3 regionMin = fieldMode ? glm::vec3(-FIELD_SIDE / 2 * FIELD_SPACING, -3.0f, -FIELD_SIDE * FIELD_SPACING) : glm::vec3(-6.0f, -4.0f, -4.0f);
+            glm::vec3 regionMax = fieldMode ? glm::vec3(FIELD_SIDE / 2 * FIELD_SPACING, 4.0f, 2.0f) : glm::vec3(6.0f, 4.0f, 5.0f);
+            while (pointLights.size() < LIGHT_COUNTS[lightCountStep])
+            {
+                glm::vec3 color = glm::vec3(unitDist(lightRng), unitDist(lightRng), unitDist(lightRng));
+                color /= std::max({ color.r, color.g, color.b, 0.01f });
+                PointLightData light;
+                light.position = glm::vec4(glm::mix(regionMin, regionMax, glm::vec3(unitDist(lightRng), unitDist(lightRng), unitDist(lightRng))), 0.0f);
+                light.ambient = glm::vec4(0.0f);
+                light.diffuse = glm::vec4(color * 0.5f, 0.0f);
+                light.specular = glm::vec4(color * 0.5f, 0.0f);
+                light.attenuation = glm::vec4(1.0f, 1.4f, 7.2f, 0.0f);
+                pointLights.push_back(light);
+            }
+            for (PointLightData& light : pointLights)
+                light.position.w = PointLightData::Radius(light);
+            pointLightBuffer.Upload(pointLights);
+            lightsDirty = false;
+        }
+        if (reloadRequested)
+        {
+            ourShader.Reload();
+            depthShader.Reload();
+            crowdShader.Reload();
+            indirectShader.Reload();
+            indirectDepthShader.Reload();
+            cullShader.Reload();
+            hiZShader.Reload();
+            gBufferShader.Reload();
+            transparentShader.Reload();
+            deferredLightingShader.Reload();
+            clusterAssignShader.Reload();
+            visibilityShader.Reload();
+            visibilityResolveShader.Reload();
+            reloadRequested = false;
+        }
         // Render
         glClearColor(0.05f, 0.05f, 0.05f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+        // View/projection transformations, uploaded once for every program
+        const float zNear = 0.1f, zFar = 100.0f;
+        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, zNear, zFar);
+        glm::mat4 view = camera.GetViewMatrix();
+        FrameUniforms frame;
+        frame.view = view;
+        frame.projection = projection;
+        frame.viewPos = glm::vec4(camera.Position, 1.0f);
+        frame.time = glm::vec4(currentFrame, deltaTime, 0.0f, 0.0f);
+        frameBuffer.Update(frame);
+        Frustum frustum = camera.GetFrustum(projection);
+
+        // Light lists: cluster lists for forward shading now, the deferred and visibility tiles build theirs later
+        int width, height;
+        glfwGetFramebufferSize(window, &width, &height);
+        bool clustersBuilt = clusteredShading && width > 0 && height > 0;
+        pointLightBuffer.ResetOverflow();
+        lights.lightCount = glm::ivec4(pointLightBuffer.Count(), clustersBuilt ? 1 : 0, 0, 0);
+        lights.clusterParams = ClusteredLights::Params(width, height, zNear, zFar);
+        lightBuffer.Update(lights);
+        if (clustersBuilt)
+            clusteredLights.Assign(clusterAssignShader, projection, width, height, zNear, zFar);
+
+        if (benchmarkRequested)
+        {
+            FrustumCulling::Benchmark();
+            // the whole field as occluders, seen from the current camera
+            std::vector<glm::mat4> placements;
+            for (const SceneObject& object : field)
+                placements.push_back(object.transform);
+            OcclusionRasterizer::Benchmark(fieldOccluder, ourModel.bounds, placements, projection * view);
+            benchmarkRequested = false;
+        }
+
         ourShader.use();
-        ourShader.setVec3("viewPos", camera.Position);
         ourShader.setFloat("shininess", 32.0f);
 
-        // dir light
-        ourShader.setVec3("dirLight.direction", glm::vec3(-0.2f, -1.0f, -0.3f));
-        ourShader.setVec3("dirLight.ambient", 0.05f, 0.05f, 0.05f);
-        ourShader.setVec3("dirLight.diffuse", 0.4f, 0.4f, 0.4f);
-        ourShader.setVec3("dirLight.specular", 0.5f, 0.5f, 0.5f);
-        // point light 1
-        ourShader.setVec3("pointLights[0].position", pointLightPositions[0]);
-        ourShader.setVec3("pointLights[0].ambient", 0.05f, 0.05f, 0.05f);
-        ourShader.setVec3("pointLights[0].diffuse", 0.8f, 0.8f, 0.8f);
-        ourShader.setVec3("pointLights[0].specular", 1.0f, 1.0f, 1.0f);
-        ourShader.setFloat("pointLights[0].constant", 1.0f);
-        ourShader.setFloat("pointLights[0].linear", 0.09f);
-        ourShader.setFloat("pointLights[0].quadratic", 0.032f);
-        // point light 2
-        ourShader.setVec3("pointLights[1].position", pointLightPositions[1]);
-        ourShader.setVec3("pointLights[1].ambient", 0.05f, 0.05f, 0.05f);
-        ourShader.setVec3("pointLights[1].diffuse", 0.8f, 0.8f, 0.8f);
-        ourShader.setVec3("pointLights[1].specular", 1.0f, 1.0f, 1.0f);
-        ourShader.setFloat("pointLights[1].constant", 1.0f);
-        ourShader.setFloat("pointLights[1].linear", 0.09f);
-        ourShader.setFloat("pointLights[1].quadratic", 0.032f);
-        // point light 3
-        ourShader.setVec3("pointLights[2].position", pointLightPositions[2]);
-        ourShader.setVec3("pointLights[2].ambient", 0.05f, 0.05f, 0.05f);
-        ourShader.setVec3("pointLights[2].diffuse", 0.8f, 0.8f, 0.8f);
-        ourShader.setVec3("pointLights[2].specular", 1.0f, 1.0f, 1.0f);
-        ourShader.setFloat("pointLights[2].constant", 1.0f);
-        ourShader.setFloat("pointLights[2].linear", 0.09f);
-        ourShader.setFloat("pointLights[2].quadratic", 0.032f);
-  
-        // View/projection transformations
-        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-        glm::mat4 view = camera.GetViewMatrix();
-        ourShader.setMat4("projection", projection);
-        ourShader.setMat4("view", view);
-
-        // Render the loaded model
-        glm::mat4 model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(0.0f, 0.0f, 0.0f)); 
-        model = glm::scale(model, glm::vec3(1.0f, 1.0f, 1.0f));
-        ourShader.setMat4("model", model);
-        ourModel.Draw(ourShader);
+        if (crowdMode)
+        {
+            // Render the whole crowd: one instanced draw per mesh, animation is only texture fetches
+            crowdShader.use();
+            crowdShader.setVec3("lightDirection", glm::vec3(-0.2f, -1.0f, -0.3f));
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, VAT_INSTANCE_BINDING, crowdBuffer.Id());
+            crowdAnimation.Draw(crowdShader, ourModel, static_cast<unsigned int>(crowd.size()));
+        }
+        else if (gpuDrivenMode)
+        {
+            if (!gpuField)
+            {
+                std::vector<glm::mat4> transforms;
+                transforms.reserve(GPU_FIELD_SIDE * GPU_FIELD_SIDE);
+                for (int z = 0; z < GPU_FIELD_SIDE; z++)
+                    for (int x = 0; x < GPU_FIELD_SIDE; x++)
+                    {
+                        glm::mat4 transform = glm::translate(glm::mat4(1.0f), glm::vec3((x - GPU_FIELD_SIDE / 2) * FIELD_SPACING, 0.0f, -z * FIELD_SPACING));
+                        transforms.push_back(glm::rotate(transform, unitDist(rng) * glm::two_pi<float>(), glm::vec3(0.0f, 1.0f, 0.0f)));
+                    }
+                gpuField = std::make_unique<GpuCulling>(ourModel, transforms);
+            }
+
+            auto drawField = [&]()
+            {
+                if (depthPrepass)
+                {
+                    indirectDepthShader.use();
+                    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+                    gpuField->Draw(indirectDepthShader, DEPTH_PASS);
+                    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+                    glDepthFunc(GL_LEQUAL);
+                    glDepthMask(GL_FALSE);
+                }
+                indirectShader.use();
+                indirectShader.setFloat("shininess", 32.0f);
+                gpuField->Draw(indirectShader, COLOR_PASS);
+                glDepthFunc(GL_LESS);
+                glDepthMask(GL_TRUE);
+            };
+
+            // the CPU only issues the dispatches and one indirect draw per mesh, for any number of instances
+            gpuFieldTimer.Begin();
+            if (occlusionCulling)
+            {
+                // early: last frame's visible set lays down the occluders; late: whatever the pyramid can't rule out
+                hiZ.BeginScene(width, height);
+                gpuField->Cull(cullShader, frustum, CULL_EARLY);
+                drawField();
+                hiZ.Build(hiZShader);
+                gpuField->CullOccluded(cullShader, frustum, projection * view, hiZ);
+                drawField();
+                hiZ.EndScene();
+            }
+            else
+            {
+                gpuField->Cull(cullShader, frustum);
+                drawField();
+            }
+            gpuFieldTimer.End();
+            occlusionMilliseconds[occlusionCulling] = gpuFieldTimer.Milliseconds();
+
+            if (++frameCount % 300 == 0 || cullingReportRequested)
+            {
+                if (occlusionCulling)
+                {
+                    GpuCulling::Stats stats = gpuField->ReadStats();
+                    std::cout << "HIZ CULLING visible " << stats.occlusionVisible << " / " << stats.frustumVisible << " in frustum / "
+                              << gpuField->InstanceCount() << " instances, " << stats.frustumVisible - stats.occlusionVisible << " occluded" << std::endl;
+                }
+                else
+                    std::cout << "GPU CULLING visible " << gpuField->ReadVisibleCount() << " / " << gpuField->InstanceCount() << " instances" << std::endl;
+                std::cout << "GPU field time: " << occlusionMilliseconds[1] << " ms with occlusion culling, " << occlusionMilliseconds[0]
+                          << " ms without (saved " << occlusionMilliseconds[0] - occlusionMilliseconds[1] << " ms)" << std::endl;
+                if (clusteredShading)
+                {
+                    LightListOverflow overflow = pointLightBuffer.ReadOverflow();
+                    std::cout << "LIGHT LISTS dropped " << overflow.clusterLights << " lights in " << overflow.clusters << " full clusters (max "
+                              << MAX_LIGHTS_PER_CLUSTER << ")" << std::endl;
+                }
+            }
+            cullingReportRequested = false;
+        }
+        else
+        {
+            glm::mat4 model = glm::mat4(1.0f);
+            model = glm::translate(model, glm::vec3(0.0f, 0.0f, 0.0f)); 
+            model = glm::scale(model, glm::vec3(1.0f, 1.0f, 1.0f));
+
+            bool deferredShading = renderPath == DEFERRED_RENDERING;
+            bool visibilityShading = renderPath == VISIBILITY_BUFFER_RENDERING;
+            // HLOD proxies are not in the geometry arena, the visibility buffer draws the field object by object
+            bool hlodActive = hlodEnabled && !visibilityShading;
+
+            // visibility is decided once per frame and shared by the depth and color passes
+            culledTested = culledVisible = 0;
+            if (fieldMode && !hlodActive)
+            {
+                if (frustumCulling)
+                    FrustumCulling::Cull(frustum, fieldSpheres, visibleObjects);
+                else
+                {
+                    visibleObjects.resize(field.size());
+                    for (uint32_t i = 0; i < visibleObjects.size(); i++)
+                        visibleObjects[i] = i;
+                }
+                if (softwareOcclusion)
+                {
+                    // the nearest survivors of the frustum test are the most likely to hide the rest
+                    occluderObjects = visibleObjects;
+                    auto distance = [&](uint32_t index) { return glm::distance(camera.Position, glm::vec3(field[index].transform[3])); };
+                    size_t occluderCount = std::min<size_t>(OCCLUDER_COUNT, occluderObjects.size());
+                    std::partial_sort(occluderObjects.begin(), occluderObjects.begin() + occluderCount, occluderObjects.end(),
+                                      [&](uint32_t a, uint32_t b) { return distance(a) < distance(b); });
+                    occlusionRasterizer.Begin(projection * view);
+                    for (size_t i = 0; i < occluderCount; i++)
+                        occlusionRasterizer.AddOccluder(fieldOccluder, field[occluderObjects[i]].transform);
+                    occlusionRasterizer.Rasterize();
+
+                    size_t kept = 0;
+                    for (uint32_t index : visibleObjects)
+                        if (occlusionRasterizer.IsVisible(field[index].model->bounds, field[index].transform))
+                            visibleObjects[kept++] = index;
+                    visibleObjects.resize(kept);
+                }
+                if (hardwareOcclusion)
+                {
+                    // only what was visible last frame is drawn up front, the rest waits for its box queries
+                    fieldQueries.BeginFrame();
+                    queryVisibleObjects.clear();
+                    queryHiddenObjects.clear();
+                    for (uint32_t index : visibleObjects)
+                        (fieldQueries.WasVisible(index, camera.Position) ? queryVisibleObjects : queryHiddenObjects).push_back(index);
+                }
+                culledTested = static_cast<unsigned int>(field.size());
+                culledVisible = static_cast<unsigned int>(visibleObjects.size());
+            }
+            else if (!fieldMode)
+            {
+                visibleMeshes.clear();
+                for (uint32_t i = 0; i < ourModel.meshes.size(); i++)
+                    if (!frustumCulling || frustum.Intersects(ourModel.meshes[i].bounds.Transformed(model)))
+                        visibleMeshes.push_back(i);
+                culledTested = static_cast<unsigned int>(ourModel.meshes.size());
+                culledVisible = static_cast<unsigned int>(visibleMeshes.size());
+            }
+
+            // the visibility buffer's color pass writes ids, through the arena's draw table
+            auto drawFieldObject = [&](Shader& shader, RenderPass pass, uint32_t index)
+            {
+                const SceneObject& object = field[index];
+                if (visibilityShading && pass == COLOR_PASS)
+                {
+                    visibility.Draw(shader, *object.model, object.transform);
+                    return;
+                }
+                shader.setMat4("model", object.transform);
+                object.model->Draw(shader, pass);
+            };
+
+            auto drawScene = [&](Shader& shader, RenderPass pass)
+            {
+                if (!fieldMode && visibilityShading && pass == COLOR_PASS)
+                    visibility.Draw(shader, ourModel, model, &visibleMeshes);
+                else if (!fieldMode)
+                {
+                    shader.setMat4("model", model);
+                    for (uint32_t index : visibleMeshes)
+                        ourModel.meshes[index].Draw(shader, pass);
+                }
+                else if (hlodActive)
+                    fieldHLOD.Draw(shader, field, camera.Position, pass);
+                else
+                {
+                    auto drawObject = [&](uint32_t index) { drawFieldObject(shader, pass, index); };
+                    if (!hardwareOcclusion)
+                        for (uint32_t index : visibleObjects)
+                            drawObject(index);
+                    else if (pass == DEPTH_PASS)
+                        for (uint32_t index : queryVisibleObjects)
+                            drawObject(index);
+                    else
+                        for (uint32_t index : queryVisibleObjects)
+                            fieldQueries.DrawVisible(index, drawObject);
+                }
+            };
+
+            bool fieldDrawn = fieldMode && !hlodActive;
+            // deferred: the same passes fill the G-buffer instead of shading; visibility buffer: they write ids
+            Shader& sceneShader = visibilityShading ? visibilityShader : deferredShading ? gBufferShader : ourShader;
+            sceneTimer.Begin();
+            if (deferredShading)
+                deferred.BeginGeometry(width, height);
+            else if (visibilityShading)
+                visibility.BeginGeometry(width, height);
+
+            // the id pass is already position only and writes 4 bytes a fragment, a prepass would only repeat it
+            if (depthPrepass && !visibilityShading)
+            {
+                // Lay down depth only, then shade each visible pixel once
+                depthShader.use();
+                glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+                drawScene(depthShader, DEPTH_PASS);
+                glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+                glDepthFunc(GL_LEQUAL);
+                glDepthMask(GL_FALSE);
+            }
+
+            // Render the loaded model
+            sceneShader.use();
+            drawScene(sceneShader, COLOR_PASS);
+
+            glDepthFunc(GL_LESS);
+            glDepthMask(GL_TRUE);
+
+            if (fieldDrawn && hardwareOcclusion)
+            {
+                // against the depth of everything drawn so far; the draws are skipped on the GPU if the boxes fail
+                fieldQueries.DrawHidden(queryHiddenObjects, depthShader, sceneShader, [&](uint32_t index)
+                {
+                    drawFieldObject(sceneShader, COLOR_PASS, index);
+                });
+            }
+
+            if (deferredShading)
+            {
+                deferred.Light(deferredLightingShader, projection, view, 32.0f, glm::vec4(0.05f, 0.05f, 0.05f, 1.0f));
+                deferred.BeginForward();
+            }
+            else if (visibilityShading)
+            {
+                visibility.Resolve(visibilityResolveShader, projection, view, 32.0f, glm::vec4(0.05f, 0.05f, 0.05f, 1.0f));
+                visibility.BeginForward();
+            }
+
+            // Transparent cards last, back to front, over the lit opaque scene and tested against its depth
+            grassOrder.clear();
+            for (size_t i = 0; i < grassCards.size(); i++)
+                grassOrder.push_back({ glm::distance(camera.Position, glm::vec3(grassCards[i][3])), i });
+            std::sort(grassOrder.begin(), grassOrder.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            glDepthMask(GL_FALSE);
+            transparentShader.use();
+            transparentShader.setInt("texture1", 0);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, grassTexture.Id());
+            glBindVertexArray(grassVertexArray.Id());
+            for (const auto& card : grassOrder)
+            {
+                transparentShader.setMat4("model", grassCards[card.second]);
+                glDrawArrays(GL_TRIANGLES, 0, 6);
+            }
+            glBindVertexArray(0);
+            glDepthMask(GL_TRUE);
+            glDisable(GL_BLEND);
+
+            if (deferredShading)
+                deferred.EndFrame();
+            else if (visibilityShading)
+                visibility.EndFrame();
+            sceneTimer.End();
+            renderPathMilliseconds[renderPath] = sceneTimer.Milliseconds();
+            if (fieldDrawn)
+                queryMilliseconds[hardwareOcclusion] = sceneTimer.Milliseconds();
+
+            bool softwareOcclusionActive = softwareOcclusion && fieldMode && !hlodActive;
+            if (softwareOcclusionActive && occlusionDebugView)
+            {
+                occlusionDebug.Draw(occlusionRasterizer, zNear, zFar, 0, 0, width / 3, width / 3 * occlusionRasterizer.Height() / occlusionRasterizer.Width());
+            }
+
+            if (culledTested > 0 && (++frameCount % 300 == 0 || cullingReportRequested))
+            {
+                std::cout << "CULLING visible " << culledVisible << " / " << culledTested << (fieldMode ? " objects" : " meshes") << std::endl;
+                if (softwareOcclusionActive)
+                {
+                    const OcclusionRasterizer::Stats& stats = occlusionRasterizer.GetStats();
+                    std::cout << "SOFTWARE OCCLUSION occluded " << stats.occluded << " / " << stats.tested << " tested, "
+                              << stats.rasterizedTriangles << " / " << stats.occluderTriangles << " occluder triangles, setup "
+                              << stats.setupMilliseconds << " ms, raster " << stats.rasterMilliseconds << " ms on "
+                              << occlusionRasterizer.ThreadCount() << " threads" << std::endl;
+                }
+                if (fieldDrawn && hardwareOcclusion)
+                {
+                    const OcclusionQueries::Stats& stats = fieldQueries.GetStats();
+                    std::cout << "OCCLUSION QUERIES drawn " << stats.visibleDrawn << " visible + " << stats.conditionalDraws << " conditional, "
+                              << stats.objectQueries << " object queries, " << stats.batchQueries << " batched box queries, "
+                              << stats.resultsNotReady << " results not ready" << std::endl;
+                }
+                if (fieldDrawn)
+                    std::cout << "Field GPU time: " << queryMilliseconds[1] << " ms with occlusion queries, " << queryMilliseconds[0]
+                              << " ms without (HiZ on the GPU-driven field: " << occlusionMilliseconds[1] << " ms)" << std::endl;
+                std::cout << "RENDER PATH " << RENDER_PATH_NAMES[renderPath] << ", " << pointLightBuffer.Count() << " point lights"
+                          << (clusteredShading ? " (forward clustered)" : " (forward every light per fragment)") << ": forward "
+                          << renderPathMilliseconds[FORWARD_RENDERING] << " ms, deferred " << renderPathMilliseconds[DEFERRED_RENDERING]
+                          << " ms, visibility buffer " << renderPathMilliseconds[VISIBILITY_BUFFER_RENDERING] << " ms" << std::endl;
+                // size of the targets written by the geometry pass; forward only writes the framebuffer
+                std::cout << "Target footprint: G-buffer " << GBUFFER_BYTES_PER_PIXEL << " bytes/pixel (" << deferred.GBufferBytes() / (1024.0 * 1024.0)
+                          << " MB), visibility buffer " << VISIBILITY_BYTES_PER_PIXEL << " bytes/pixel (" << visibility.TargetBytes() / (1024.0 * 1024.0)
+                          << " MB, arena " << visibility.ArenaBytes() / (1024.0 * 1024.0) << " MB)" << std::endl;
+                // what lighting reads back from them: deferred reads the G-buffer once, every visibility material pass reads ids and depth again
+                std::cout << "Target reads per frame: deferred " << deferred.GBufferBytes() / (1024.0 * 1024.0) << " MB, visibility buffer "
+                          << visibility.ResolveReadBytes() / (1024.0 * 1024.0) << " MB (" << visibility.MaterialPasses()
+                          << " material passes, each also redoing the tile light culling)" << std::endl;
+                // the light lists have a fixed size, what did not fit was dropped from the lighting
+                LightListOverflow overflow = pointLightBuffer.ReadOverflow();
+                std::cout << "LIGHT LISTS dropped " << overflow.clusterLights << " lights in " << overflow.clusters << " full clusters (max "
+                          << MAX_LIGHTS_PER_CLUSTER << "), " << overflow.tileLights << " lights in " << overflow.tiles << " full tiles (max " << MAX_TILE_LIGHTS << ")" << std::endl;
+                if (visibilityShading)
+                {
+                    const VisibilityBuffer::Stats& stats = visibility.GetStats();
+                    std::cout << "VISIBILITY BUFFER " << stats.draws << " draws, " << stats.materialPasses << " material passes, "
+                              << stats.droppedDraws << " draws over the id limit" << std::endl;
+                }
+            }
+            cullingReportRequested = false;
+        }
 
         glfwSwapBuffers(window);
         glfwPollEvents();
+        // delete whatever was released this frame (shader reloads, streamed out models)
+        GpuResources::Collect();
     }
 
+    GpuResources::Report();
     glfwTerminate();
     return 0;
 }
@@ -161,6 +759,132 @@ void processInput(GLFWwindow* window)
         camera.ProcessKeyboard(LEFT, deltaTime);
     if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
         camera.ProcessKeyboard(RIGHT, deltaTime);
+
+    bool crowdKeyDown = glfwGetKey(window, GLFW_KEY_C) == GLFW_PRESS;
+    if (crowdKeyDown && !crowdKeyDownLastFrame)
+    {
+        crowdMode = !crowdMode;
+        std::cout << "Crowd mode: " << (crowdMode ? "ON (" + std::to_string(CROWD_SIDE * CROWD_SIDE) + " instances)" : std::string("OFF")) << std::endl;
+    }
+    crowdKeyDownLastFrame = crowdKeyDown;
+
+    bool fieldKeyDown = glfwGetKey(window, GLFW_KEY_F) == GLFW_PRESS;
+    if (fieldKeyDown && !fieldKeyDownLastFrame)
+    {
+        fieldMode = !fieldMode;
+        lightsDirty = true;
+        std::cout << "Field mode: " << (fieldMode ? "ON (" + std::to_string(FIELD_SIDE * FIELD_SIDE) + " objects)" : std::string("OFF")) << std::endl;
+    }
+    fieldKeyDownLastFrame = fieldKeyDown;
+
+    bool hlodKeyDown = glfwGetKey(window, GLFW_KEY_H) == GLFW_PRESS;
+    if (hlodKeyDown && !hlodKeyDownLastFrame)
+    {
+        hlodEnabled = !hlodEnabled;
+        std::cout << "HLOD: " << (hlodEnabled ? "ON" : "OFF") << std::endl;
+    }
+    hlodKeyDownLastFrame = hlodKeyDown;
+
+    bool reloadKeyDown = glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS;
+    if (reloadKeyDown && !reloadKeyDownLastFrame)
+    {
+        reloadRequested = true;
+        std::cout << "Reloading shaders" << (Shader::ParallelCompileSupported() ? "" : " (no parallel compile support, the swap will wait for the driver)") << std::endl;
+    }
+    reloadKeyDownLastFrame = reloadKeyDown;
+
+    bool prepassKeyDown = glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS;
+    if (prepassKeyDown && !prepassKeyDownLastFrame)
+    {
+        depthPrepass = !depthPrepass;
+        std::cout << "Depth prepass: " << (depthPrepass ? "ON" : "OFF") << std::endl;
+    }
+    prepassKeyDownLastFrame = prepassKeyDown;
+
+    bool cullingKeyDown = glfwGetKey(window, GLFW_KEY_K) == GLFW_PRESS;
+    if (cullingKeyDown && !cullingKeyDownLastFrame)
+    {
+        frustumCulling = !frustumCulling;
+        cullingReportRequested = true;
+        std::cout << "Frustum culling: " << (frustumCulling ? std::string("ON (") + FrustumCulling::PathName(FrustumCulling::Avx2Supported() ? FrustumCulling::AVX2 : FrustumCulling::SSE) + ")" : std::string("OFF")) << std::endl;
+    }
+    cullingKeyDownLastFrame = cullingKeyDown;
+
+    bool benchmarkKeyDown = glfwGetKey(window, GLFW_KEY_B) == GLFW_PRESS;
+    if (benchmarkKeyDown && !benchmarkKeyDownLastFrame)
+        benchmarkRequested = true;
+    benchmarkKeyDownLastFrame = benchmarkKeyDown;
+
+    bool gpuDrivenKeyDown = glfwGetKey(window, GLFW_KEY_G) == GLFW_PRESS;
+    if (gpuDrivenKeyDown && !gpuDrivenKeyDownLastFrame)
+    {
+        gpuDrivenMode = !gpuDrivenMode;
+        cullingReportRequested = true;
+        std::cout << "GPU-driven field: " << (gpuDrivenMode ? "ON (" + std::to_string(GPU_FIELD_SIDE * GPU_FIELD_SIDE) + " instances)" : std::string("OFF")) << std::endl;
+    }
+    gpuDrivenKeyDownLastFrame = gpuDrivenKeyDown;
+
+    bool occlusionKeyDown = glfwGetKey(window, GLFW_KEY_O) == GLFW_PRESS;
+    if (occlusionKeyDown && !occlusionKeyDownLastFrame)
+    {
+        occlusionCulling = !occlusionCulling;
+        cullingReportRequested = true;
+        std::cout << "HiZ occlusion culling: " << (occlusionCulling ? "ON" : "OFF") << std::endl;
+    }
+    occlusionKeyDownLastFrame = occlusionKeyDown;
+
+    bool softwareOcclusionKeyDown = glfwGetKey(window, GLFW_KEY_X) == GLFW_PRESS;
+    if (softwareOcclusionKeyDown && !softwareOcclusionKeyDownLastFrame)
+    {
+        softwareOcclusion = !softwareOcclusion;
+        cullingReportRequested = true;
+        std::cout << "Software occlusion culling: " << (softwareOcclusion ? "ON" : "OFF") << (hlodEnabled ? " (field only, with HLOD off)" : "") << std::endl;
+    }
+    softwareOcclusionKeyDownLastFrame = softwareOcclusionKeyDown;
+
+    bool occlusionDebugKeyDown = glfwGetKey(window, GLFW_KEY_V) == GLFW_PRESS;
+    if (occlusionDebugKeyDown && !occlusionDebugKeyDownLastFrame)
+    {
+        occlusionDebugView = !occlusionDebugView;
+        std::cout << "Occlusion buffer view: " << (occlusionDebugView ? "ON" : "OFF") << std::endl;
+    }
+    occlusionDebugKeyDownLastFrame = occlusionDebugKeyDown;
+
+    bool hardwareOcclusionKeyDown = glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS;
+    if (hardwareOcclusionKeyDown && !hardwareOcclusionKeyDownLastFrame)
+    {
+        hardwareOcclusion = !hardwareOcclusion;
+        cullingReportRequested = true;
+        std::cout << "Hardware occlusion queries: " << (hardwareOcclusion ? "ON" : "OFF") << (hlodEnabled ? " (field only, with HLOD off)" : "") << std::endl;
+    }
+    hardwareOcclusionKeyDownLastFrame = hardwareOcclusionKeyDown;
+
+    bool renderPathKeyDown = glfwGetKey(window, GLFW_KEY_M) == GLFW_PRESS;
+    if (renderPathKeyDown && !renderPathKeyDownLastFrame)
+    {
+        renderPath = static_cast<RenderPath>((renderPath + 1) % RENDER_PATH_COUNT);
+        cullingReportRequested = true;
+        std::cout << "Render path: " << RENDER_PATH_NAMES[renderPath] << std::endl;
+    }
+    renderPathKeyDownLastFrame = renderPathKeyDown;
+
+    bool lightCountKeyDown = glfwGetKey(window, GLFW_KEY_L) == GLFW_PRESS;
+    if (lightCountKeyDown && !lightCountKeyDownLastFrame)
+    {
+        lightCountStep = (lightCountStep + 1) % LIGHT_COUNT_STEPS;
+        lightsDirty = true;
+        std::cout << "Point lights: " << LIGHT_COUNTS[lightCountStep] << std::endl;
+    }
+    lightCountKeyDownLastFrame = lightCountKeyDown;
+
+    bool clusteredShadingKeyDown = glfwGetKey(window, GLFW_KEY_T) == GLFW_PRESS;
+    if (clusteredShadingKeyDown && !clusteredShadingKeyDownLastFrame)
+    {
+        clusteredShading = !clusteredShading;
+        cullingReportRequested = true;
+        std::cout << "Clustered forward shading: " << (clusteredShading ? "ON" : "OFF") << std::endl;
+    }
+    clusteredShadingKeyDownLastFrame = clusteredShadingKeyDown;
 }
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <functional>
+
+#ifdef _DEBUG
+#include <mutex>
+#include <unordered_map>
+#endif
+
+// 64-bit FNV-1a, also used by Shader for its uniform table and program cache keys. 0 is reserved for "no id".
+// Passing a previous hash as the seed chains several strings into one key.
+constexpr uint64_t HashString(std::string_view text, uint64_t hash = 14695981039346656037ull)
+{
+    for (char c : text)
+        hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+    return hash ? hash : 1;
+}
+
+// Hashed string used for uniform names, texture type tags and asset paths: compares and copies as an
+// integer. Literals hash at compile time ("texture_diffuse"_sid); debug builds remember the text of every
+// literal and of every string hashed at runtime so Name() can turn an id back into text.
+struct StringId
+{
+    uint64_t value = 0;
+
+    constexpr StringId() = default;
+    constexpr explicit StringId(uint64_t hash) : value(hash) {}
+
+    constexpr explicit StringId(std::string_view text) : value(HashString(text))
+    {
+        if (!std::is_constant_evaluated())
+            Register(text, value);
+    }
+
+    explicit StringId(const std::string& text) : StringId(std::string_view(text)) {}
+
+    constexpr bool IsValid() const { return value != 0; }
+    constexpr bool operator==(const StringId& other) const { return value == other.value; }
+    constexpr bool operator!=(const StringId& other) const { return value != other.value; }
+
+    // Runtime strings register themselves in the constructor, literals through StringIdLiteralName below
+    static void Register(std::string_view text, uint64_t hash)
+    {
+#ifdef _DEBUG
+        std::lock_guard<std::mutex> lock(tableMutex());
+        table().emplace(hash, std::string(text));
+#else
+        (void)text;
+        (void)hash;
+#endif
+    }
+
+    static std::string Name(StringId id)
+    {
+#ifdef _DEBUG
+        std::lock_guard<std::mutex> lock(tableMutex());
+        auto found = table().find(id.value);
+        if (found != table().end())
+            return found->second;
+#endif
+        return "#" + std::to_string(id.value);
+    }
+
+private:
+#ifdef _DEBUG
+    static std::unordered_map<uint64_t, std::string>& table()
+    {
+        static std::unordered_map<uint64_t, std::string> names;
+        return names;
+    }
+
+    static std::mutex& tableMutex()
+    {
+        static std::mutex mutex;
+        return mutex;
+    }
+#endif
+};
+
+// Literal text as a template argument, so every distinct "..."_sid gets its own instantiation
+template <size_t N>
+struct StringIdLiteral
+{
+    char text[N] = {};
+
+    constexpr StringIdLiteral(const char (&literal)[N])
+    {
+        for (size_t i = 0; i < N; i++)
+            text[i] = literal[i];
+    }
+
+    constexpr std::string_view View() const { return std::string_view(text, N - 1); }
+};
+
+#ifdef _DEBUG
+// Dynamically initialized once per literal at startup, even when the id itself was folded at compile time
+template <StringIdLiteral Text>
+inline const bool StringIdLiteralName = (StringId::Register(Text.View(), HashString(Text.View())), true);
+#endif
+
+template <StringIdLiteral Text>
+constexpr StringId operator""_sid()
+{
+#ifdef _DEBUG
+    // taking the address odr-uses the registration without reading it, so this stays a constant expression
+    (void)&StringIdLiteralName<Text>;
+#endif
+    return StringId(HashString(Text.View()));
+}
+
+template <>
+struct std::hash<StringId>
+{
+    size_t operator()(const StringId& id) const noexcept
+    {
+        return static_cast<size_t>(id.value);
+    }
+};
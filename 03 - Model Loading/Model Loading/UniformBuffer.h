@@ -0,0 +1,65 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "GpuResources.h"
+
+// Binding points shared by every program, shaders declare the blocks as layout (std140, binding = N)
+#define FRAME_UBO_BINDING 0
+#define LIGHTS_UBO_BINDING 1
+
+// std140 mirrors of the Frame and Lights blocks. Only vec4/mat4 members, so the C++ layout needs no padding.
+struct FrameUniforms
+{
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::vec4 viewPos;
+    // x = time, y = delta time
+    glm::vec4 time;
+};
+
+struct DirLightUniforms
+{
+    glm::vec4 direction;
+    glm::vec4 ambient;
+    glm::vec4 diffuse;
+    glm::vec4 specular;
+};
+
+// point lights are in a shader storage buffer, see PointLights.h
+struct LightUniforms
+{
+    DirLightUniforms dirLight;
+    // x = point lights in use, y = 1 to shade only the lights listed for the fragment's cluster
+    glm::ivec4 lightCount;
+    // x = depth slice scale, y = depth slice bias, zw = cluster tile size in pixels (ClusteredLights::Params)
+    glm::vec4 clusterParams;
+};
+
+static_assert(sizeof(FrameUniforms) == 160, "FrameUniforms must match the std140 Frame block");
+static_assert(sizeof(LightUniforms) == 64 + 32, "LightUniforms must match the std140 Lights block");
+
+// A uniform buffer bound once to a fixed binding point, every program declaring the block reads it
+template <typename T>
+class UniformBuffer
+{
+public:
+    UniformBuffer(unsigned int binding) : buffer(GpuResources::CreateBuffer())
+    {
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer.Id());
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(T), nullptr, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glBindBufferBase(GL_UNIFORM_BUFFER, binding, buffer.Id());
+    }
+
+    void Update(const T& data)
+    {
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer.Id());
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(T), &data);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+private:
+    SharedBuffer buffer;
+};
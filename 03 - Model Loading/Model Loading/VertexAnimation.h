@@ -0,0 +1,312 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+// ASSIMP
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+
+#include "Model.h"
+#include "Shader.h"
+#include "GpuResources.h"
+
+#include <string>
+#include <iostream>
+#include <map>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+// Vertex animation textures (VAT).
+// Every animation of a skinned Model is sampled once at load time: the skinned position and normal of
+// every vertex, for every frame, is written into a float texture. At draw time the vertex shader only
+// does two texelFetch per attribute, so a crowd of thousands of animated instances costs one instanced
+// draw call per mesh, independent of the number of bones or instances.
+//
+// Texture layout: texel (frame * vertexCount + vertex), wrapped row by row at VAT_TEXTURE_WIDTH.
+// The vertex index is the global one: meshBaseVertex[mesh] + gl_VertexID.
+
+#define VAT_TEXTURE_WIDTH 4096
+#define VAT_POSITION_UNIT 8
+#define VAT_NORMAL_UNIT 9
+#define VAT_INSTANCE_BINDING 1
+#define VAT_CLIP_BINDING 2
+
+struct VatClip {
+    std::string name;
+    int firstFrame;
+    int frameCount;
+    float framesPerSecond;
+};
+
+// Matches the std430 layout of CrowdInstance in vat.vs
+struct CrowdInstance {
+    glm::mat4 model;
+    // x = clip index, y = time offset (seconds), z = playback speed, w = unused
+    glm::vec4 animation;
+};
+
+class VertexAnimation
+{
+public:
+    SharedTexture positionTexture;
+    SharedTexture normalTexture;
+    SharedBuffer clipBuffer;
+    int vertexCount = 0;
+    int frameCount = 0;
+    std::vector<VatClip> clips;
+    std::vector<int> meshBaseVertex;
+
+    // Re-imports the file only for its node hierarchy and animations; vertices and bone weights come from model.
+    VertexAnimation(std::string const& path, Model& model, float sampleRate = 30.0f)
+    {
+        bake(path, model, sampleRate);
+    }
+
+    // One instanced draw per mesh; instance data must already be bound at VAT_INSTANCE_BINDING.
+    // The clock comes from the Frame block (time.x), so it must be current for this frame.
+    void Draw(Shader& shader, Model& model, unsigned int instanceCount)
+    {
+        shader.use();
+        shader.setInt("positionTex", VAT_POSITION_UNIT);
+        shader.setInt("normalTex", VAT_NORMAL_UNIT);
+        shader.setInt("vertexCount", vertexCount);
+        shader.setInt("textureWidth", VAT_TEXTURE_WIDTH);
+
+        glActiveTexture(GL_TEXTURE0 + VAT_POSITION_UNIT);
+        glBindTexture(GL_TEXTURE_2D, positionTexture.Id());
+        glActiveTexture(GL_TEXTURE0 + VAT_NORMAL_UNIT);
+        glBindTexture(GL_TEXTURE_2D, normalTexture.Id());
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, VAT_CLIP_BINDING, clipBuffer.Id());
+
+        for (unsigned int i = 0; i < model.meshes.size(); i++)
+        {
+            shader.setInt("baseVertex", meshBaseVertex[i]);
+            model.meshes[i].DrawInstanced(shader, instanceCount);
+        }
+    }
+
+private:
+    const aiScene* scene = nullptr;
+    glm::mat4 globalInverseTransform = glm::mat4(1.0f);
+
+    void bake(std::string const& path, Model& model, float sampleRate)
+    {
+        // global vertex numbering across all meshes of the model
+        for (unsigned int i = 0; i < model.meshes.size(); i++)
+        {
+            meshBaseVertex.push_back(vertexCount);
+            vertexCount += static_cast<int>(model.meshes[i].GetVertexCount());
+            if (model.meshes[i].vertices.empty())
+                std::cout << "WARNING::VAT::mesh " << i << " has no CPU vertex data (zero-copy import), it will not animate" << std::endl;
+        }
+
+        Assimp::Importer import;
+        scene = import.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_LimitBoneWeights);
+        if (!scene || !scene->mRootNode)
+        {
+            std::cout << "ERROR::VAT::" << import.GetErrorString() << std::endl;
+            scene = nullptr;
+        }
+        else
+        {
+            globalInverseTransform = glm::inverse(AssimpToGlm(scene->mRootNode->mTransformation));
+        }
+
+        // frame list: every animation is a clip, a static model gets a single bind pose frame
+        std::vector<std::pair<const aiAnimation*, double>> frames;
+        unsigned int animationCount = (scene && model.boneCounter > 0) ? scene->mNumAnimations : 0;
+        for (unsigned int a = 0; a < animationCount; a++)
+        {
+            const aiAnimation* animation = scene->mAnimations[a];
+            double ticksPerSecond = animation->mTicksPerSecond != 0.0 ? animation->mTicksPerSecond : 25.0;
+            double seconds = animation->mDuration / ticksPerSecond;
+            int clipFrames = std::max(1, static_cast<int>(std::ceil(seconds * sampleRate)));
+
+            clips.push_back({ animation->mName.C_Str(), static_cast<int>(frames.size()), clipFrames, sampleRate });
+            // a zero length clip has a single frame at tick 0, fmod by 0 would be NaN
+            for (int f = 0; f < clipFrames; f++)
+                frames.push_back({ animation, animation->mDuration > 0.0 ? std::fmod(f / sampleRate * ticksPerSecond, animation->mDuration) : 0.0 });
+        }
+        if (clips.empty())
+        {
+            clips.push_back({ "bind", 0, 1, sampleRate });
+            frames.push_back({ nullptr, 0.0 });
+        }
+
+        // the texture height is frames * vertices / VAT_TEXTURE_WIDTH, frames past the driver limit are cut off
+        GLint maxTextureSize = 0;
+        glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+        size_t maxFrames = vertexCount > 0 ? static_cast<size_t>(maxTextureSize) * VAT_TEXTURE_WIDTH / vertexCount : frames.size();
+        if (frames.size() > maxFrames)
+        {
+            maxFrames = std::max<size_t>(maxFrames, 1);
+            std::cout << "ERROR::VAT::" << frames.size() << " frames x " << vertexCount << " vertices exceed GL_MAX_TEXTURE_SIZE (" << maxTextureSize
+                      << "), keeping the first " << maxFrames << " frame(s)" << std::endl;
+            frames.resize(maxFrames);
+            // clips past the limit are dropped, the one crossing it is shortened
+            while (clips.size() > 1 && clips.back().firstFrame >= static_cast<int>(maxFrames))
+                clips.pop_back();
+            clips.back().frameCount = std::min(clips.back().frameCount, static_cast<int>(maxFrames) - clips.back().firstFrame);
+        }
+        frameCount = static_cast<int>(frames.size());
+
+        size_t texelCount = static_cast<size_t>(frameCount) * vertexCount;
+        int textureHeight = static_cast<int>((texelCount + VAT_TEXTURE_WIDTH - 1) / VAT_TEXTURE_WIDTH);
+        std::vector<glm::vec4> positions(static_cast<size_t>(textureHeight) * VAT_TEXTURE_WIDTH, glm::vec4(0.0f));
+        std::vector<glm::vec4> normals(positions.size(), glm::vec4(0.0f));
+
+        std::vector<glm::mat4> boneMatrices(std::max(model.boneCounter, 1), glm::mat4(1.0f));
+        for (int f = 0; f < frameCount; f++)
+        {
+            if (frames[f].first)
+            {
+                std::map<std::string, const aiNodeAnim*> channels;
+                for (unsigned int c = 0; c < frames[f].first->mNumChannels; c++)
+                    channels[frames[f].first->mChannels[c]->mNodeName.C_Str()] = frames[f].first->mChannels[c];
+                calculateBoneTransform(scene->mRootNode, channels, frames[f].second, glm::mat4(1.0f), model, boneMatrices);
+            }
+
+            size_t frameOffset = static_cast<size_t>(f) * vertexCount;
+            for (unsigned int m = 0; m < model.meshes.size(); m++)
+            {
+                const std::vector<Vertex>& vertices = model.meshes[m].vertices;
+                for (size_t v = 0; v < vertices.size(); v++)
+                {
+                    glm::mat4 skin = skinMatrix(vertices[v], boneMatrices, frames[f].first != nullptr);
+                    size_t texel = frameOffset + meshBaseVertex[m] + v;
+                    positions[texel] = skin * glm::vec4(vertices[v].Position, 1.0f);
+                    normals[texel] = glm::vec4(glm::normalize(glm::mat3(skin) * vertices[v].Normal), 0.0f);
+                }
+            }
+        }
+
+        positionTexture = createDataTexture(GL_RGBA32F, textureHeight, positions);
+        normalTexture = createDataTexture(GL_RGBA16F, textureHeight, normals);
+
+        std::vector<glm::vec4> clipData;
+        for (const VatClip& clip : clips)
+            clipData.push_back(glm::vec4(clip.firstFrame, clip.frameCount, clip.framesPerSecond, 0.0f));
+        clipBuffer = GpuResources::CreateBuffer();
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, clipBuffer.Id());
+        glBufferData(GL_SHADER_STORAGE_BUFFER, clipData.size() * sizeof(glm::vec4), clipData.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        std::cout << "VAT: baked " << clips.size() << " clip(s), " << frameCount << " frame(s) x " << vertexCount
+                  << " vertices into " << VAT_TEXTURE_WIDTH << "x" << textureHeight << " textures" << std::endl;
+        scene = nullptr;
+    }
+
+    glm::mat4 skinMatrix(const Vertex& vertex, const std::vector<glm::mat4>& boneMatrices, bool animated)
+    {
+        if (!animated)
+            return glm::mat4(1.0f);
+
+        glm::mat4 skin = glm::mat4(0.0f);
+        float totalWeight = 0.0f;
+        for (int i = 0; i < MAX_BONE_INFLUENCE; i++)
+        {
+            int id = vertex.m_BoneIDs[i];
+            if (id < 0 || id >= static_cast<int>(boneMatrices.size()))
+                continue;
+            skin += boneMatrices[id] * vertex.m_Weights[i];
+            totalWeight += vertex.m_Weights[i];
+        }
+        // vertices without weights follow the bind pose
+        return totalWeight > 0.0f ? skin : glm::mat4(1.0f);
+    }
+
+    void calculateBoneTransform(const aiNode* node, const std::map<std::string, const aiNodeAnim*>& channels, double tick,
+                                const glm::mat4& parentTransform, Model& model, std::vector<glm::mat4>& boneMatrices)
+    {
+        std::string nodeName = node->mName.C_Str();
+        glm::mat4 nodeTransform = AssimpToGlm(node->mTransformation);
+
+        auto channel = channels.find(nodeName);
+        if (channel != channels.end())
+            nodeTransform = sampleChannel(channel->second, tick);
+
+        glm::mat4 globalTransform = parentTransform * nodeTransform;
+
+        auto bone = model.boneInfoMap.find(nodeName);
+        if (bone != model.boneInfoMap.end())
+            boneMatrices[bone->second.id] = globalInverseTransform * globalTransform * bone->second.offset;
+
+        for (unsigned int i = 0; i < node->mNumChildren; i++)
+            calculateBoneTransform(node->mChildren[i], channels, tick, globalTransform, model, boneMatrices);
+    }
+
+    template <typename Key>
+    static unsigned int findKey(const Key* keys, unsigned int count, double tick)
+    {
+        for (unsigned int i = 0; i + 1 < count; i++)
+            if (tick < keys[i + 1].mTime)
+                return i;
+        return count > 1 ? count - 2 : 0;
+    }
+
+    template <typename Key>
+    static float keyFactor(const Key* keys, unsigned int index, unsigned int count, double tick)
+    {
+        if (count < 2)
+            return 0.0f;
+        double span = keys[index + 1].mTime - keys[index].mTime;
+        return span > 0.0 ? glm::clamp(static_cast<float>((tick - keys[index].mTime) / span), 0.0f, 1.0f) : 0.0f;
+    }
+
+    static glm::mat4 sampleChannel(const aiNodeAnim* channel, double tick)
+    {
+        glm::vec3 position(0.0f);
+        if (channel->mNumPositionKeys > 0)
+        {
+            unsigned int i = findKey(channel->mPositionKeys, channel->mNumPositionKeys, tick);
+            unsigned int j = std::min(i + 1, channel->mNumPositionKeys - 1);
+            float t = keyFactor(channel->mPositionKeys, i, channel->mNumPositionKeys, tick);
+            const aiVector3D& a = channel->mPositionKeys[i].mValue;
+            const aiVector3D& b = channel->mPositionKeys[j].mValue;
+            position = glm::mix(glm::vec3(a.x, a.y, a.z), glm::vec3(b.x, b.y, b.z), t);
+        }
+
+        glm::quat rotation(1.0f, 0.0f, 0.0f, 0.0f);
+        if (channel->mNumRotationKeys > 0)
+        {
+            unsigned int i = findKey(channel->mRotationKeys, channel->mNumRotationKeys, tick);
+            unsigned int j = std::min(i + 1, channel->mNumRotationKeys - 1);
+            float t = keyFactor(channel->mRotationKeys, i, channel->mNumRotationKeys, tick);
+            const aiQuaternion& a = channel->mRotationKeys[i].mValue;
+            const aiQuaternion& b = channel->mRotationKeys[j].mValue;
+            rotation = glm::normalize(glm::slerp(glm::quat(a.w, a.x, a.y, a.z), glm::quat(b.w, b.x, b.y, b.z), t));
+        }
+
+        glm::vec3 scale(1.0f);
+        if (channel->mNumScalingKeys > 0)
+        {
+            unsigned int i = findKey(channel->mScalingKeys, channel->mNumScalingKeys, tick);
+            unsigned int j = std::min(i + 1, channel->mNumScalingKeys - 1);
+            float t = keyFactor(channel->mScalingKeys, i, channel->mNumScalingKeys, tick);
+            const aiVector3D& a = channel->mScalingKeys[i].mValue;
+            const aiVector3D& b = channel->mScalingKeys[j].mValue;
+            scale = glm::mix(glm::vec3(a.x, a.y, a.z), glm::vec3(b.x, b.y, b.z), t);
+        }
+
+        return glm::translate(glm::mat4(1.0f), position) * glm::mat4_cast(rotation) * glm::scale(glm::mat4(1.0f), scale);
+    }
+
+    static SharedTexture createDataTexture(GLenum internalFormat, int height, const std::vector<glm::vec4>& data)
+    {
+        SharedTexture texture = GpuResources::CreateTexture();
+        glBindTexture(GL_TEXTURE_2D, texture.Id());
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, VAT_TEXTURE_WIDTH, height, 0, GL_RGBA, GL_FLOAT, data.data());
+        // texelFetch only, no filtering between unrelated vertices
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        return texture;
+    }
+};
@@ -0,0 +1,319 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "Bounds.h"
+#include "ComputeShader.h"
+#include "GpuResources.h"
+#include "Model.h"
+#include "Shader.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+
+// Shader storage bindings of the geometry arena and the draw table, after POINT_LIGHT_BINDING
+#define VISIBILITY_VERTEX_BINDING 11
+#define VISIBILITY_TRIANGLE_BINDING 12
+#define VISIBILITY_DRAW_BINDING 13
+// local_size of visibility_resolve.cs, one workgroup culls lights for and shades one tile
+#define VISIBILITY_TILE_SIZE 16
+// a pixel's id is (draw + 1) << VISIBILITY_TRIANGLE_BITS | arena triangle, 0 where nothing was drawn;
+// the same split is #defined in visibility.fs and visibility_resolve.cs
+#define VISIBILITY_TRIANGLE_BITS 21
+#define VISIBILITY_MAX_TRIANGLES (1u << VISIBILITY_TRIANGLE_BITS)
+#define VISIBILITY_MAX_DRAWS ((1u << (32 - VISIBILITY_TRIANGLE_BITS)) - 1u)
+// R32UI ids, 32-bit depth
+#define VISIBILITY_BYTES_PER_PIXEL 8
+
+// std430 mirror of ArenaVertex in visibility_resolve.cs
+struct ArenaVertex {
+    // xyz = object space position, w = u
+    glm::vec4 positionU;
+    // xyz = object space normal, w = v
+    glm::vec4 normalV;
+};
+
+// std430 mirror of Draw in visibility_resolve.cs
+struct VisibilityDraw {
+    glm::mat4 model;
+    // transpose(inverse(model)) as in shader.vs, upper 3x3 used
+    glm::mat4 normalMatrix;
+};
+
+static_assert(sizeof(ArenaVertex) == 32, "ArenaVertex must match the std430 ArenaVertex struct");
+static_assert(sizeof(VisibilityDraw) == 128, "VisibilityDraw must match the std430 Draw struct");
+
+// Visibility buffer rendering. The geometry pass draws the position streams only and writes one 32-bit id per
+// pixel: which draw (a model placement) and which triangle of the geometry arena covers it, nothing else.
+// The arena is every registered model's vertices and triangles packed into two shader storage buffers, each
+// triangle carrying its material. The resolve pass then runs once per material over the screen: a pixel whose
+// triangle uses that material fetches the triangle's three vertices, transforms them with its draw's matrix,
+// recomputes perspective-correct barycentrics and their screen derivatives at the pixel centre, and
+// interpolates uv and normal from them (the derivatives pick the texture mip). Lighting is tiled as in
+// Deferred.h. Every covered pixel is shaded exactly once, and the only per-pixel traffic between the passes
+// is the id and the depth. Transparent surfaces are drawn forward into the lit image, as in DeferredRenderer.
+// Meshes need their CPU copy (Mesh::vertices/indices) to enter the arena; zero-copy glTF meshes are skipped.
+class VisibilityBuffer {
+public:
+    struct Stats {
+        unsigned int draws = 0;
+        unsigned int droppedDraws = 0;
+        unsigned int materialPasses = 0;
+    };
+
+    // Packs the model's meshes into the arena; Draw does it on a model's first use
+    void Add(const Model& model)
+    {
+        if (models.count(&model))
+            return;
+        std::vector<uint32_t>& firstTriangles = models[&model];
+        for (const Mesh& mesh : model.meshes)
+        {
+            size_t triangleCount = mesh.indices.size() / 3;
+            if (mesh.vertices.empty() || triangleCount == 0)
+            {
+                std::cout << "ERROR::VISIBILITY::MESH_WITHOUT_CPU_DATA skipped" << std::endl;
+                firstTriangles.push_back(NO_TRIANGLES);
+                continue;
+            }
+            if (triangles.size() + triangleCount > VISIBILITY_MAX_TRIANGLES)
+            {
+                std::cout << "ERROR::VISIBILITY::ARENA_FULL " << VISIBILITY_MAX_TRIANGLES << " triangles" << std::endl;
+                firstTriangles.push_back(NO_TRIANGLES);
+                continue;
+            }
+
+            uint32_t material = materialIndex(mesh.textures);
+            uint32_t baseVertex = static_cast<uint32_t>(vertices.size());
+            firstTriangles.push_back(static_cast<uint32_t>(triangles.size()));
+            for (const Vertex& vertex : mesh.vertices)
+                vertices.push_back({ glm::vec4(vertex.Position, vertex.TexCoords.x), glm::vec4(vertex.Normal, vertex.TexCoords.y) });
+            // same order as the index buffer, so gl_PrimitiveID of the mesh's draw is its offset in here
+            for (size_t i = 0; i < triangleCount; i++)
+                triangles.push_back({ baseVertex + mesh.indices[3 * i], baseVertex + mesh.indices[3 * i + 1], baseVertex + mesh.indices[3 * i + 2], material });
+        }
+        upload(vertexBuffer, vertices.data(), vertices.size() * sizeof(ArenaVertex));
+        upload(triangleBuffer, triangles.data(), triangles.size() * sizeof(glm::uvec4));
+        std::cout << "VISIBILITY::ARENA " << vertices.size() << " vertices, " << triangles.size() << " triangles, "
+                  << materials.size() << " materials, " << ArenaBytes() / (1024.0 * 1024.0) << " MB" << std::endl;
+    }
+
+    // Binds the id target, resized to the framebuffer when that changes, and starts a new draw table.
+    // A minimized window (0x0) keeps the old targets.
+    void BeginGeometry(int width, int height)
+    {
+        if ((width != targetWidth || height != targetHeight) && width > 0 && height > 0)
+            resize(width, height);
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, visibilityFramebuffer.Id());
+        const GLuint nothing[4] = { 0, 0, 0, 0 };
+        glClearBufferuiv(GL_COLOR, 0, nothing);
+        glClear(GL_DEPTH_BUFFER_BIT);
+        draws.clear();
+        stats = Stats();
+    }
+
+    // Draws one placement of the model into the id target, with depth.vs and visibility.fs.
+    // meshes: optional indices of the meshes to draw, already culled by the caller; all of them when null.
+    void Draw(Shader& shader, Model& model, const glm::mat4& transform, const std::vector<uint32_t>* meshes = nullptr)
+    {
+        if (draws.size() >= VISIBILITY_MAX_DRAWS)
+        {
+            stats.droppedDraws++;
+            return;
+        }
+        Add(model);
+        const std::vector<uint32_t>& firstTriangles = models[&model];
+
+        shader.setMat4("model", transform);
+        shader.setInt("drawIndex", static_cast<int>(draws.size()));
+        UniformHandle firstTriangle = shader.getUniform("firstTriangle");
+        draws.push_back({ transform, glm::mat4(glm::transpose(glm::inverse(glm::mat3(transform)))) });
+        auto drawMesh = [&](size_t i)
+        {
+            if (firstTriangles[i] == NO_TRIANGLES)
+                return;
+            shader.setInt(firstTriangle, static_cast<int>(firstTriangles[i]));
+            model.meshes[i].DrawPositionOnly();
+        };
+        if (meshes)
+            for (uint32_t i : *meshes)
+                drawMesh(i);
+        else
+            for (size_t i = 0; i < model.meshes.size(); i++)
+                drawMesh(i);
+    }
+
+    // Shades the ids into the lit image, one dispatch per material; the Frame block must hold this frame's view
+    void Resolve(ComputeShader& resolveShader, const glm::mat4& projection, const glm::mat4& view, float shininess, const glm::vec4& background)
+    {
+        stats.draws = static_cast<unsigned int>(draws.size());
+        if (!draws.empty())
+        {
+            if (!drawBuffer)
+                drawBuffer = GpuResources::CreateBuffer();
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, drawBuffer.Id());
+            if (draws.size() > drawCapacity)
+            {
+                glBufferData(GL_SHADER_STORAGE_BUFFER, draws.size() * sizeof(VisibilityDraw), draws.data(), GL_DYNAMIC_DRAW);
+                drawCapacity = draws.size();
+            }
+            else
+                glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, draws.size() * sizeof(VisibilityDraw), draws.data());
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        }
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, VISIBILITY_VERTEX_BINDING, vertexBuffer.Id());
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, VISIBILITY_TRIANGLE_BINDING, triangleBuffer.Id());
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, VISIBILITY_DRAW_BINDING, drawBuffer.Id());
+
+        resolveShader.use();
+        glActiveTexture(GL_TEXTURE2);
+        glBindTexture(GL_TEXTURE_2D, idTexture.Id());
+        glActiveTexture(GL_TEXTURE3);
+        glBindTexture(GL_TEXTURE_2D, depthTexture.Id());
+        resolveShader.setInt("texture_diffuse1", 0);
+        resolveShader.setInt("texture_specular1", 1);
+        resolveShader.setInt("visibilityIds", 2);
+        resolveShader.setInt("visibilityDepth", 3);
+        glBindImageTexture(0, litTexture.Id(), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+        resolveShader.setMat4("viewProjection", projection * view);
+        resolveShader.setMat4("inverseProjection", glm::inverse(projection));
+        resolveShader.setFloat("shininess", shininess);
+        resolveShader.setVec4("background", background);
+
+        // the passes write disjoint pixels, the first one also clears what no triangle covers
+        size_t passes = MaterialPasses();
+        for (size_t i = 0; i < passes; i++)
+        {
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, i < materials.size() ? materials[i].diffuse.Id() : 0);
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, i < materials.size() ? materials[i].specular.Id() : 0);
+            resolveShader.setInt("material", static_cast<int>(i));
+            glDispatchCompute(ComputeShader::Groups(targetWidth, VISIBILITY_TILE_SIZE), ComputeShader::Groups(targetHeight, VISIBILITY_TILE_SIZE), 1);
+        }
+        glActiveTexture(GL_TEXTURE0);
+        stats.materialPasses = static_cast<unsigned int>(passes);
+        // the image stores must land before the forward pass blends over them and the blit reads them
+        glMemoryBarrier(GL_FRAMEBUFFER_BARRIER_BIT);
+    }
+
+    // Forward drawing on top of the lit image, against the geometry pass's depth
+    void BeginForward()
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, litFramebuffer.Id());
+    }
+
+    // Copies the lit image to the framebuffer that was bound before BeginGeometry
+    void EndFrame()
+    {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, litFramebuffer.Id());
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, previousFramebuffer);
+        glBlitFramebuffer(0, 0, targetWidth, targetHeight, 0, 0, targetWidth, targetHeight, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+    }
+
+    // Size of the ids and depth, written once by the geometry pass and read by every material pass
+    size_t TargetBytes() const { return size_t(targetWidth) * targetHeight * VISIBILITY_BYTES_PER_PIXEL; }
+    // One resolve dispatch per material, at least one to write the background
+    size_t MaterialPasses() const { return std::max<size_t>(materials.size(), 1); }
+    // Target bytes read by one Resolve: every material pass re-reads all ids and depth (and redoes the tile culling)
+    size_t ResolveReadBytes() const { return TargetBytes() * MaterialPasses(); }
+    size_t ArenaBytes() const { return vertices.size() * sizeof(ArenaVertex) + triangles.size() * sizeof(glm::uvec4); }
+    const Stats& GetStats() const { return stats; }
+
+private:
+    static constexpr uint32_t NO_TRIANGLES = 0xFFFFFFFFu;
+
+    struct Material {
+        SharedTexture diffuse;
+        SharedTexture specular;
+    };
+
+    // first arena triangle of every mesh, NO_TRIANGLES for the ones left out
+    std::unordered_map<const Model*, std::vector<uint32_t>> models;
+    std::vector<ArenaVertex> vertices;
+    // x, y, z = arena vertices, w = material
+    std::vector<glm::uvec4> triangles;
+    std::vector<Material> materials;
+    std::vector<VisibilityDraw> draws;
+    SharedBuffer vertexBuffer, triangleBuffer, drawBuffer;
+    size_t drawCapacity = 0;
+    SharedTexture idTexture, depthTexture, litTexture;
+    SharedFramebuffer visibilityFramebuffer, litFramebuffer;
+    GLint previousFramebuffer = 0;
+    int targetWidth = 0, targetHeight = 0;
+    Stats stats;
+
+    // the first diffuse and specular map, as Mesh binds them to texture_diffuse1 and texture_specular1
+    uint32_t materialIndex(const std::vector<Texture>& textures)
+    {
+        Material material;
+        for (const Texture& texture : textures)
+        {
+            if (texture.type == TEXTURE_DIFFUSE && !material.diffuse)
+                material.diffuse = texture.handle;
+            else if (texture.type == TEXTURE_SPECULAR && !material.specular)
+                material.specular = texture.handle;
+        }
+        for (size_t i = 0; i < materials.size(); i++)
+            if (materials[i].diffuse.Id() == material.diffuse.Id() && materials[i].specular.Id() == material.specular.Id())
+                return static_cast<uint32_t>(i);
+        materials.push_back(material);
+        return static_cast<uint32_t>(materials.size() - 1);
+    }
+
+    static void upload(SharedBuffer& buffer, const void* data, size_t size)
+    {
+        if (!buffer)
+            buffer = GpuResources::CreateBuffer();
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer.Id());
+        glBufferData(GL_SHADER_STORAGE_BUFFER, size, data, GL_STATIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+
+    static SharedTexture createTarget(GLenum format, int width, int height)
+    {
+        SharedTexture texture = GpuResources::CreateTexture();
+        glBindTexture(GL_TEXTURE_2D, texture.Id());
+        glTexStorage2D(GL_TEXTURE_2D, 1, format, width, height);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        return texture;
+    }
+
+    static void checkFramebuffer(const char* name)
+    {
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::VISIBILITY::" << name << "_FRAMEBUFFER_INCOMPLETE" << std::endl;
+    }
+
+    void resize(int width, int height)
+    {
+        targetWidth = width;
+        targetHeight = height;
+        idTexture = createTarget(GL_R32UI, width, height);
+        depthTexture = createTarget(GL_DEPTH_COMPONENT32F, width, height);
+        litTexture = createTarget(GL_RGBA8, width, height);
+
+        if (!visibilityFramebuffer)
+            visibilityFramebuffer = GpuResources::CreateFramebuffer();
+        glBindFramebuffer(GL_FRAMEBUFFER, visibilityFramebuffer.Id());
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, idTexture.Id(), 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthTexture.Id(), 0);
+        checkFramebuffer("ID");
+
+        if (!litFramebuffer)
+            litFramebuffer = GpuResources::CreateFramebuffer();
+        glBindFramebuffer(GL_FRAMEBUFFER, litFramebuffer.Id());
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, litTexture.Id(), 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthTexture.Id(), 0);
+        checkFramebuffer("LIT");
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+};
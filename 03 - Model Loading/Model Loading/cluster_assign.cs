@@ -0,0 +1,161 @@
+#version 460 core
+
+// one invocation per cluster, CLUSTER_GROUP_SIZE in ClusteredLights.h
+layout (local_size_x = 128) in;
+
+// must match ClusteredLights.h
+#define CLUSTER_X 16
+#define CLUSTER_Y 9
+#define CLUSTER_Z 24
+#define CLUSTER_COUNT (CLUSTER_X * CLUSTER_Y * CLUSTER_Z)
+#define MAX_LIGHTS_PER_CLUSTER 256
+
+// std140 layout, vec4 members mirror LightUniforms in UniformBuffer.h
+struct DirLight
+{
+    vec4 direction;
+    vec4 ambient;
+    vec4 diffuse;
+    vec4 specular;
+};
+
+// std430 layout, mirrors PointLightData in PointLights.h
+struct PointLight
+{
+    // w = radius of influence
+    vec4 position;
+    vec4 ambient;
+    vec4 diffuse;
+    vec4 specular;
+    vec4 attenuation;
+};
+
+layout (std140, binding = 0) uniform Frame
+{
+    mat4 view;
+    mat4 projection;
+    vec4 viewPos;
+    vec4 time;
+};
+
+layout (std140, binding = 1) uniform Lights
+{
+    DirLight dirLight;
+    ivec4 lightCount;
+    vec4 clusterParams;
+};
+
+layout (std430, binding = 10) readonly buffer PointLights
+{
+    PointLight pointLights[];
+};
+
+layout (std430, binding = 14) writeonly buffer ClusterLightCounts
+{
+    uint clusterLightCount[];
+};
+
+layout (std430, binding = 15) writeonly buffer ClusterLightIndices
+{
+    uint clusterLightIndices[];
+};
+
+// mirrors LightListOverflow in PointLights.h, cleared every frame
+layout (std430, binding = 16) buffer LightOverflow
+{
+    uint overflowClusters;
+    uint droppedClusterLights;
+    uint overflowTiles;
+    uint droppedTileLights;
+};
+
+uniform mat4 inverseProjection;
+uniform vec2 screenSize;
+uniform float zNear;
+uniform float zFar;
+
+// view space center and radius of a batch of lights, loaded once per workgroup
+shared vec4 batch[gl_WorkGroupSize.x];
+
+// view space point on the near plane under a pixel
+vec3 screenToView(vec2 screen)
+{
+    vec4 view = inverseProjection * vec4(screen / screenSize * 2.0 - 1.0, -1.0, 1.0);
+    return view.xyz / view.w;
+}
+
+// where the ray from the eye through point reaches the view depth
+vec3 rayAtDepth(vec3 point, float depth)
+{
+    return point * (depth / -point.z);
+}
+
+bool sphereTouchesBox(vec4 sphere, vec3 minPoint, vec3 maxPoint)
+{
+    vec3 closest = clamp(sphere.xyz, minPoint, maxPoint);
+    vec3 offset = closest - sphere.xyz;
+    return dot(offset, offset) <= sphere.w * sphere.w;
+}
+
+void main()
+{
+    uint index = gl_GlobalInvocationID.x;
+    bool active = index < CLUSTER_COUNT;
+    vec3 minPoint = vec3(0.0), maxPoint = vec3(0.0);
+    if (active)
+    {
+        uvec3 cell = uvec3(index % CLUSTER_X, (index / CLUSTER_X) % CLUSTER_Y, index / (CLUSTER_X * CLUSTER_Y));
+
+        // screen tile corners; x and y of a view ray only depend on the pixel's x and y, so two rays bound the tile
+        vec2 tileSize = screenSize / vec2(CLUSTER_X, CLUSTER_Y);
+        vec3 minRay = screenToView(vec2(cell.xy) * tileSize);
+        vec3 maxRay = screenToView(vec2(cell.xy + 1u) * tileSize);
+
+        // exponential slices, as many per doubling of depth wherever the slice is
+        float nearDepth = zNear * pow(zFar / zNear, float(cell.z) / CLUSTER_Z);
+        float farDepth = zNear * pow(zFar / zNear, float(cell.z + 1u) / CLUSTER_Z);
+
+        vec3 a = rayAtDepth(minRay, nearDepth);
+        vec3 b = rayAtDepth(minRay, farDepth);
+        vec3 c = rayAtDepth(maxRay, nearDepth);
+        vec3 d = rayAtDepth(maxRay, farDepth);
+        minPoint = min(min(a, b), min(c, d));
+        maxPoint = max(max(a, b), max(c, d));
+    }
+
+    uint lights = uint(lightCount.x);
+    uint count = 0u;
+    uint dropped = 0u;
+    for (uint first = 0u; first < lights; first += gl_WorkGroupSize.x)
+    {
+        uint light = first + gl_LocalInvocationID.x;
+        if (light < lights)
+        {
+            vec4 position = pointLights[light].position;
+            batch[gl_LocalInvocationID.x] = vec4((view * vec4(position.xyz, 1.0)).xyz, position.w);
+        }
+        barrier();
+
+        uint batchSize = min(gl_WorkGroupSize.x, lights - first);
+        for (uint i = 0u; active && i < batchSize; i++)
+        {
+            if (!sphereTouchesBox(batch[i], minPoint, maxPoint))
+                continue;
+            if (count < MAX_LIGHTS_PER_CLUSTER)
+            {
+                clusterLightIndices[index * MAX_LIGHTS_PER_CLUSTER + count] = first + i;
+                count++;
+            }
+            else
+                dropped++;
+        }
+        barrier();
+    }
+    if (active)
+        clusterLightCount[index] = count;
+    if (dropped > 0u)
+    {
+        atomicAdd(overflowClusters, 1u);
+        atomicAdd(droppedClusterLights, dropped);
+    }
+}
\ No newline at end of file
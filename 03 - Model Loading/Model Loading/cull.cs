@@ -0,0 +1,138 @@
+#version 460 core
+
+// One invocation per instance, see GpuCulling.h
+layout (local_size_x = 64) in;
+
+struct Instance
+{
+    mat4 model;
+    vec4 sphere; // world space, w = radius
+};
+
+struct MeshDraw
+{
+    uint count;
+    uint firstIndex;
+    int baseVertex;
+    uint padding;
+};
+
+struct DrawElementsIndirectCommand
+{
+    uint count;
+    uint instanceCount;
+    uint firstIndex;
+    int baseVertex;
+    uint baseInstance;
+};
+
+layout (std430, binding = 3) readonly buffer Instances { Instance instances[]; };
+layout (std430, binding = 4) readonly buffer MeshDraws { MeshDraw meshDraws[]; };
+// meshCount slices of instanceCount commands each
+layout (std430, binding = 5) writeonly buffer Commands { DrawElementsIndirectCommand commands[]; };
+// one draw count per mesh, read by glMultiDrawElementsIndirectCount
+layout (std430, binding = 6) buffer DrawCounts { uint drawCounts[]; };
+// 1 for instances that passed the occlusion test last frame
+layout (std430, binding = 8) buffer Visibility { uint visibility[]; };
+layout (std430, binding = 9) buffer CullStats
+{
+    uint frustumVisible;
+    uint occlusionVisible;
+};
+
+// world space, inward facing, normalized
+uniform vec4 frustumPlanes[6];
+uniform uint instanceCount;
+uniform uint meshCount;
+
+// 0: frustum only, 1: early (frustum and visible last frame), 2: late (occlusion test against the pyramid)
+#define PHASE_FRUSTUM 0u
+#define PHASE_EARLY 1u
+#define PHASE_LATE 2u
+uniform uint phase;
+
+// max-depth pyramid of the early phase's depth (HiZ.h)
+uniform sampler2D hiZ;
+uniform vec2 hiZSize;
+uniform int hiZLevels;
+uniform mat4 viewProjection;
+
+// Conservative: anything the test can't decide (crossing the near plane, too large for the pyramid) is visible
+bool occluded(vec4 sphere)
+{
+    // screen rectangle and nearest depth of the cube around the sphere
+    vec2 minUV = vec2(1.0);
+    vec2 maxUV = vec2(0.0);
+    float nearest = 1.0;
+    for (int i = 0; i < 8; i++)
+    {
+        vec3 corner = sphere.xyz + vec3((i & 1) != 0 ? 1.0 : -1.0, (i & 2) != 0 ? 1.0 : -1.0, (i & 4) != 0 ? 1.0 : -1.0) * sphere.w;
+        vec4 clip = viewProjection * vec4(corner, 1.0);
+        if (clip.w <= 0.0)
+            return false;
+        vec3 ndc = clip.xyz / clip.w;
+        minUV = min(minUV, ndc.xy * 0.5 + 0.5);
+        maxUV = max(maxUV, ndc.xy * 0.5 + 0.5);
+        nearest = min(nearest, ndc.z * 0.5 + 0.5);
+    }
+    minUV = clamp(minUV, 0.0, 1.0);
+    maxUV = clamp(maxUV, 0.0, 1.0);
+
+    // the level where the rectangle is at most one texel wide, so it touches at most 2x2 texels
+    vec2 extent = (maxUV - minUV) * hiZSize;
+    int level = int(ceil(log2(max(max(extent.x, extent.y), 1.0))));
+    if (level >= hiZLevels)
+        return false;
+    ivec2 levelSize = textureSize(hiZ, level);
+    ivec2 first = min(ivec2(minUV * vec2(levelSize)), levelSize - 1);
+    ivec2 last = min(ivec2(maxUV * vec2(levelSize)), levelSize - 1);
+    float farthest = max(max(texelFetch(hiZ, first, level).r, texelFetch(hiZ, ivec2(last.x, first.y), level).r),
+                         max(texelFetch(hiZ, ivec2(first.x, last.y), level).r, texelFetch(hiZ, last, level).r));
+    return nearest > farthest;
+}
+
+void main()
+{
+    uint instance = gl_GlobalInvocationID.x;
+    if (instance >= instanceCount)
+        return;
+
+    vec4 sphere = instances[instance].sphere;
+    for (int i = 0; i < 6; i++)
+    {
+        if (dot(frustumPlanes[i].xyz, sphere.xyz) + frustumPlanes[i].w < -sphere.w)
+        {
+            if (phase == PHASE_LATE)
+                visibility[instance] = 0u;
+            return;
+        }
+    }
+
+    if (phase == PHASE_EARLY && visibility[instance] == 0u)
+        return;
+    if (phase == PHASE_LATE)
+    {
+        atomicAdd(frustumVisible, 1u);
+        bool visible = !occluded(sphere);
+        bool drawnEarly = visibility[instance] != 0u;
+        visibility[instance] = visible ? 1u : 0u;
+        if (!visible)
+            return;
+        atomicAdd(occlusionVisible, 1u);
+        // still visible ones were already drawn by the early phase, only the newly visible remain
+        if (drawnEarly)
+            return;
+    }
+
+    for (uint mesh = 0; mesh < meshCount; mesh++)
+    {
+        uint slot = atomicAdd(drawCounts[mesh], 1u);
+        DrawElementsIndirectCommand command;
+        command.count = meshDraws[mesh].count;
+        command.instanceCount = 1u;
+        command.firstIndex = meshDraws[mesh].firstIndex;
+        command.baseVertex = meshDraws[mesh].baseVertex;
+        command.baseInstance = instance;
+        commands[mesh * instanceCount + slot] = command;
+    }
+}
\ No newline at end of file
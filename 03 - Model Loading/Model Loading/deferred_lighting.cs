@@ -0,0 +1,210 @@
+#version 460 core
+
+// one workgroup per DEFERRED_TILE_SIZE square tile (Deferred.h)
+layout (local_size_x = 16, local_size_y = 16) in;
+
+// lights past this in one tile are dropped, and counted in LightOverflow
+#define MAX_TILE_LIGHTS 256
+
+// std140 layout, vec4 members mirror LightUniforms in UniformBuffer.h
+struct DirLight
+{
+    vec4 direction;
+    vec4 ambient;
+    vec4 diffuse;
+    vec4 specular;
+};
+
+// std430 layout, mirrors PointLightData in PointLights.h
+struct PointLight
+{
+    // w = radius of influence
+    vec4 position;
+    vec4 ambient;
+    vec4 diffuse;
+    vec4 specular;
+    vec4 attenuation;
+};
+
+layout (std140, binding = 0) uniform Frame
+{
+    mat4 view;
+    mat4 projection;
+    vec4 viewPos;
+    vec4 time;
+};
+
+layout (std140, binding = 1) uniform Lights
+{
+    DirLight dirLight;
+    ivec4 lightCount;
+    vec4 clusterParams;
+};
+
+layout (std430, binding = 10) readonly buffer PointLights
+{
+    PointLight pointLights[];
+};
+
+// mirrors LightListOverflow in PointLights.h, cleared every frame
+layout (std430, binding = 16) buffer LightOverflow
+{
+    uint overflowClusters;
+    uint droppedClusterLights;
+    uint overflowTiles;
+    uint droppedTileLights;
+};
+
+uniform sampler2D gAlbedoSpecular;
+uniform sampler2D gNormal;
+uniform sampler2D gDepth;
+layout (rgba8, binding = 0) uniform writeonly image2D litImage;
+
+uniform mat4 inverseProjection;
+uniform mat4 inverseViewProjection;
+uniform float shininess;
+// written where nothing was drawn
+uniform vec4 background;
+
+// depth range of the tile, as float bits: non-negative floats order like their bits
+shared uint tileMinDepth;
+shared uint tileMaxDepth;
+shared uint tileLightCount;
+shared uint tileLights[MAX_TILE_LIGHTS];
+
+vec3 decodeOctahedral(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = clamp(-n.z, 0.0, 1.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+
+// view space point at a window position (0..1) and depth buffer value
+vec3 windowToView(vec2 uv, float depth)
+{
+    vec4 view = inverseProjection * vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+    return view.xyz / view.w;
+}
+
+bool sphereTouchesBox(vec3 center, float radius, vec3 minPoint, vec3 maxPoint)
+{
+    vec3 offset = clamp(center, minPoint, maxPoint) - center;
+    return dot(offset, offset) <= radius * radius;
+}
+
+vec3 CalDirLight(vec3 albedo, float specularIntensity, vec3 norm, vec3 viewDir)
+{
+    vec3 ambient = dirLight.ambient.rgb * albedo;
+
+    vec3 lightDir = normalize(-dirLight.direction.xyz);
+    float diff = max(dot(norm, lightDir), 0.0);
+    vec3 diffuse = dirLight.diffuse.rgb * diff * albedo;
+
+    vec3 reflectDir = reflect(-lightDir, norm);
+    float spec = pow(max(dot(reflectDir, viewDir), 0.0), shininess);
+    vec3 specular = dirLight.specular.rgb * spec * specularIntensity;
+
+    return ambient + diffuse + specular;
+}
+
+// same as CalPointLight in shader.fs, with the material read from the G-buffer
+vec3 CalPointLight(PointLight pointLight, vec3 albedo, float specularIntensity, vec3 norm, vec3 fragPos, vec3 viewDir)
+{
+    vec3 ambient = pointLight.ambient.rgb * albedo;
+
+    vec3 lightDir = normalize(pointLight.position.xyz - fragPos);
+    float diff = max(dot(lightDir, norm), 0.0);
+    vec3 diffuse = pointLight.diffuse.rgb * diff * albedo;
+
+    vec3 reflectDir = reflect(-lightDir, norm);
+    float spec = pow(max(dot(reflectDir, viewDir), 0.0), shininess);
+    vec3 specular = pointLight.specular.rgb * spec * specularIntensity;
+
+    float distance = length(pointLight.position.xyz - fragPos);
+    float attenuation = 1.0 / (pointLight.attenuation.x + pointLight.attenuation.y * distance + pointLight.attenuation.z * (distance * distance));
+    float falloff = clamp(1.0 - pow(distance / pointLight.position.w, 4.0), 0.0, 1.0);
+    attenuation *= falloff * falloff;
+
+    return (ambient + diffuse + specular) * attenuation;
+}
+
+void main()
+{
+    ivec2 size = imageSize(litImage);
+    ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);
+    bool inside = all(lessThan(pixel, size));
+
+    if (gl_LocalInvocationIndex == 0u)
+    {
+        tileMinDepth = 0xFFFFFFFFu;
+        tileMaxDepth = 0u;
+        tileLightCount = 0u;
+    }
+    barrier();
+
+    float depth = inside ? texelFetch(gDepth, pixel, 0).r : 1.0;
+    bool covered = depth < 1.0;
+    if (covered)
+    {
+        atomicMin(tileMinDepth, floatBitsToUint(depth));
+        atomicMax(tileMaxDepth, floatBitsToUint(depth));
+    }
+    barrier();
+
+    // view space box of the tile between its nearest and farthest covered pixel; x and y of a view ray only
+    // depend on the pixel's x and y, so the two corner rays at both depths bound it
+    if (tileMinDepth <= tileMaxDepth)
+    {
+        vec2 tileMin = vec2(gl_WorkGroupID.xy * gl_WorkGroupSize.xy) / vec2(size);
+        vec2 tileMax = vec2((gl_WorkGroupID.xy + 1u) * gl_WorkGroupSize.xy) / vec2(size);
+        float nearZ = windowToView(tileMin, uintBitsToFloat(tileMinDepth)).z;
+        float farZ = windowToView(tileMin, uintBitsToFloat(tileMaxDepth)).z;
+        vec3 minRay = windowToView(tileMin, 0.0);
+        vec3 maxRay = windowToView(tileMax, 0.0);
+        vec3 a = minRay * (nearZ / minRay.z);
+        vec3 b = minRay * (farZ / minRay.z);
+        vec3 c = maxRay * (nearZ / maxRay.z);
+        vec3 d = maxRay * (farZ / maxRay.z);
+        vec3 boxMin = min(min(a, b), min(c, d));
+        vec3 boxMax = max(max(a, b), max(c, d));
+
+        uint threads = gl_WorkGroupSize.x * gl_WorkGroupSize.y;
+        for (uint i = gl_LocalInvocationIndex; i < uint(lightCount.x); i += threads)
+        {
+            vec4 position = pointLights[i].position;
+            if (sphereTouchesBox((view * vec4(position.xyz, 1.0)).xyz, position.w, boxMin, boxMax))
+            {
+                uint slot = atomicAdd(tileLightCount, 1u);
+                if (slot < MAX_TILE_LIGHTS)
+                    tileLights[slot] = i;
+            }
+        }
+    }
+    barrier();
+
+    if (gl_LocalInvocationIndex == 0u && tileLightCount > MAX_TILE_LIGHTS)
+    {
+        atomicAdd(overflowTiles, 1u);
+        atomicAdd(droppedTileLights, tileLightCount - MAX_TILE_LIGHTS);
+    }
+    if (!inside)
+        return;
+    if (!covered)
+    {
+        imageStore(litImage, pixel, background);
+        return;
+    }
+
+    vec4 albedoSpecular = texelFetch(gAlbedoSpecular, pixel, 0);
+    vec3 norm = decodeOctahedral(texelFetch(gNormal, pixel, 0).rg * 2.0 - 1.0);
+    vec4 world = inverseViewProjection * vec4(vec3((vec2(pixel) + 0.5) / vec2(size), depth) * 2.0 - 1.0, 1.0);
+    vec3 fragPos = world.xyz / world.w;
+    vec3 viewDir = normalize(viewPos.xyz - fragPos);
+
+    vec3 result = CalDirLight(albedoSpecular.rgb, albedoSpecular.a, norm, viewDir);
+    uint count = min(tileLightCount, uint(MAX_TILE_LIGHTS));
+    for (uint i = 0u; i < count; i++)
+        result += CalPointLight(pointLights[tileLights[i]], albedoSpecular.rgb, albedoSpecular.a, norm, fragPos, viewDir);
+    imageStore(litImage, pixel, vec4(result, 1.0));
+}
\ No newline at end of file
@@ -0,0 +1,37 @@
+#version 460 core
+
+// Position-only input, fed by Mesh's packed position stream
+layout (location = 0) in vec3 aPos;
+
+// must match shader.vs bit for bit so the color pass can test with GL_LEQUAL against the prepass
+invariant gl_Position;
+
+#ifdef GPU_INSTANCES
+// GPU culled placements (GpuCulling.h), every indirect command carries its instance index as baseInstance
+struct Instance
+{
+    mat4 model;
+    vec4 sphere;
+};
+layout (std430, binding = 3) readonly buffer Instances { Instance instances[]; };
+#else
+uniform mat4 model;
+#endif
+
+// per-frame data, shared by every program through UniformBuffer<FrameUniforms>
+layout (std140, binding = 0) uniform Frame
+{
+    mat4 view;
+    mat4 projection;
+    vec4 viewPos;
+    vec4 time;
+};
+
+void main()
+{
+#ifdef GPU_INSTANCES
+    mat4 model = instances[gl_BaseInstance].model;
+#endif
+    vec3 FragPos = vec3(model * vec4(aPos, 1.0));
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
\ No newline at end of file
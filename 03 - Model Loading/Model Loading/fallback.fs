@@ -0,0 +1,11 @@
+#version 460 core
+out vec4 FragColor;
+
+in vec3 Normal;
+
+// stand-in while the real program compiles: flat grey with a fixed light
+void main()
+{
+    float diffuse = max(dot(normalize(Normal), normalize(vec3(0.2, 1.0, 0.3))), 0.0);
+    FragColor = vec4(vec3(0.25 + 0.5 * diffuse), 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,26 @@
+#version 460 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+
+out vec3 Normal;
+
+// same transform as shader.vs and depth.vs so a fallback can stand in for either pass
+invariant gl_Position;
+
+uniform mat4 model;
+
+// per-frame data, shared by every program through UniformBuffer<FrameUniforms>
+layout (std140, binding = 0) uniform Frame
+{
+    mat4 view;
+    mat4 projection;
+    vec4 viewPos;
+    vec4 time;
+};
+
+void main()
+{
+    Normal = mat3(model) * aNormal;
+    vec3 FragPos = vec3(model * vec4(aPos, 1.0));
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,27 @@
+#version 460 core
+
+// Geometry pass of DeferredRenderer (Deferred.h), drawn with shader.vs
+layout (location = 0) out vec4 gAlbedoSpecular;
+layout (location = 1) out vec2 gNormal;
+
+in vec3 FragPos;
+in vec3 Normal;
+in vec2 TexCoords;
+
+uniform sampler2D texture_diffuse1;
+uniform sampler2D texture_specular1;
+
+// folds the unit sphere onto the [-1, 1] square: upper hemisphere as is, lower one flipped over the diagonals
+vec2 encodeOctahedral(vec3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 folded = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return n.z >= 0.0 ? n.xy : folded;
+}
+
+void main()
+{
+    gAlbedoSpecular = vec4(texture(texture_diffuse1, TexCoords).rgb, texture(texture_specular1, TexCoords).r);
+    // the unorm target stores [0, 1]
+    gNormal = encodeOctahedral(normalize(Normal)) * 0.5 + 0.5;
+}
\ No newline at end of file
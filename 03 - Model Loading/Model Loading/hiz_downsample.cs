@@ -0,0 +1,99 @@
+#version 460 core
+
+// Max-depth pyramid in one dispatch, see HiZ.h. Each workgroup reduces a 32x32 tile of level 0 down to
+// level 5 through shared memory; the last workgroup to finish then reduces level 5 to the last level.
+layout (local_size_x = 16, local_size_y = 16) in;
+
+// one image per level, coherent so the last workgroup sees every other workgroup's stores
+layout (r32f, binding = 0) coherent uniform image2D pyramid[8];
+layout (std430, binding = 7) coherent buffer Counter { uint finishedGroups; };
+
+uniform sampler2D depthTexture;
+uniform int levelCount;
+uniform uint groupCount;
+
+shared float tile[16][16];
+shared bool lastGroup;
+
+// farthest depth of the screen pixels a level 0 texel covers (level 0 is at most the screen size, so <= 3x3)
+float farthestDepth(ivec2 texel)
+{
+    ivec2 depthSize = textureSize(depthTexture, 0);
+    vec2 scale = vec2(depthSize) / vec2(imageSize(pyramid[0]));
+    ivec2 first = ivec2(floor(vec2(texel) * scale));
+    ivec2 last = min(ivec2(ceil(vec2(texel + 1) * scale)) - 1, depthSize - 1);
+    float depth = 0.0;
+    for (int y = first.y; y <= last.y; y++)
+        for (int x = first.x; x <= last.x; x++)
+            depth = max(depth, texelFetch(depthTexture, ivec2(x, y), 0).r);
+    return depth;
+}
+
+void main()
+{
+    ivec2 local = ivec2(gl_LocalInvocationID.xy);
+    ivec2 base = ivec2(gl_WorkGroupID.xy) * 32;
+
+    // levels 0 and 1: 2x2 level 0 texels per invocation
+    float depth = 0.0;
+    for (int y = 0; y < 2; y++)
+    {
+        for (int x = 0; x < 2; x++)
+        {
+            ivec2 texel = base + local * 2 + ivec2(x, y);
+            float texelDepth = farthestDepth(texel);
+            imageStore(pyramid[0], texel, vec4(texelDepth));
+            depth = max(depth, texelDepth);
+        }
+    }
+    if (levelCount > 1)
+        imageStore(pyramid[1], base / 2 + local, vec4(depth));
+    tile[local.y][local.x] = depth;
+    barrier();
+
+    // levels 2 to 5 from shared memory, a quarter of the invocations fewer each time
+    for (int level = 2; level < min(levelCount, 6); level++)
+    {
+        int size = 32 >> level;
+        bool active = local.x < size && local.y < size;
+        if (active)
+            depth = max(max(tile[local.y * 2][local.x * 2], tile[local.y * 2][local.x * 2 + 1]),
+                        max(tile[local.y * 2 + 1][local.x * 2], tile[local.y * 2 + 1][local.x * 2 + 1]));
+        barrier();
+        if (active)
+        {
+            tile[local.y][local.x] = depth;
+            imageStore(pyramid[level], (base >> level) + local, vec4(depth));
+        }
+        barrier();
+    }
+    if (levelCount <= 6)
+        return;
+
+    // only the last workgroup to get here continues, every tile of level 5 is complete by then
+    memoryBarrierImage();
+    barrier();
+    if (gl_LocalInvocationIndex == 0)
+        lastGroup = atomicAdd(finishedGroups, 1u) == groupCount - 1u;
+    barrier();
+    if (!lastGroup)
+        return;
+
+    for (int level = 6; level < levelCount; level++)
+    {
+        ivec2 size = imageSize(pyramid[level]);
+        for (int i = int(gl_LocalInvocationIndex); i < size.x * size.y; i += 256)
+        {
+            ivec2 texel = ivec2(i % size.x, i / size.x);
+            ivec2 source = texel * 2;
+            float texelDepth = max(max(imageLoad(pyramid[level - 1], source).r, imageLoad(pyramid[level - 1], source + ivec2(1, 0)).r),
+                                   max(imageLoad(pyramid[level - 1], source + ivec2(0, 1)).r, imageLoad(pyramid[level - 1], source + ivec2(1, 1)).r));
+            imageStore(pyramid[level], texel, vec4(texelDepth));
+        }
+        memoryBarrierImage();
+        barrier();
+    }
+    // ready for the next frame
+    if (gl_LocalInvocationIndex == 0)
+        finishedGroups = 0u;
+}
\ No newline at end of file
@@ -0,0 +1,11 @@
+#version 460 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D source;
+
+void main()
+{
+    FragColor = texture(source, TexCoords);
+}
\ No newline at end of file
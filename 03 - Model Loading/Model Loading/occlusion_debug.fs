@@ -0,0 +1,23 @@
+#version 460 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+// OcclusionRasterizer depth, [0,1] window depth with 1 where no occluder covers the pixel
+uniform sampler2D occlusionDepth;
+uniform float nearPlane;
+uniform float farPlane;
+
+void main()
+{
+    float depth = texture(occlusionDepth, TexCoords).r;
+    if (depth >= 1.0)
+    {
+        FragColor = vec4(0.15, 0.0, 0.0, 1.0);
+        return;
+    }
+    // linear distance, near is white
+    float ndc = depth * 2.0 - 1.0;
+    float distance = 2.0 * nearPlane * farPlane / (farPlane + nearPlane - ndc * (farPlane - nearPlane));
+    FragColor = vec4(vec3(1.0 - distance / farPlane), 1.0);
+}
\ No newline at end of file
@@ -1,27 +1,33 @@
 #version 460 core
 
+// must match ClusteredLights.h
+#define CLUSTER_X 16
+#define CLUSTER_Y 9
+#define CLUSTER_Z 24
+#define MAX_LIGHTS_PER_CLUSTER 256
+
+// std140 layout, vec4 members mirror LightUniforms in UniformBuffer.h
 struct DirLight
 {
-    vec3 direction;
+    vec4 direction;
 
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
+    vec4 ambient;
+    vec4 diffuse;
+    vec4 specular;
 };
 
-#define NR_POINT_LIGHTS 3
+// std430 layout, mirrors PointLightData in PointLights.h
 struct PointLight
 {
-    vec3 position;
+    // w = radius of influence, the light fades out to nothing there
+    vec4 position;
 
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
+    vec4 ambient;
+    vec4 diffuse;
+    vec4 specular;
 
-    // attenuation
-    float constant;
-    float linear;
-    float quadratic;
+    // x = constant, y = linear, z = quadratic
+    vec4 attenuation;
 };
 
 out vec4 FragColor;
@@ -30,9 +36,38 @@ in vec3 FragPos;
 in vec3 Normal;
 in vec2 TexCoords;
 
-uniform vec3 viewPos;
-uniform DirLight dirLight;
-uniform PointLight pointLights[NR_POINT_LIGHTS];
+layout (std140, binding = 0) uniform Frame
+{
+    mat4 view;
+    mat4 projection;
+    vec4 viewPos;
+    vec4 time;
+};
+
+layout (std140, binding = 1) uniform Lights
+{
+    DirLight dirLight;
+    // x = point lights in use, y = 1 to shade only the lights listed for the fragment's cluster
+    ivec4 lightCount;
+    // x = depth slice scale, y = depth slice bias, zw = cluster tile size in pixels
+    vec4 clusterParams;
+};
+
+layout (std430, binding = 10) readonly buffer PointLights
+{
+    PointLight pointLights[];
+};
+
+// filled every frame by cluster_assign.cs
+layout (std430, binding = 14) readonly buffer ClusterLightCounts
+{
+    uint clusterLightCount[];
+};
+
+layout (std430, binding = 15) readonly buffer ClusterLightIndices
+{
+    uint clusterLightIndices[];
+};
 
 uniform sampler2D texture_diffuse1;
 uniform sampler2D texture_specular1;
@@ -44,13 +79,27 @@ vec3 CalPointLight(PointLight pointLight, vec3 norm, vec3 FragPos, vec3 viewDir)
 void main()
 {    
     vec3 norm = normalize(Normal);
-    vec3 viewDir = normalize(viewPos - FragPos);
+    vec3 viewDir = normalize(viewPos.xyz - FragPos);
 
     // direction light
     vec3 result = CalDirLight(dirLight, norm, viewDir);
     // point lights
-    for(int i = 0; i < NR_POINT_LIGHTS; ++i)
-        result += CalPointLight(pointLights[i], norm, FragPos, viewDir);
+    if (lightCount.y != 0)
+    {
+        // same tiling and exponential depth slices as cluster_assign.cs
+        float viewDepth = -(view * vec4(FragPos, 1.0)).z;
+        uvec2 tile = min(uvec2(gl_FragCoord.xy / clusterParams.zw), uvec2(CLUSTER_X - 1, CLUSTER_Y - 1));
+        uint slice = uint(clamp(log(viewDepth) * clusterParams.x + clusterParams.y, 0.0, float(CLUSTER_Z - 1)));
+        uint cluster = tile.x + CLUSTER_X * (tile.y + CLUSTER_Y * slice);
+        uint count = clusterLightCount[cluster];
+        for (uint i = 0u; i < count; ++i)
+            result += CalPointLight(pointLights[clusterLightIndices[cluster * MAX_LIGHTS_PER_CLUSTER + i]], norm, FragPos, viewDir);
+    }
+    else
+    {
+        for (int i = 0; i < lightCount.x; ++i)
+            result += CalPointLight(pointLights[i], norm, FragPos, viewDir);
+    }
 
     FragColor = vec4(result, 1.0); 
 }
@@ -58,35 +107,38 @@ void main()
 vec3 CalDirLight(DirLight dirLight, vec3 norm, vec3 viewDir)
 {
     // Ambient component
-    vec3 ambient = dirLight.ambient * texture(texture_diffuse1, TexCoords).rgb;
+    vec3 ambient = dirLight.ambient.rgb * texture(texture_diffuse1, TexCoords).rgb;
     
     // Diffuse component
-    vec3 lightDir = normalize(-dirLight.direction);
+    vec3 lightDir = normalize(-dirLight.direction.xyz);
     float diff = max(dot(norm, lightDir), 0.0);
-    vec3 diffuse = dirLight.diffuse * diff * texture(texture_diffuse1, TexCoords).rgb;
+    vec3 diffuse = dirLight.diffuse.rgb * diff * texture(texture_diffuse1, TexCoords).rgb;
 
     // Specular component
     vec3 reflectDir = reflect(-lightDir, norm);
     float spec = pow(max(dot(reflectDir, viewDir), 0.0), shininess);
-    vec3 specular = dirLight.specular * spec * texture(texture_specular1, TexCoords).rgb;
+    vec3 specular = dirLight.specular.rgb * spec * texture(texture_specular1, TexCoords).rgb;
 
     return ambient + diffuse + specular;
 }
 
 vec3 CalPointLight(PointLight pointLight, vec3 norm, vec3 FragPos, vec3 viewDir)
 {
-    vec3 ambient = pointLight.ambient * texture(texture_diffuse1, TexCoords).rgb;
+    vec3 ambient = pointLight.ambient.rgb * texture(texture_diffuse1, TexCoords).rgb;
 
-    vec3 lightDir = normalize(pointLight.position - FragPos);
+    vec3 lightDir = normalize(pointLight.position.xyz - FragPos);
     float diff = max(dot(lightDir, norm), 0.0);
-    vec3 diffuse = pointLight.diffuse * diff * texture(texture_diffuse1, TexCoords).rgb;
+    vec3 diffuse = pointLight.diffuse.rgb * diff * texture(texture_diffuse1, TexCoords).rgb;
 
     vec3 reflectDir = reflect(-lightDir, norm);
     float spec = pow(max(dot(reflectDir, viewDir), 0.0), shininess);
-    vec3 specular = pointLight.specular * spec * texture(texture_specular1, TexCoords).rgb;
+    vec3 specular = pointLight.specular.rgb * spec * texture(texture_specular1, TexCoords).rgb;
 
-    float distance = length(pointLight.position - FragPos);
-    float attenuation = 1.0 / (pointLight.constant + pointLight.linear * distance + pointLight.quadratic * (distance * distance));
+    float distance = length(pointLight.position.xyz - FragPos);
+    float attenuation = 1.0 / (pointLight.attenuation.x + pointLight.attenuation.y * distance + pointLight.attenuation.z * (distance * distance));
+    // smooth cut-off at the radius the deferred tiles cull with, so both paths light alike
+    float falloff = clamp(1.0 - pow(distance / pointLight.position.w, 4.0), 0.0, 1.0);
+    attenuation *= falloff * falloff;
 
     ambient *= attenuation;
     diffuse *= attenuation;
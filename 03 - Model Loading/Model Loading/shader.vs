@@ -8,12 +8,35 @@ out vec3 FragPos;
 out vec3 Normal;
 out vec2 TexCoords;
 
+// matches depth.vs so the depth prepass result is reused exactly
+invariant gl_Position;
+
+#ifdef GPU_INSTANCES
+// GPU culled placements (GpuCulling.h), every indirect command carries its instance index as baseInstance
+struct Instance
+{
+    mat4 model;
+    vec4 sphere;
+};
+layout (std430, binding = 3) readonly buffer Instances { Instance instances[]; };
+#else
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#endif
+
+// per-frame data, shared by every program through UniformBuffer<FrameUniforms>
+layout (std140, binding = 0) uniform Frame
+{
+    mat4 view;
+    mat4 projection;
+    vec4 viewPos;
+    vec4 time;
+};
 
 void main()
 {
+#ifdef GPU_INSTANCES
+    mat4 model = instances[gl_BaseInstance].model;
+#endif
     FragPos = vec3(model * vec4(aPos, 1.0));
     Normal = mat3(transpose(inverse(model))) * aNormal;  
     TexCoords = aTexCoords;
@@ -1,2 +1,16 @@
 #define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
\ No newline at end of file
+#include "stb_image.h"
+
+// stb_image only has setters for the flip flag; these let a loader that needs one orientation put the calling
+// thread back exactly as it found it, including "not set, follow stbi_set_flip_vertically_on_load"
+void stbi_get_flip_state_thread(int* flip, int* set)
+{
+    *flip = stbi__vertically_flip_on_load_local;
+    *set = stbi__vertically_flip_on_load_set;
+}
+
+void stbi_restore_flip_state_thread(int flip, int set)
+{
+    stbi__vertically_flip_on_load_local = flip;
+    stbi__vertically_flip_on_load_set = set;
+}
\ No newline at end of file
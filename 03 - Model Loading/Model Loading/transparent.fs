@@ -0,0 +1,98 @@
+#version 460 core
+
+// must match ClusteredLights.h
+#define CLUSTER_X 16
+#define CLUSTER_Y 9
+#define CLUSTER_Z 24
+#define MAX_LIGHTS_PER_CLUSTER 256
+
+// std140 layout, vec4 members mirror LightUniforms in UniformBuffer.h
+struct DirLight
+{
+    vec4 direction;
+    vec4 ambient;
+    vec4 diffuse;
+    vec4 specular;
+};
+
+// std430 layout, mirrors PointLightData in PointLights.h
+struct PointLight
+{
+    vec4 position;
+    vec4 ambient;
+    vec4 diffuse;
+    vec4 specular;
+    vec4 attenuation;
+};
+
+out vec4 FragColor;
+
+in vec3 FragPos;
+in vec2 TexCoords;
+
+layout (std140, binding = 0) uniform Frame
+{
+    mat4 view;
+    mat4 projection;
+    vec4 viewPos;
+    vec4 time;
+};
+
+layout (std140, binding = 1) uniform Lights
+{
+    DirLight dirLight;
+    ivec4 lightCount;
+    vec4 clusterParams;
+};
+
+layout (std430, binding = 10) readonly buffer PointLights
+{
+    PointLight pointLights[];
+};
+
+layout (std430, binding = 14) readonly buffer ClusterLightCounts
+{
+    uint clusterLightCount[];
+};
+
+layout (std430, binding = 15) readonly buffer ClusterLightIndices
+{
+    uint clusterLightIndices[];
+};
+
+uniform sampler2D texture1;
+
+vec3 CalPointLight(PointLight pointLight)
+{
+    float distance = length(pointLight.position.xyz - FragPos);
+    float attenuation = 1.0 / (pointLight.attenuation.x + pointLight.attenuation.y * distance + pointLight.attenuation.z * (distance * distance));
+    float falloff = clamp(1.0 - pow(distance / pointLight.position.w, 4.0), 0.0, 1.0);
+    return (pointLight.ambient.rgb + pointLight.diffuse.rgb * 0.5) * attenuation * falloff * falloff;
+}
+
+// foliage cards: lit from both sides by ambient and diffuse only, with the same cluster lists as shader.fs;
+// drawn after the opaque scene in every render path, so these lists are built whatever the path
+void main()
+{
+    vec4 texColor = texture(texture1, TexCoords);
+    if (texColor.a < 0.01)
+        discard;
+
+    vec3 result = dirLight.ambient.rgb + dirLight.diffuse.rgb * 0.5;
+    if (lightCount.y != 0)
+    {
+        float viewDepth = -(view * vec4(FragPos, 1.0)).z;
+        uvec2 tile = min(uvec2(gl_FragCoord.xy / clusterParams.zw), uvec2(CLUSTER_X - 1, CLUSTER_Y - 1));
+        uint slice = uint(clamp(log(viewDepth) * clusterParams.x + clusterParams.y, 0.0, float(CLUSTER_Z - 1)));
+        uint cluster = tile.x + CLUSTER_X * (tile.y + CLUSTER_Y * slice);
+        uint count = clusterLightCount[cluster];
+        for (uint i = 0u; i < count; ++i)
+            result += CalPointLight(pointLights[clusterLightIndices[cluster * MAX_LIGHTS_PER_CLUSTER + i]]);
+    }
+    else
+    {
+        for (int i = 0; i < lightCount.x; ++i)
+            result += CalPointLight(pointLights[i]);
+    }
+    FragColor = vec4(result * texColor.rgb, texColor.a);
+}
\ No newline at end of file
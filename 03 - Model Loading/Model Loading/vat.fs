@@ -0,0 +1,18 @@
+#version 460 core
+
+out vec4 FragColor;
+
+in vec3 FragPos;
+in vec3 Normal;
+in vec2 TexCoords;
+
+uniform sampler2D texture_diffuse1;
+uniform vec3 lightDirection;
+
+void main()
+{
+    vec3 albedo = texture(texture_diffuse1, TexCoords).rgb;
+    float diff = max(dot(normalize(Normal), normalize(-lightDirection)), 0.0);
+
+    FragColor = vec4(albedo * (0.2 + 0.8 * diff), 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,69 @@
+#version 460 core
+
+layout (location = 2) in vec2 aTexCoords;
+
+struct CrowdInstance
+{
+    mat4 model;
+    // x = clip index, y = time offset, z = playback speed
+    vec4 animation;
+};
+
+layout (std430, binding = 1) readonly buffer Instances
+{
+    CrowdInstance instances[];
+};
+
+// x = first frame, y = frame count, z = frames per second
+layout (std430, binding = 2) readonly buffer Clips
+{
+    vec4 clips[];
+};
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec2 TexCoords;
+
+uniform sampler2D positionTex;
+uniform sampler2D normalTex;
+uniform int vertexCount;
+uniform int baseVertex;
+uniform int textureWidth;
+
+// per-frame data, shared by every program through UniformBuffer<FrameUniforms>
+layout (std140, binding = 0) uniform Frame
+{
+    mat4 view;
+    mat4 projection;
+    vec4 viewPos;
+    vec4 time;
+};
+
+ivec2 vatTexel(int frame, int vertex)
+{
+    int index = frame * vertexCount + vertex;
+    return ivec2(index % textureWidth, index / textureWidth);
+}
+
+void main()
+{
+    CrowdInstance instance = instances[gl_InstanceID];
+    vec4 clip = clips[int(instance.animation.x)];
+
+    // gl_VertexID is the index value of an indexed draw, i.e. the mesh-local vertex
+    int vertex = baseVertex + gl_VertexID;
+    float frame = mod((time.x * instance.animation.z + instance.animation.y) * clip.z, clip.y);
+    int frame0 = int(clip.x) + int(frame);
+    int frame1 = int(clip.x) + (int(frame) + 1) % int(clip.y);
+    float blend = fract(frame);
+
+    vec3 position = mix(texelFetch(positionTex, vatTexel(frame0, vertex), 0).xyz, texelFetch(positionTex, vatTexel(frame1, vertex), 0).xyz, blend);
+    vec3 normal = mix(texelFetch(normalTex, vatTexel(frame0, vertex), 0).xyz, texelFetch(normalTex, vatTexel(frame1, vertex), 0).xyz, blend);
+
+    FragPos = vec3(instance.model * vec4(position, 1.0));
+    // crowd transforms are rotation + uniform scale, so the model matrix is fine for normals
+    Normal = mat3(instance.model) * normal;
+    TexCoords = aTexCoords;
+
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
\ No newline at end of file
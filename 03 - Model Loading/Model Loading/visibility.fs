@@ -0,0 +1,16 @@
+#version 460 core
+
+// Geometry pass of VisibilityBuffer (VisibilityBuffer.h), drawn with depth.vs: only ids leave this pass
+#define TRIANGLE_BITS 21u
+
+layout (location = 0) out uint visibilityId;
+
+// index of the placement in this frame's draw table, and the first arena triangle of the mesh being drawn
+uniform int drawIndex;
+uniform int firstTriangle;
+
+void main()
+{
+    // 0 is left for pixels nothing covers
+    visibilityId = ((uint(drawIndex) + 1u) << TRIANGLE_BITS) | (uint(firstTriangle) + uint(gl_PrimitiveID));
+}
\ No newline at end of file
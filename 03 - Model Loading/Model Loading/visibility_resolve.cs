@@ -0,0 +1,300 @@
+#version 460 core
+
+// one workgroup per VISIBILITY_TILE_SIZE square tile (VisibilityBuffer.h)
+layout (local_size_x = 16, local_size_y = 16) in;
+
+// lights past this in one tile are dropped, and counted in LightOverflow
+#define MAX_TILE_LIGHTS 256
+// id split, as in visibility.fs
+#define TRIANGLE_BITS 21u
+#define TRIANGLE_MASK ((1u << TRIANGLE_BITS) - 1u)
+
+// std140 layout, vec4 members mirror LightUniforms in UniformBuffer.h
+struct DirLight
+{
+    vec4 direction;
+    vec4 ambient;
+    vec4 diffuse;
+    vec4 specular;
+};
+
+// std430 layout, mirrors PointLightData in PointLights.h
+struct PointLight
+{
+    // w = radius of influence
+    vec4 position;
+    vec4 ambient;
+    vec4 diffuse;
+    vec4 specular;
+    vec4 attenuation;
+};
+
+// std430 layout, mirrors ArenaVertex in VisibilityBuffer.h
+struct ArenaVertex
+{
+    // xyz = object space position, w = u
+    vec4 positionU;
+    // xyz = object space normal, w = v
+    vec4 normalV;
+};
+
+// std430 layout, mirrors VisibilityDraw in VisibilityBuffer.h
+struct Draw
+{
+    mat4 model;
+    mat4 normalMatrix;
+};
+
+layout (std140, binding = 0) uniform Frame
+{
+    mat4 view;
+    mat4 projection;
+    vec4 viewPos;
+    vec4 time;
+};
+
+layout (std140, binding = 1) uniform Lights
+{
+    DirLight dirLight;
+    ivec4 lightCount;
+    vec4 clusterParams;
+};
+
+layout (std430, binding = 10) readonly buffer PointLights
+{
+    PointLight pointLights[];
+};
+
+// mirrors LightListOverflow in PointLights.h, cleared every frame
+layout (std430, binding = 16) buffer LightOverflow
+{
+    uint overflowClusters;
+    uint droppedClusterLights;
+    uint overflowTiles;
+    uint droppedTileLights;
+};
+
+layout (std430, binding = 11) readonly buffer ArenaVertices
+{
+    ArenaVertex vertices[];
+};
+
+// x, y, z = arena vertices, w = material
+layout (std430, binding = 12) readonly buffer ArenaTriangles
+{
+    uvec4 triangles[];
+};
+
+layout (std430, binding = 13) readonly buffer Draws
+{
+    Draw draws[];
+};
+
+uniform usampler2D visibilityIds;
+uniform sampler2D visibilityDepth;
+// maps of the material this dispatch shades
+uniform sampler2D texture_diffuse1;
+uniform sampler2D texture_specular1;
+layout (rgba8, binding = 0) uniform writeonly image2D litImage;
+
+uniform int material;
+uniform mat4 viewProjection;
+uniform mat4 inverseProjection;
+uniform float shininess;
+// written where nothing was drawn, by the material 0 dispatch
+uniform vec4 background;
+
+// depth range of this material's pixels in the tile, as float bits: non-negative floats order like their bits
+shared uint tileMinDepth;
+shared uint tileMaxDepth;
+shared uint tileLightCount;
+shared uint tileLights[MAX_TILE_LIGHTS];
+
+// Perspective-correct barycentrics of a pixel in a triangle given by its clip space corners, and how they
+// change one pixel to the right (ddx) and one pixel up (ddy). The screen space barycentrics are linear in ndc;
+// dividing their 1/w-weighted form by the interpolated 1/w gives the perspective-correct ones.
+struct Barycentrics
+{
+    vec3 lambda;
+    vec3 ddx;
+    vec3 ddy;
+};
+
+Barycentrics computeBarycentrics(vec4 clip0, vec4 clip1, vec4 clip2, vec2 ndc, vec2 size)
+{
+    vec3 invW = 1.0 / vec3(clip0.w, clip1.w, clip2.w);
+    vec2 ndc0 = clip0.xy * invW.x;
+    vec2 ndc1 = clip1.xy * invW.y;
+    vec2 ndc2 = clip2.xy * invW.z;
+
+    // gradients of the screen space barycentrics over ndc, each scaled by its corner's 1/w
+    float invDet = 1.0 / determinant(mat2(ndc2 - ndc1, ndc0 - ndc1));
+    vec3 dx = vec3(ndc1.y - ndc2.y, ndc2.y - ndc0.y, ndc0.y - ndc1.y) * invDet * invW;
+    vec3 dy = vec3(ndc2.x - ndc1.x, ndc0.x - ndc2.x, ndc1.x - ndc0.x) * invDet * invW;
+    float dxSum = dot(dx, vec3(1.0));
+    float dySum = dot(dy, vec3(1.0));
+
+    vec2 delta = ndc - ndc0;
+    float interpInvW = invW.x + delta.x * dxSum + delta.y * dySum;
+    Barycentrics result;
+    result.lambda = (vec3(invW.x, 0.0, 0.0) + delta.x * dx + delta.y * dy) / interpInvW;
+
+    // one pixel is 2 / size in ndc
+    vec2 pixelSize = 2.0 / size;
+    dx *= pixelSize.x;
+    dy *= pixelSize.y;
+    result.ddx = (result.lambda * interpInvW + dx) / (interpInvW + dxSum * pixelSize.x) - result.lambda;
+    result.ddy = (result.lambda * interpInvW + dy) / (interpInvW + dySum * pixelSize.y) - result.lambda;
+    return result;
+}
+
+// view space point at a window position (0..1) and depth buffer value
+vec3 windowToView(vec2 uv, float depth)
+{
+    vec4 view = inverseProjection * vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+    return view.xyz / view.w;
+}
+
+bool sphereTouchesBox(vec3 center, float radius, vec3 minPoint, vec3 maxPoint)
+{
+    vec3 offset = clamp(center, minPoint, maxPoint) - center;
+    return dot(offset, offset) <= radius * radius;
+}
+
+vec3 CalDirLight(vec3 albedo, vec3 specularColor, vec3 norm, vec3 viewDir)
+{
+    vec3 ambient = dirLight.ambient.rgb * albedo;
+
+    vec3 lightDir = normalize(-dirLight.direction.xyz);
+    float diff = max(dot(norm, lightDir), 0.0);
+    vec3 diffuse = dirLight.diffuse.rgb * diff * albedo;
+
+    vec3 reflectDir = reflect(-lightDir, norm);
+    float spec = pow(max(dot(reflectDir, viewDir), 0.0), shininess);
+    vec3 specular = dirLight.specular.rgb * spec * specularColor;
+
+    return ambient + diffuse + specular;
+}
+
+// same as CalPointLight in shader.fs, with the material sampled once up front
+vec3 CalPointLight(PointLight pointLight, vec3 albedo, vec3 specularColor, vec3 norm, vec3 fragPos, vec3 viewDir)
+{
+    vec3 ambient = pointLight.ambient.rgb * albedo;
+
+    vec3 lightDir = normalize(pointLight.position.xyz - fragPos);
+    float diff = max(dot(lightDir, norm), 0.0);
+    vec3 diffuse = pointLight.diffuse.rgb * diff * albedo;
+
+    vec3 reflectDir = reflect(-lightDir, norm);
+    float spec = pow(max(dot(reflectDir, viewDir), 0.0), shininess);
+    vec3 specular = pointLight.specular.rgb * spec * specularColor;
+
+    float distance = length(pointLight.position.xyz - fragPos);
+    float attenuation = 1.0 / (pointLight.attenuation.x + pointLight.attenuation.y * distance + pointLight.attenuation.z * (distance * distance));
+    float falloff = clamp(1.0 - pow(distance / pointLight.position.w, 4.0), 0.0, 1.0);
+    attenuation *= falloff * falloff;
+
+    return (ambient + diffuse + specular) * attenuation;
+}
+
+void main()
+{
+    ivec2 size = imageSize(litImage);
+    ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);
+    bool inside = all(lessThan(pixel, size));
+
+    if (gl_LocalInvocationIndex == 0u)
+    {
+        tileMinDepth = 0xFFFFFFFFu;
+        tileMaxDepth = 0u;
+        tileLightCount = 0u;
+    }
+    barrier();
+
+    uint id = inside ? texelFetch(visibilityIds, pixel, 0).r : 0u;
+    uvec4 triangle = id != 0u ? triangles[id & TRIANGLE_MASK] : uvec4(0u);
+    bool shaded = id != 0u && triangle.w == uint(material);
+    float depth = shaded ? texelFetch(visibilityDepth, pixel, 0).r : 1.0;
+    if (shaded)
+    {
+        atomicMin(tileMinDepth, floatBitsToUint(depth));
+        atomicMax(tileMaxDepth, floatBitsToUint(depth));
+    }
+    barrier();
+
+    // view space box of the tile's pixels of this material, lights culled against it as in deferred_lighting.cs;
+    // tiles without any skip culling altogether
+    if (tileMinDepth <= tileMaxDepth)
+    {
+        vec2 tileMin = vec2(gl_WorkGroupID.xy * gl_WorkGroupSize.xy) / vec2(size);
+        vec2 tileMax = vec2((gl_WorkGroupID.xy + 1u) * gl_WorkGroupSize.xy) / vec2(size);
+        float nearZ = windowToView(tileMin, uintBitsToFloat(tileMinDepth)).z;
+        float farZ = windowToView(tileMin, uintBitsToFloat(tileMaxDepth)).z;
+        vec3 minRay = windowToView(tileMin, 0.0);
+        vec3 maxRay = windowToView(tileMax, 0.0);
+        vec3 a = minRay * (nearZ / minRay.z);
+        vec3 b = minRay * (farZ / minRay.z);
+        vec3 c = maxRay * (nearZ / maxRay.z);
+        vec3 d = maxRay * (farZ / maxRay.z);
+        vec3 boxMin = min(min(a, b), min(c, d));
+        vec3 boxMax = max(max(a, b), max(c, d));
+
+        uint threads = gl_WorkGroupSize.x * gl_WorkGroupSize.y;
+        for (uint i = gl_LocalInvocationIndex; i < uint(lightCount.x); i += threads)
+        {
+            vec4 position = pointLights[i].position;
+            if (sphereTouchesBox((view * vec4(position.xyz, 1.0)).xyz, position.w, boxMin, boxMax))
+            {
+                uint slot = atomicAdd(tileLightCount, 1u);
+                if (slot < MAX_TILE_LIGHTS)
+                    tileLights[slot] = i;
+            }
+        }
+    }
+    barrier();
+
+    if (gl_LocalInvocationIndex == 0u && tileLightCount > MAX_TILE_LIGHTS)
+    {
+        atomicAdd(overflowTiles, 1u);
+        atomicAdd(droppedTileLights, tileLightCount - MAX_TILE_LIGHTS);
+    }
+    if (!inside)
+        return;
+    if (id == 0u)
+    {
+        if (material == 0)
+            imageStore(litImage, pixel, background);
+        return;
+    }
+    if (!shaded)
+        return;
+
+    // rebuild the triangle: three vertex fetches and the draw's matrices
+    Draw draw = draws[(id >> TRIANGLE_BITS) - 1u];
+    ArenaVertex v0 = vertices[triangle.x];
+    ArenaVertex v1 = vertices[triangle.y];
+    ArenaVertex v2 = vertices[triangle.z];
+    vec3 p0 = vec3(draw.model * vec4(v0.positionU.xyz, 1.0));
+    vec3 p1 = vec3(draw.model * vec4(v1.positionU.xyz, 1.0));
+    vec3 p2 = vec3(draw.model * vec4(v2.positionU.xyz, 1.0));
+    vec2 ndc = (vec2(pixel) + 0.5) / vec2(size) * 2.0 - 1.0;
+    Barycentrics bary = computeBarycentrics(viewProjection * vec4(p0, 1.0), viewProjection * vec4(p1, 1.0), viewProjection * vec4(p2, 1.0), ndc, vec2(size));
+
+    mat3x2 uvs = mat3x2(vec2(v0.positionU.w, v0.normalV.w), vec2(v1.positionU.w, v1.normalV.w), vec2(v2.positionU.w, v2.normalV.w));
+    vec2 texCoords = uvs * bary.lambda;
+    vec2 texCoordsDx = uvs * bary.ddx;
+    vec2 texCoordsDy = uvs * bary.ddy;
+    vec3 fragPos = mat3(p0, p1, p2) * bary.lambda;
+    vec3 norm = normalize(mat3(draw.normalMatrix) * (mat3(v0.normalV.xyz, v1.normalV.xyz, v2.normalV.xyz) * bary.lambda));
+    vec3 viewDir = normalize(viewPos.xyz - fragPos);
+
+    // the material, sampled once for this pixel whatever the light count
+    vec3 albedo = textureGrad(texture_diffuse1, texCoords, texCoordsDx, texCoordsDy).rgb;
+    vec3 specularColor = textureGrad(texture_specular1, texCoords, texCoordsDx, texCoordsDy).rgb;
+
+    vec3 result = CalDirLight(albedo, specularColor, norm, viewDir);
+    uint count = min(tileLightCount, uint(MAX_TILE_LIGHTS));
+    for (uint i = 0u; i < count; i++)
+        result += CalPointLight(pointLights[tileLights[i]], albedo, specularColor, norm, fragPos, viewDir);
+    imageStore(litImage, pixel, vec4(result, 1.0));
+}
\ No newline at end of file
@@ -0,0 +1,366 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <iostream>
+
+// Debug builds compare the cache against glGet* at the end of every frame
+#ifndef GLSTATE_VALIDATE
+#ifdef _DEBUG
+#define GLSTATE_VALIDATE 1
+#else
+#define GLSTATE_VALIDATE 0
+#endif
+#endif
+
+#define GLSTATE_TEXTURE_UNITS 16
+
+// Thin cache in front of the GL state machine: every setter only reaches the driver when the value
+// actually changes. Starts out "unknown", so the first call of each kind always goes through; call
+// Invalidate() after any code that changes state behind the cache's back (loaders, raw GL calls).
+// GL_ELEMENT_ARRAY_BUFFER belongs to the bound VAO and is therefore never cached.
+class GLState
+{
+public:
+    struct Stats {
+        unsigned int issued = 0;
+        unsigned int skipped = 0;
+    };
+
+    // calls of the frame in progress and of the last finished frame
+    Stats frame, lastFrame;
+    bool validate = GLSTATE_VALIDATE;
+
+    // one cache per context, every demo has a single one
+    static GLState& Get()
+    {
+        static GLState state;
+        return state;
+    }
+
+    void Invalidate()
+    {
+        program = UNKNOWN;
+        vertexArray = UNKNOWN;
+        activeUnit = UNKNOWN;
+        for (unsigned int i = 0; i < GLSTATE_TEXTURE_UNITS; i++)
+            textures[i] = UNKNOWN;
+        for (unsigned int i = 0; i < BUFFER_TARGETS; i++)
+            buffers[i] = UNKNOWN;
+        for (unsigned int i = 0; i < CAPABILITIES; i++)
+            capabilities[i] = UNKNOWN;
+        depthMask = UNKNOWN;
+        depthFunc = UNKNOWN;
+        stencilMaskKnown = false;
+        stencilFuncKnown = false;
+        stencilOp[0] = stencilOp[1] = stencilOp[2] = UNKNOWN;
+        colorMask = UNKNOWN;
+        blendFunc[0] = blendFunc[1] = UNKNOWN;
+        polygonMode = UNKNOWN;
+    }
+
+    void UseProgram(GLuint id)
+    {
+        if (changed(program, id))
+            glUseProgram(id);
+    }
+
+    void BindVertexArray(GLuint id)
+    {
+        if (changed(vertexArray, id))
+            glBindVertexArray(id);
+    }
+
+    // only 2D textures are tracked; glActiveTexture is issued only when the unit's binding changes
+    void BindTexture(unsigned int unit, GLuint id)
+    {
+        if (unit >= GLSTATE_TEXTURE_UNITS)
+        {
+            glActiveTexture(GL_TEXTURE0 + unit);
+            glBindTexture(GL_TEXTURE_2D, id);
+            activeUnit = unit;
+            frame.issued += 2;
+            return;
+        }
+        if (!changed(textures[unit], id))
+            return;
+        if (changed(activeUnit, unit))
+            glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(GL_TEXTURE_2D, id);
+    }
+
+    void BindBuffer(GLenum target, GLuint id)
+    {
+        int index = bufferIndex(target);
+        if (index < 0 || changed(buffers[index], id))
+            glBindBuffer(target, id);
+        if (index < 0)
+            frame.issued++;
+    }
+
+    void SetEnabled(GLenum capability, bool enabled)
+    {
+        int index = capabilityIndex(capability);
+        if (index >= 0 && !changed(capabilities[index], enabled ? 1u : 0u))
+            return;
+        if (index < 0)
+            frame.issued++;
+        if (enabled)
+            glEnable(capability);
+        else
+            glDisable(capability);
+    }
+
+    void DepthMask(bool enabled)
+    {
+        if (changed(depthMask, enabled ? 1u : 0u))
+            glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+    }
+
+    void DepthFunc(GLenum func)
+    {
+        if (changed(depthFunc, func))
+            glDepthFunc(func);
+    }
+
+    void StencilMask(GLuint mask)
+    {
+        if (changed(stencilMask, stencilMaskKnown, mask))
+            glStencilMask(mask);
+    }
+
+    void StencilFunc(GLenum func, GLint ref, GLuint mask)
+    {
+        unsigned int value[3] = { func, static_cast<unsigned int>(ref), mask };
+        if (changed(stencilFunc, stencilFuncKnown, value, 3))
+            glStencilFunc(func, ref, mask);
+    }
+
+    void StencilOp(GLenum stencilFail, GLenum depthFail, GLenum pass)
+    {
+        unsigned int value[3] = { stencilFail, depthFail, pass };
+        if (changed(stencilOp, value, 3))
+            glStencilOp(stencilFail, depthFail, pass);
+    }
+
+    void ColorMask(bool r, bool g, bool b, bool a)
+    {
+        unsigned int value = (r ? 1u : 0u) | (g ? 2u : 0u) | (b ? 4u : 0u) | (a ? 8u : 0u);
+        if (changed(colorMask, value))
+            glColorMask(r, g, b, a);
+    }
+
+    void BlendFunc(GLenum source, GLenum destination)
+    {
+        unsigned int value[2] = { source, destination };
+        if (changed(blendFunc, value, 2))
+            glBlendFunc(source, destination);
+    }
+
+    void PolygonMode(GLenum mode)
+    {
+        if (changed(polygonMode, mode))
+            glPolygonMode(GL_FRONT_AND_BACK, mode);
+    }
+
+    // Closes the frame's statistics and, in validate mode, checks every known value against the driver
+    void EndFrame()
+    {
+        if (validate)
+            Validate();
+        lastFrame = frame;
+        frame = Stats();
+    }
+
+    bool Validate()
+    {
+        bool valid = true;
+        GLint value = 0;
+        GLint values[4] = {};
+
+        glGetIntegerv(GL_CURRENT_PROGRAM, &value);
+        valid &= check("program", program, value);
+        glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &value);
+        valid &= check("vertex array", vertexArray, value);
+
+        GLint previousUnit = 0;
+        glGetIntegerv(GL_ACTIVE_TEXTURE, &previousUnit);
+        valid &= check("active texture", activeUnit, previousUnit - GL_TEXTURE0);
+        for (unsigned int i = 0; i < GLSTATE_TEXTURE_UNITS; i++)
+        {
+            if (textures[i] == UNKNOWN)
+                continue;
+            glActiveTexture(GL_TEXTURE0 + i);
+            glGetIntegerv(GL_TEXTURE_BINDING_2D, &value);
+            valid &= check("texture unit", textures[i], value);
+        }
+        glActiveTexture(previousUnit);
+
+        for (unsigned int i = 0; i < BUFFER_TARGETS; i++)
+        {
+            glGetIntegerv(bufferBindingQuery(i), &value);
+            valid &= check("buffer", buffers[i], value);
+        }
+        for (unsigned int i = 0; i < CAPABILITIES; i++)
+            valid &= check("capability", capabilities[i], glIsEnabled(capabilityEnum(i)) ? 1 : 0);
+
+        glGetIntegerv(GL_DEPTH_WRITEMASK, &value);
+        valid &= check("depth mask", depthMask, value ? 1 : 0);
+        glGetIntegerv(GL_DEPTH_FUNC, &value);
+        valid &= check("depth func", depthFunc, value);
+        glGetIntegerv(GL_STENCIL_WRITEMASK, &value);
+        valid &= check("stencil mask", stencilMaskKnown, stencilMask, value);
+        glGetIntegerv(GL_STENCIL_FUNC, &value);
+        valid &= check("stencil func", stencilFuncKnown, stencilFunc[0], value);
+        glGetIntegerv(GL_STENCIL_REF, &value);
+        valid &= check("stencil ref", stencilFuncKnown, stencilFunc[1], value);
+        glGetIntegerv(GL_STENCIL_VALUE_MASK, &value);
+        valid &= check("stencil value mask", stencilFuncKnown, stencilFunc[2], value);
+        glGetIntegerv(GL_STENCIL_FAIL, &value);
+        valid &= check("stencil fail", stencilOp[0], value);
+        glGetIntegerv(GL_STENCIL_PASS_DEPTH_FAIL, &value);
+        valid &= check("stencil depth fail", stencilOp[1], value);
+        glGetIntegerv(GL_STENCIL_PASS_DEPTH_PASS, &value);
+        valid &= check("stencil pass", stencilOp[2], value);
+        GLboolean mask[4];
+        glGetBooleanv(GL_COLOR_WRITEMASK, mask);
+        valid &= check("color mask", colorMask, (mask[0] ? 1 : 0) | (mask[1] ? 2 : 0) | (mask[2] ? 4 : 0) | (mask[3] ? 8 : 0));
+        glGetIntegerv(GL_BLEND_SRC_RGB, &value);
+        valid &= check("blend source", blendFunc[0], value);
+        glGetIntegerv(GL_BLEND_DST_RGB, &value);
+        valid &= check("blend destination", blendFunc[1], value);
+        glGetIntegerv(GL_POLYGON_MODE, values);
+        valid &= check("polygon mode", polygonMode, values[0]);
+        return valid;
+    }
+
+private:
+    // Handles and enums never reach this value. Write masks and the stencil ref can, so those fields
+    // carry a separate known flag instead.
+    static const unsigned int UNKNOWN = 0xFFFFFFFFu;
+    static const unsigned int BUFFER_TARGETS = 5;
+    static const unsigned int CAPABILITIES = 5;
+
+    unsigned int program = UNKNOWN;
+    unsigned int vertexArray = UNKNOWN;
+    unsigned int activeUnit = UNKNOWN;
+    unsigned int textures[GLSTATE_TEXTURE_UNITS];
+    unsigned int buffers[BUFFER_TARGETS];
+    unsigned int capabilities[CAPABILITIES];
+    unsigned int depthMask = UNKNOWN;
+    unsigned int depthFunc = UNKNOWN;
+    unsigned int stencilMask = 0;
+    bool stencilMaskKnown = false;
+    unsigned int stencilFunc[3] = {};
+    bool stencilFuncKnown = false;
+    unsigned int stencilOp[3];
+    unsigned int colorMask = UNKNOWN;
+    unsigned int blendFunc[2];
+    unsigned int polygonMode = UNKNOWN;
+
+    GLState()
+    {
+        Invalidate();
+    }
+
+    bool changed(unsigned int& cached, unsigned int value)
+    {
+        if (cached == value)
+        {
+            frame.skipped++;
+            return false;
+        }
+        cached = value;
+        frame.issued++;
+        return true;
+    }
+
+    bool changed(unsigned int& cached, bool& known, unsigned int value)
+    {
+        if (known && cached == value)
+        {
+            frame.skipped++;
+            return false;
+        }
+        cached = value;
+        known = true;
+        frame.issued++;
+        return true;
+    }
+
+    bool changed(unsigned int* cached, bool& known, const unsigned int* value, unsigned int count)
+    {
+        if (!known)
+        {
+            for (unsigned int i = 0; i < count; i++)
+                cached[i] = value[i];
+            known = true;
+            frame.issued++;
+            return true;
+        }
+        return changed(cached, value, count);
+    }
+
+    bool changed(unsigned int* cached, const unsigned int* value, unsigned int count)
+    {
+        bool same = true;
+        for (unsigned int i = 0; i < count; i++)
+            same &= cached[i] == value[i];
+        if (same)
+        {
+            frame.skipped++;
+            return false;
+        }
+        for (unsigned int i = 0; i < count; i++)
+            cached[i] = value[i];
+        frame.issued++;
+        return true;
+    }
+
+    static bool check(const char* name, unsigned int cached, GLint actual)
+    {
+        return check(name, cached != UNKNOWN, cached, actual);
+    }
+
+    static bool check(const char* name, bool known, unsigned int cached, GLint actual)
+    {
+        if (!known || cached == static_cast<unsigned int>(actual))
+            return true;
+        std::cout << "ERROR::GLSTATE::MISMATCH " << name << ": cached " << cached << ", driver " << actual << std::endl;
+        return false;
+    }
+
+    static int bufferIndex(GLenum target)
+    {
+        switch (target)
+        {
+        case GL_ARRAY_BUFFER: return 0;
+        case GL_UNIFORM_BUFFER: return 1;
+        case GL_SHADER_STORAGE_BUFFER: return 2;
+        case GL_DRAW_INDIRECT_BUFFER: return 3;
+        case GL_PARAMETER_BUFFER: return 4;
+        default: return -1;
+        }
+    }
+
+    static GLenum bufferBindingQuery(unsigned int index)
+    {
+        const GLenum queries[BUFFER_TARGETS] = { GL_ARRAY_BUFFER_BINDING, GL_UNIFORM_BUFFER_BINDING, GL_SHADER_STORAGE_BUFFER_BINDING,
+                                                 GL_DRAW_INDIRECT_BUFFER_BINDING, GL_PARAMETER_BUFFER_BINDING };
+        return queries[index];
+    }
+
+    static int capabilityIndex(GLenum capability)
+    {
+        for (unsigned int i = 0; i < CAPABILITIES; i++)
+            if (capabilityEnum(i) == capability)
+                return static_cast<int>(i);
+        return -1;
+    }
+
+    static GLenum capabilityEnum(unsigned int index)
+    {
+        const GLenum capabilities[CAPABILITIES] = { GL_DEPTH_TEST, GL_STENCIL_TEST, GL_BLEND, GL_CULL_FACE, GL_SCISSOR_TEST };
+        return capabilities[index];
+    }
+};
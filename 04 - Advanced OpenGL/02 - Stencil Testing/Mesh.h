@@ -6,6 +6,7 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "Shader.h"
+#include "GLState.h"
 
 #include <string>
 #include <vector>
@@ -58,7 +59,6 @@ public:
 
         for (unsigned int i = 0; i < textures.size(); i++)
         {
-            glActiveTexture(GL_TEXTURE0 + i);
             std::string number;
             std::string name = textures[i].type;
             if (name == "texture_diffuse") // assumed name convention
@@ -68,14 +68,13 @@ public:
 
             //shader.setInt(("material." + name + number).c_str(), i);
             shader.setInt((name + number).c_str(), i);
-            glBindTexture(GL_TEXTURE_2D, textures[i].id);
+            // unit and texture only reach GL when they differ from what is already bound
+            GLState::Get().BindTexture(i, textures[i].id);
         }
-        glActiveTexture(GL_TEXTURE0);
 
         // Draw Mesh
-        glBindVertexArray(VAO);
+        GLState::Get().BindVertexArray(VAO);
         glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
     }
 
 private:
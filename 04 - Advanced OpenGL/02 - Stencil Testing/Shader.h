@@ -3,6 +3,8 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
+#include "GLState.h"
+
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -61,7 +63,7 @@ public:
 
 	void use() const
 	{
-		glUseProgram(ID);
+		GLState::Get().UseProgram(ID);
 	}
 
 	void setInt(const std::string& name, int x) const
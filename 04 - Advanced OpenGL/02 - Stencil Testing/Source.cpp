@@ -9,6 +9,7 @@
 #include "Shader.h"
 #include "Camera.h"
 #include "Model.h"
+#include "GLState.h"
 
 #include <iostream>
 
@@ -29,6 +30,10 @@ Camera camera(glm::vec3(0.0f, 0.0f, 5.0f));
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 
+// GL state cache statistics are printed every STATE_REPORT_FRAMES frames, V toggles validation against glGet*
+const int STATE_REPORT_FRAMES = 300;
+bool validateKeyDownLastFrame = false;
+
 // sphere
 const float PI = 3.14159265359f;
 const unsigned int X_SEGMENTS = 8;
@@ -303,6 +308,12 @@ int main()
     // shader configuration
     // --------------------
 
+    // everything above changed GL state directly, start the cache from a clean slate
+    GLState& state = GLState::Get();
+    state.Invalidate();
+    unsigned int issuedCalls = 0, skippedCalls = 0;
+    int reportFrames = 0;
+
     // render loop
     // -----------
     while (!glfwWindowShouldClose(window))
@@ -325,7 +336,7 @@ int main()
         view = glm::lookAt(glm::vec3(camX, 0.0, camZ), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
 
         // 1. Render the magic box model 
-		glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+        state.PolygonMode(GL_LINE);
         modelShader.use();
         glm::mat4 model = glm::mat4(1.0f);
         model = glm::translate(model, glm::vec3(0.0f, 0.0f, 0.0f));
@@ -336,16 +347,16 @@ int main()
         modelShader.setMat4("model", model);
         modelShader.setVec3("modelColor", glm::vec3(1.0f, 1.0f, 1.0f));
         magicBox.Draw(modelShader);
-        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+        state.PolygonMode(GL_FILL);
 
         // 2. Create stencil masks for each window (first pass)
-        glStencilMask(0xFF);                  // Enable writing to stencil
-        glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
-        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE); // Disable color writes
+        state.StencilMask(0xFF);                  // Enable writing to stencil
+        state.StencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
+        state.ColorMask(false, false, false, false); // Disable color writes
 
         // --- Window 1 Mask ---
-        glStencilFunc(GL_ALWAYS, 1, 0xFF);      // Reference 1 for window 1
-        glBindVertexArray(planeVAO);
+        state.StencilFunc(GL_ALWAYS, 1, 0xFF);      // Reference 1 for window 1
+        state.BindVertexArray(planeVAO);
         planeShader.use();
         model = glm::mat4(1.0f);
         model = glm::translate(model, glm::vec3(0.0f, 0.0f, -1.0f)); // Position mask for window 1
@@ -355,85 +366,76 @@ int main()
         planeShader.setMat4("view", view);
         planeShader.setMat4("projection", projection);
         glDrawArrays(GL_TRIANGLES, 0, 6);
-        glBindVertexArray(0);
 
         // --- Window 2 Mask ---
-        glStencilFunc(GL_ALWAYS, 2, 0xFF);      // Reference 2 for window 2
-        glBindVertexArray(planeVAO);
-		planeShader.use();
+        state.StencilFunc(GL_ALWAYS, 2, 0xFF);      // Reference 2 for window 2
+        state.BindVertexArray(planeVAO);
+        planeShader.use();
         model = glm::mat4(1.0f);
         model = glm::translate(model, glm::vec3(0.0f, 0.0f, 0.8f));
         model = glm::scale(model, glm::vec3(0.95f, 0.95f, 0.95f));
         planeShader.setMat4("model", model);
         glDrawArrays(GL_TRIANGLES, 0, 6);
-        glBindVertexArray(0);
 
         // --- Window 3 Mask ---
-        glStencilFunc(GL_ALWAYS, 3, 0xFF);      // Reference 3 for window 3
-        glBindVertexArray(planeVAO);
-		planeShader.use();
+        state.StencilFunc(GL_ALWAYS, 3, 0xFF);      // Reference 3 for window 3
+        state.BindVertexArray(planeVAO);
+        planeShader.use();
         model = glm::mat4(1.0f);
         model = glm::rotate(model, glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
         model = glm::translate(model, glm::vec3(0.0f, 0.0f, -1.0f));
         model = glm::scale(model, glm::vec3(0.95f, 0.95f, 0.95f));
         planeShader.setMat4("model", model);
         glDrawArrays(GL_TRIANGLES, 0, 6);
-        glBindVertexArray(0);
 
         // --- Window 4 Mask ---
-        glStencilFunc(GL_ALWAYS, 4, 0xFF);      // Reference 4 for window 4
-        glBindVertexArray(planeVAO);
-		planeShader.use();
+        state.StencilFunc(GL_ALWAYS, 4, 0xFF);      // Reference 4 for window 4
+        state.BindVertexArray(planeVAO);
+        planeShader.use();
         model = glm::mat4(1.0f);
         model = glm::rotate(model, glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
         model = glm::translate(model, glm::vec3(0.0f, 0.0f, 0.8f));
         model = glm::scale(model, glm::vec3(0.95f, 0.95f, 0.95f));
         planeShader.setMat4("model", model);
         glDrawArrays(GL_TRIANGLES, 0, 6);
-        glBindVertexArray(0);
 
         // Re-enable color and depth writes after updating stencil
-        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        state.ColorMask(true, true, true, true);
 
         // 3. Render objects behind each window using the stencil test (second pass)
 		// Disable writing to stencil
-        glStencilMask(0x00);
+        state.StencilMask(0x00);
 
         // --- Render object for Window 1 ---
-        glDisable(GL_DEPTH_TEST);
+        // every object states what it needs, the cache drops the repeats
+        state.SetEnabled(GL_DEPTH_TEST, false);
 
-        glStencilFunc(GL_EQUAL, 1, 0xFF);  // Only render where stencil == 1
-        glBindVertexArray(cubeVAO);
+        state.StencilFunc(GL_EQUAL, 1, 0xFF);  // Only render where stencil == 1
+        state.BindVertexArray(cubeVAO);
         modelShader.use();
         model = glm::mat4(1.0f);
         model = glm::translate(model, glm::vec3(0.0f, 0.0f, 0.0f));
         modelShader.setMat4("model", model);
         modelShader.setVec3("modelColor", glm::vec3(1.0, 0.5, 0.31));
         glDrawArrays(GL_TRIANGLES, 0, 36);
-        glBindVertexArray(0);
-
-        glEnable(GL_DEPTH_TEST);
 
         // --- Render object for Window 2 ---
-        glDisable(GL_DEPTH_TEST);
+        state.SetEnabled(GL_DEPTH_TEST, false);
 
-        glStencilFunc(GL_EQUAL, 2, 0xFF);  // Only where stencil == 2
-        glBindVertexArray(pyramidVAO);
+        state.StencilFunc(GL_EQUAL, 2, 0xFF);  // Only where stencil == 2
+        state.BindVertexArray(pyramidVAO);
         modelShader.use();
         model = glm::mat4(1.0f);
         model = glm::translate(model, glm::vec3(0.0f, -0.5f, 0.0f));
         modelShader.setMat4("model", model);
         modelShader.setVec3("modelColor", glm::vec3(1.0, 1.0, 0.0));
         glDrawArrays(GL_TRIANGLES, 0, 18);
-        glBindVertexArray(0);
-
-        glEnable(GL_DEPTH_TEST);
 
         // --- Render object for Window 3 ---
-        glDisable(GL_DEPTH_TEST);
+        state.SetEnabled(GL_DEPTH_TEST, false);
 
-        glStencilFunc(GL_EQUAL, 3, 0xFF);  // Only where stencil == 3
-        glBindVertexArray(sphereVAO);
+        state.StencilFunc(GL_EQUAL, 3, 0xFF);  // Only where stencil == 3
+        state.BindVertexArray(sphereVAO);
         modelShader.use();
         model = glm::mat4(1.0f);
         model = glm::translate(model, glm::vec3(0.0f, 0.0f, 0.0f));
@@ -441,15 +443,12 @@ int main()
         modelShader.setMat4("model", model);
         modelShader.setVec3("modelColor", glm::vec3(1.0, 0.6, 0.8));
         glDrawElements(GL_TRIANGLES, sphereIndices.size(), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
-
-        glEnable(GL_DEPTH_TEST);
 
         // --- Render object for Window 4 ---
-        glDisable(GL_DEPTH_TEST);
+        state.SetEnabled(GL_DEPTH_TEST, false);
 
-        glStencilFunc(GL_EQUAL, 4, 0xFF);  // Only where stencil == 4
-        glBindVertexArray(diamondVAO);
+        state.StencilFunc(GL_EQUAL, 4, 0xFF);  // Only where stencil == 4
+        state.BindVertexArray(diamondVAO);
         modelShader.use();
         model = glm::mat4(1.0f);
         model = glm::translate(model, glm::vec3(0.0f, 0.0f, 0.0f));
@@ -457,13 +456,23 @@ int main()
         modelShader.setMat4("model", model);
         modelShader.setVec3("modelColor", glm::vec3(0.0f, 0.8f, 1.0f));
         glDrawArrays(GL_TRIANGLES, 0, 24);
-        glBindVertexArray(0);
 
-        glEnable(GL_DEPTH_TEST);
+        state.SetEnabled(GL_DEPTH_TEST, true);
 
         // Reset stencil state for further rendering
-        glStencilMask(0xFF);
-        glStencilFunc(GL_ALWAYS, 0, 0xFF);
+        state.StencilMask(0xFF);
+        state.StencilFunc(GL_ALWAYS, 0, 0xFF);
+
+        // Redundant state calls filtered out by the cache
+        state.EndFrame();
+        issuedCalls += state.lastFrame.issued;
+        skippedCalls += state.lastFrame.skipped;
+        if (++reportFrames == STATE_REPORT_FRAMES)
+        {
+            std::cout << "GL state calls per frame: " << issuedCalls / reportFrames << " issued, " << skippedCalls / reportFrames << " redundant removed" << std::endl;
+            issuedCalls = skippedCalls = 0;
+            reportFrames = 0;
+        }
 
         // Swap buffers and poll events
         glfwSwapBuffers(window);
@@ -486,6 +495,14 @@ void processInput(GLFWwindow* window)
 {
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
+
+    bool validateKeyDown = glfwGetKey(window, GLFW_KEY_V) == GLFW_PRESS;
+    if (validateKeyDown && !validateKeyDownLastFrame)
+    {
+        GLState::Get().validate = !GLState::Get().validate;
+        std::cout << "GL state validation: " << (GLState::Get().validate ? "ON" : "OFF") << std::endl;
+    }
+    validateKeyDownLastFrame = validateKeyDown;
 }
 
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
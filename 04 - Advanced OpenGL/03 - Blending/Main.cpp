@@ -7,6 +7,7 @@
 #include "stb_image.h"
 #include "Camera.h"
 #include "Shader.h"
+#include "RenderQueue.h"
 #include <vector>
 #include <cstddef>
 
@@ -35,6 +36,11 @@ bool leftMouseDownLastFrame = false;
 // Debug
 bool isDebugMode = false;
 
+// Render queue, Q switches between sorted and submission order
+RenderQueue renderQueue;
+bool sortKeyDownLastFrame = false;
+unsigned int frameCount = 0;
+
 void FramebufferSizeCallback(GLFWwindow* window, int width, int height);
 void processInput(GLFWwindow* window);
 void MouseCallback(GLFWwindow* window, double xposIn, double yposIn);
@@ -205,44 +211,27 @@ int main() {
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 		// Transformations
-		glm::mat4 model = glm::mat4(1.0f);
 		glm::mat4 view = camera.GetViewMatrix();
 
-		// Environment Rendering
-		envShader.use();
-		envShader.setMat4("view", view);
-		envShader.setMat4("projection", projection);
+		// Everything goes through the queue in scene order, the queue decides the draw order
+		renderQueue.Begin(camera.Position, camera.Front);
 		// Render cubes
-		glBindVertexArray(cubeVAO);
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, cubeTexID);
-		model = glm::translate(model, glm::vec3(-1.0f, 0.0f, -1.0f));
-		envShader.setMat4("model", model);
-		glDrawArrays(GL_TRIANGLES, 0, 36);
-		model = glm::mat4(1.0f);
-		model = glm::translate(model, glm::vec3(2.0f, 0.0f, 0.0f));
-		envShader.setMat4("model", model);
-		glDrawArrays(GL_TRIANGLES, 0, 36);
+		renderQueue.Submit({ &envShader, cubeTexID, cubeVAO, 0, 36, glm::translate(glm::mat4(1.0f), glm::vec3(-1.0f, 0.0f, -1.0f)) });
+		renderQueue.Submit({ &envShader, cubeTexID, cubeVAO, 0, 36, glm::translate(glm::mat4(1.0f), glm::vec3(2.0f, 0.0f, 0.0f)) });
 		// Render floor
-		glBindVertexArray(planeVAO);
-		//glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, planeTexID);
-		model = glm::mat4(1.0f);
-		envShader.setMat4("model", model);
-		glDrawArrays(GL_TRIANGLES, 0, 6);
-		glBindVertexArray(0);
-
+		renderQueue.Submit({ &envShader, planeTexID, planeVAO, 0, 6, glm::mat4(1.0f) });
 		// Render transparent objects (sorted by depth from furthest to nearest)
-		glBindVertexArray(transparentVAO);
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, transparentTexID);
-		for (size_t i = 0; i < grassLocations.size(); i++) {
-			model = glm::mat4(1.0f);
-			model = glm::translate(model, grassLocations[i]);
-			envShader.setMat4("model", model);
-			glDrawArrays(GL_TRIANGLES, 0, 6);
+		for (size_t i = 0; i < grassLocations.size(); i++)
+			renderQueue.Submit({ &envShader, transparentTexID, transparentVAO, 0, 6, glm::translate(glm::mat4(1.0f), grassLocations[i]), true });
+		renderQueue.Execute(view, projection);
+
+		if (++frameCount % 300 == 0)
+		{
+			std::cout << "RENDERQUEUE " << renderQueue.executed.draws << " draws, state changes submitted "
+				<< renderQueue.submittedOrder.Total() << " / executed " << renderQueue.executed.Total()
+				<< " (program " << renderQueue.executed.programChanges << ", texture " << renderQueue.executed.materialChanges
+				<< ", VAO " << renderQueue.executed.geometryChanges << ")" << std::endl;
 		}
-		glBindVertexArray(0);
 
 		// Process input
 		processInput(window);
@@ -271,6 +260,14 @@ void processInput(GLFWwindow* window) {
 	if (glfwGetKey(window, GLFW_KEY_ESCAPE))
 		glfwSetWindowShouldClose(window, true);
 
+	bool sortKeyDown = glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS;
+	if (sortKeyDown && !sortKeyDownLastFrame)
+	{
+		renderQueue.sorting = !renderQueue.sorting;
+		std::cout << "Render queue: " << (renderQueue.sorting ? "sorted" : "submission order") << std::endl;
+	}
+	sortKeyDownLastFrame = sortKeyDown;
+
 	if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
 		camera.ProcessKeyboard(FORWARD, deltaTime);
 	if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
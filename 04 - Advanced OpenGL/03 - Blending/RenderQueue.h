@@ -0,0 +1,197 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "Shader.h"
+
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+// One draw call and everything needed to issue it
+struct DrawPacket
+{
+	Shader* program;
+	GLuint material;		// texture bound to unit 0
+	GLuint geometry;		// VAO
+	GLint first;
+	GLsizei count;
+	glm::mat4 transform;
+	bool transparent = false;
+};
+
+// Draws are submitted in any order, encoded into 64-bit keys and radix sorted before execution.
+//   opaque:      0 | program:8 | material:12 | geometry:11 | depth:32    state first, then front-to-back
+//   transparent: 1 | ~depth:32 | program:8 | material:12 | geometry:11   back-to-front, state as tie-break
+// Program/material/geometry GL names are mapped to small dense ids the first time they are seen.
+class RenderQueue
+{
+public:
+	struct Stats
+	{
+		unsigned int draws = 0;
+		unsigned int programChanges = 0;
+		unsigned int materialChanges = 0;
+		unsigned int geometryChanges = 0;
+
+		unsigned int Total() const { return programChanges + materialChanges + geometryChanges; }
+	};
+
+	// when false, Execute() issues the packets in submission order (for comparison)
+	bool sorting = true;
+	// state changes of the last Execute(), in submission order and as actually issued
+	Stats submittedOrder, executed;
+
+	void Begin(const glm::vec3& cameraPosition, const glm::vec3& cameraFront)
+	{
+		this->cameraPosition = cameraPosition;
+		this->cameraFront = cameraFront;
+		packets.clear();
+		keys.clear();
+	}
+
+	void Submit(const DrawPacket& packet)
+	{
+		// view-space depth of the object's origin, negative depths (behind the camera) clamp to 0
+		glm::vec3 position = glm::vec3(packet.transform[3]);
+		float depth = glm::max(glm::dot(position - cameraPosition, cameraFront), 0.0f);
+		uint32_t depthBits;
+		std::memcpy(&depthBits, &depth, sizeof(depthBits)); // non-negative floats order like their bits
+
+		uint64_t state = (uint64_t(denseId(programIds, packet.program->ID, 0xFF)) << 23)
+			| (uint64_t(denseId(materialIds, packet.material, 0xFFF)) << 11)
+			| uint64_t(denseId(geometryIds, packet.geometry, 0x7FF));
+		uint64_t key;
+		if (packet.transparent)
+			key = (1ull << 63) | (uint64_t(~depthBits) << 31) | state;
+		else
+			key = (state << 32) | depthBits;
+
+		keys.push_back({ key, static_cast<uint32_t>(packets.size()) });
+		packets.push_back(packet);
+	}
+
+	// Binds only what changes between consecutive packets; "view" and "projection" are set once per program
+	void Execute(const glm::mat4& view, const glm::mat4& projection)
+	{
+		submittedOrder = countChanges(false);
+		if (sorting)
+			radixSort();
+		executed = countChanges(sorting);
+
+		GLuint program = 0, material = 0, geometry = 0;
+		bool blending = false;
+		glActiveTexture(GL_TEXTURE0);
+		for (size_t i = 0; i < packets.size(); i++)
+		{
+			const DrawPacket& packet = packets[sorting ? keys[i].packet : i];
+			if (packet.transparent != blending)
+			{
+				blending = packet.transparent;
+				if (blending)
+				{
+					glEnable(GL_BLEND);
+					glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+					glDepthMask(GL_FALSE);
+				}
+				else
+				{
+					glDisable(GL_BLEND);
+					glDepthMask(GL_TRUE);
+				}
+			}
+			if (packet.program->ID != program)
+			{
+				program = packet.program->ID;
+				packet.program->use();
+				packet.program->setMat4("view", view);
+				packet.program->setMat4("projection", projection);
+			}
+			if (packet.material != material)
+			{
+				material = packet.material;
+				glBindTexture(GL_TEXTURE_2D, material);
+			}
+			if (packet.geometry != geometry)
+			{
+				geometry = packet.geometry;
+				glBindVertexArray(geometry);
+			}
+			packet.program->setMat4("model", packet.transform);
+			glDrawArrays(GL_TRIANGLES, packet.first, packet.count);
+		}
+		if (blending)
+		{
+			glDisable(GL_BLEND);
+			glDepthMask(GL_TRUE);
+		}
+		glBindVertexArray(0);
+	}
+
+private:
+	struct SortEntry
+	{
+		uint64_t key;
+		uint32_t packet;
+	};
+
+	glm::vec3 cameraPosition = glm::vec3(0.0f), cameraFront = glm::vec3(0.0f, 0.0f, -1.0f);
+	std::vector<DrawPacket> packets;
+	std::vector<SortEntry> keys, scratch;
+	std::unordered_map<GLuint, uint32_t> programIds, materialIds, geometryIds;
+
+	static uint32_t denseId(std::unordered_map<GLuint, uint32_t>& ids, GLuint name, uint32_t mask)
+	{
+		auto found = ids.find(name);
+		if (found != ids.end())
+			return found->second;
+		uint32_t id = static_cast<uint32_t>(ids.size()) & mask;
+		ids.emplace(name, id);
+		return id;
+	}
+
+	// LSD radix sort, 8 bits per pass; passes where every key has the same byte are skipped
+	void radixSort()
+	{
+		scratch.resize(keys.size());
+		for (int shift = 0; shift < 64; shift += 8)
+		{
+			size_t counts[256] = {};
+			for (const SortEntry& entry : keys)
+				counts[(entry.key >> shift) & 0xFF]++;
+			if (counts[(keys.empty() ? 0 : keys[0].key >> shift) & 0xFF] == keys.size())
+				continue;
+
+			size_t offset = 0;
+			for (size_t& count : counts)
+			{
+				size_t bucket = count;
+				count = offset;
+				offset += bucket;
+			}
+			for (const SortEntry& entry : keys)
+				scratch[counts[(entry.key >> shift) & 0xFF]++] = entry;
+			keys.swap(scratch);
+		}
+	}
+
+	Stats countChanges(bool sorted) const
+	{
+		Stats stats;
+		stats.draws = static_cast<unsigned int>(packets.size());
+		GLuint program = 0, material = 0, geometry = 0;
+		for (size_t i = 0; i < packets.size(); i++)
+		{
+			const DrawPacket& packet = packets[sorted ? keys[i].packet : i];
+			stats.programChanges += packet.program->ID != program;
+			stats.materialChanges += packet.material != material;
+			stats.geometryChanges += packet.geometry != geometry;
+			program = packet.program->ID;
+			material = packet.material;
+			geometry = packet.geometry;
+		}
+		return stats;
+	}
+};